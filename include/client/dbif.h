@@ -16,6 +16,8 @@
  */
 #pragma once
 
+#include <list>
+#include <map>
 #include <memory>
 #include <unordered_map>
 #include <unordered_set>
@@ -60,26 +62,41 @@ class NCObjectHandle : public dbif::ObjectHandleBase {
 };
 
 /*****************************************************************************/
-/* ChunkDataItemQuery */
+/* NodeCacheEntry */
 /*****************************************************************************/
 
-struct ChunkDataItemQuery{
-  ChunkDataItemQuery(uint64_t children_qid, uint64_t data_items_qid,
-      QPointer<dbif::InfoPromise> promise, data::NodeID id, bool sub);
+/** What NCWrapper knows about a single node.  Each part is fetched with
+    a server subscription the first time a request needs it and is kept up
+    to date by that subscription, so later requests are answered without
+    a round trip.  The subscriptions are cancelled only when the entry is
+    evicted - see NCWrapper::NODE_CACHE_SIZE.  */
+struct NodeCacheEntry {
+  enum Part {NODE, CHILDREN, DATA_ITEMS, PART_COUNT};
+  enum class RequestKind {DESCRIPTION, CHILDREN, CHUNK_DATA};
+  /** Ordered, so that children and chunk data replies list the children
+      in the same order every time.  */
   typedef std::map<data::NodeID, std::shared_ptr<proto::Node>> ChildrenMap;
 
-  bool ready();
-
-  uint64_t children_qid;
-  uint64_t data_items_qid;
-  bool children_loaded;
-  bool data_items_loaded;
-  QPointer<dbif::InfoPromise> promise;
-  data::NodeID id;
-  bool sub;
-
-  ChildrenMap children_map;
-  std::vector<data::ChunkDataItem> items;
+  /** A promise waiting for the entry - sub promises get every update.  */
+  struct Watcher {
+    QPointer<dbif::InfoPromise> promise;
+    RequestKind kind;
+    bool sub;
+  };
+
+  NodeCacheEntry();
+  static bool needs(RequestKind kind, Part part);
+  bool ready(RequestKind kind) const;
+  bool watched() const;
+
+  /** Subscription qid of each part, 0 if not subscribed yet.  */
+  uint64_t qids[PART_COUNT];
+  bool loaded[PART_COUNT];
+  std::shared_ptr<proto::Node> node;
+  ChildrenMap children;
+  std::vector<data::ChunkDataItem> data_items;
+  std::vector<Watcher> watchers;
+  std::list<data::NodeID>::iterator lru_pos;
 };
 
 /*****************************************************************************/
@@ -90,7 +107,6 @@ class NCWrapper : public QObject {
   Q_OBJECT
 
  public:
-  typedef std::map<data::NodeID, NCObjectHandle> ChildrenMap;
   typedef void (NCWrapper::*MessageHandler)(msg_ptr);
 
   NCWrapper(NetworkClient* network_client, QObject* parent = nullptr);
@@ -105,13 +121,6 @@ class NCWrapper : public QObject {
       data::NodeID id);
 
   void handleGetListReplyMessage(msg_ptr message);
-  void handleGetChildrenListReply(
-      std::shared_ptr<proto::MsgGetListReply> reply,
-      QPointer<dbif::InfoPromise> promise);
-  void handleGetChunkDataItemsReply(
-      std::shared_ptr<proto::MsgGetListReply> reply,
-      std::shared_ptr<ChunkDataItemQuery> chunk_data_item_query);
-
   void handleRequestAckMessage(msg_ptr message);
   void handleGetReplyMessage(msg_ptr message);
   void handleGetBinDataReplyMessage(msg_ptr message);
@@ -154,12 +163,9 @@ class NCWrapper : public QObject {
       std::shared_ptr<proto::Node> node,
       data::ChunkDataItem& out_chunk_data_item);
 
-  void updateChildrenDataItems(ChunkDataItemQuery& query,
-      std::shared_ptr<std::vector<std::shared_ptr<proto::Node>>> children,
-      std::shared_ptr<std::vector<std::shared_ptr<veles::data::NodeID>>> gone);
-  void updateDataItems(ChunkDataItemQuery& query,
-      std::shared_ptr<messages::MsgpackObject> data_items);
-  std::vector<data::ChunkDataItem> resultDataItems(ChunkDataItemQuery& query);
+  dbif::PInfoReply descriptionReply(std::shared_ptr<proto::Node> node);
+  dbif::PInfoReply childrenReply(const NodeCacheEntry& entry);
+  dbif::PInfoReply chunkDataReply(const NodeCacheEntry& entry);
 
  public slots:
   void updateConnectionStatus(NetworkClient::ConnectionStatus
@@ -178,6 +184,30 @@ class NCWrapper : public QObject {
   dbif::InfoPromise* addInfoPromise(uint64_t qid, bool sub);
   dbif::MethodResultPromise* addMethodPromise(uint64_t qid);
   void wrongMessageType(QString name, QString expected_type);
+
+  dbif::InfoPromise* watchNode(data::NodeID id,
+      NodeCacheEntry::RequestKind kind, bool sub,
+      dbif::InfoPromise* promise = nullptr);
+  void subscribeNodePart(data::NodeID id, NodeCacheEntry& entry,
+      NodeCacheEntry::Part part);
+  NodeCacheEntry* nodeCacheEntry(uint64_t qid, NodeCacheEntry::Part part,
+      data::NodeID* id);
+  void answerFromCache(data::NodeID id, NodeCacheEntry::RequestKind kind,
+      bool sub, dbif::InfoPromise* promise);
+  dbif::PInfoReply cachedReply(const NodeCacheEntry& entry,
+      NodeCacheEntry::RequestKind kind);
+  void notifyWatchers(data::NodeID id, NodeCacheEntry::Part part);
+  void evictNodeCache();
+  void clearNodeCache();
+
+  /** Unwatched entries kept around (and subscribed to) for later
+      requests, least recently used are dropped first.  Each entry keeps
+      up to three server subscriptions open (one per part) until it's
+      evicted, so a full cache costs the server up to three times this many
+      subscriptions nobody is watching - the price of answering repeated
+      requests without a round trip.  */
+  static const size_t NODE_CACHE_SIZE = 4096;
+
   NetworkClient* nc_;
 
   std::unordered_map<std::string, MessageHandler> message_handlers_;
@@ -185,17 +215,17 @@ class NCWrapper : public QObject {
   std::unordered_map<uint64_t, QPointer<dbif::MethodResultPromise>>
       method_promises_;
   std::unordered_set<uint64_t> subscriptions_;
-  std::unordered_map<uint64_t, QPointer<dbif::InfoPromise>>
-      root_children_promises_;
+  std::vector<QPointer<dbif::InfoPromise>> root_children_promises_;
   std::unordered_map<uint64_t, QSharedPointer<NCObjectHandle>> created_objs_waiting_for_ack_;
-  std::unordered_map<uint64_t, QSharedPointer<ChildrenMap>> children_maps_;
+  std::unordered_map<data::NodeID, NodeCacheEntry> node_cache_;
+  std::list<data::NodeID> node_cache_lru_;
+  std::unordered_map<uint64_t, std::pair<data::NodeID, NodeCacheEntry::Part>>
+      node_cache_qids_;
 
   bool detailed_debug_info_;
 
   QStringList parser_ids_;
   QList<QPointer<dbif::InfoPromise>> parser_promises_;
-  std::map<uint64_t, std::shared_ptr<ChunkDataItemQuery>>
-      chunk_data_item_queries_;
 };
 
 } // namespace client
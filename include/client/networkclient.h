@@ -24,9 +24,12 @@
 #include <iostream>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
+#include <QLocalSocket>
 #include <QString>
 #include <QTcpSocket>
+#include <QTimer>
 
 #include "network/msgpackwrapper.h"
 #include "data/nodeid.h"
@@ -79,6 +82,17 @@ class NetworkClient : public QObject {
 
   QTextStream* output();
   void setOutput(QTextStream* stream);
+  /** If set, messages sent within one event loop iteration go to the
+      server as a single MsgBatch.  Only servers from the same release
+      understand it.  */
+  void setBatchMessages(bool batch);
+  /** If set, asks the server to compress the traffic once connected.
+      Servers from before compression support drop such connections.  */
+  void setCompressMessages(bool compress);
+  /** If set, connect() first tries this local socket (a UNIX domain socket
+      path or a pipe name) instead of TCP.  Meant for servers running on
+      the same machine - TCP is used if the local socket can't be reached.  */
+  void setLocalServerName(QString name);
 
   void sendMsgConnect();
   virtual void registerMessageHandlers();
@@ -94,6 +108,8 @@ class NetworkClient : public QObject {
   virtual void handlePluginQueryGetMessage(msg_ptr msg);
   virtual void handleBroadcastRunMessage(msg_ptr msg);
   virtual void handlePluginHandlerUnregisteredMessage(msg_ptr msg);
+  virtual void handleCompressionSetMessage(msg_ptr msg);
+  virtual void handleCompressedMessage(msg_ptr msg);
 
   typedef void (NetworkClient::*MessageHandler)(msg_ptr);
 
@@ -102,21 +118,32 @@ signals:
   void messageReceived(msg_ptr message);
 
 public slots:
-  void sendMessage(msg_ptr msg);
+  /** Queues a message - queued messages are written out together once
+      control returns to the event loop.  */
+  virtual void sendMessage(msg_ptr msg);
+  void flushMessages();
   void setConnectionStatus(ConnectionStatus connection_status);
   void socketConnected();
   void socketDisconnected();
   void newDataAvailable();
   void socketError(QAbstractSocket::SocketError socketError);
+  void localSocketError(QLocalSocket::LocalSocketError socketError);
 
  private:
-  QTcpSocket* client_socket_;
+  void handleMessage(msg_ptr msg);
+  void connectTcpSocket();
+  void connectLocalSocket();
+  bool socketValid();
+
+  /** Either a QTcpSocket or a QLocalSocket.  */
+  QIODevice* client_socket_;
   std::unique_ptr<NodeTree> node_tree_;
   ConnectionStatus status_;
 
   QString server_name_;
   uint16_t server_port_;
   QString client_interface_name_;
+  QString local_server_name_;
 
   unsigned int protocol_version_;
   QString client_name_;
@@ -127,6 +154,12 @@ public slots:
   bool quit_on_close_;
 
   messages::MsgpackWrapper msgpack_wrapper_;
+  std::vector<msg_ptr> pending_messages_;
+  QTimer* flush_timer_;
+  bool batch_messages_;
+  bool compress_messages_;
+  /** Algorithm agreed on with the server, empty if none.  */
+  std::string compression_;
   std::unordered_map<std::string, MessageHandler> message_handlers_;
 
   QTextStream* output_stream_;
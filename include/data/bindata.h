@@ -22,6 +22,8 @@
 #include <stddef.h>
 #include <string.h>
 #include <initializer_list>
+#include <memory>
+#include <utility>
 
 namespace veles {
 namespace data {
@@ -36,7 +38,12 @@ namespace data {
 
     This class has value semantics, but copying large instances may be
     rather expensive - use references in this case, or extract a subrange
-    of in interesting data to pass around.  */
+    of in interesting data to pass around.
+
+    The raw data may also live in an external, refcounted buffer (see
+    fromSharedData) - copies and subranges of such instances share the
+    buffer, and each instance makes a private copy of its data the first
+    time it's modified.  */
 
 class BinData {
  public:
@@ -64,19 +71,34 @@ class BinData {
       setElement64(pos++, x);
   }
 
-  /** Constructs a BinData instance from another one.  */
+  /** Constructs a BinData instance from another one.  Shared data is not
+      copied.  */
   BinData(const BinData &other)
-    : BinData(other.width(), other.size(), other.rawData()) {}
+    : width_(other.width_), size_(other.size_), owner_(other.owner_) {
+    if (owner_) {
+      data_ = other.data_;
+    } else {
+      if (!isInline())
+        data_ = new uint8_t[octets()];
+      memcpy(storage(), other.storage(), octets());
+    }
+  }
 
   /** Deletes this instance's data and replaces it with that of another one.  */
   BinData &operator=(const BinData &other) {
-    if (!isInline())
-      delete[] data_;
+    if (this == &other)
+      return *this;
+    release();
     width_ = other.width_;
     size_ = other.size_;
-    if (!isInline())
-      data_ = new uint8_t[octets()];
-    memcpy(rawData(), other.rawData(), octets());
+    owner_ = other.owner_;
+    if (owner_) {
+      data_ = other.data_;
+    } else {
+      if (!isInline())
+        data_ = new uint8_t[octets()];
+      memcpy(storage(), other.storage(), octets());
+    }
     return *this;
   }
 
@@ -84,7 +106,8 @@ class BinData {
       The internal data storage is moved from the other instance if necessary,
       avoiding a new allocation and a copy.  */
   BinData(BinData &&other)
-    : width_(other.width_), size_(other.size_) {
+    : width_(other.width_), size_(other.size_),
+      owner_(std::move(other.owner_)) {
     if (isInline()) {
       memcpy(idata_, other.idata_, sizeof idata_);
     } else {
@@ -98,10 +121,12 @@ class BinData {
       The internal data storage is moved from the other instance if necessary,
       avoiding a new allocation and a copy.  The old data is destroyed.  */
   BinData &operator=(BinData &&other) {
-    if (!isInline())
-      delete[] data_;
+    if (this == &other)
+      return *this;
+    release();
     width_ = other.width_;
     size_ = other.size_;
+    owner_ = std::move(other.owner_);
     if (isInline()) {
       memcpy(idata_, other.idata_, sizeof idata_);
     } else {
@@ -138,10 +163,20 @@ class BinData {
     return res;
   }
 
+  /** Constructs a BinData instance referencing size elements of existing
+      raw data, without copying it.  owner keeps the memory alive for as long
+      as any instance refers to it, and the memory must not be modified
+      meanwhile.  Small instances are stored inline (and thus copied)
+      anyway.  */
+  static BinData fromSharedData(uint32_t width, size_t size,
+                                const uint8_t *data,
+                                std::shared_ptr<const void> owner) {
+    return BinData(width, size, data, std::move(owner));
+  }
+
   /** Destroys instance's storage, if necessary.  */
   ~BinData() {
-    if (!isInline())
-      delete[] data_;
+    release();
   }
 
   /** Returns element width, in bits.  */
@@ -157,28 +192,34 @@ class BinData {
   /** Returns raw data size, in octets. */
   size_t octets() const { return size_ * octetsPerElement(); }
 
+  /** Returns true iff the raw data lives in a buffer shared with other
+      instances or external code (see fromSharedData).  */
+  bool isShared() const { return owner_ != nullptr; }
+
   /** Returns a pointer to the raw data, starting from a given element
       (or from element 0 if not given).  Elements are contiguous in memory,
       with each element octetsPerElement() octets after the previous one.  */
   uint8_t *rawData(size_t el = 0) {
-    uint8_t *d = isInline() ? idata_ : data_;
-    return d + el * octetsPerElement();
+    detach();
+    return storage() + el * octetsPerElement();
   }
 
   /** Returns a pointer to the raw data, starting from a given element
       (or from element 0 if not given).  Elements are contiguous in memory,
       with each element octetsPerElement() octets after the previous one.  */
   const uint8_t *rawData(size_t el = 0) const {
-    const uint8_t *d = isInline() ? idata_ : data_;
-    return d + el * octetsPerElement();
+    return storage() + el * octetsPerElement();
   }
 
   /** Returns a subrange of data.  Both start and end are counted in elements
       from start of the array.  start is included in the returned range, end
-      is not included.  The result has the same width as this instance.  */
+      is not included.  The result has the same width as this instance,
+      and shares its data if this instance's data is shared.  */
   BinData data(size_t start, size_t end) const {
     assert(start <= end);
     assert(end <= size_);
+    if (owner_)
+      return BinData(width_, end - start, rawData(start), owner_);
     return BinData(width_, end - start, rawData(start));
   }
 
@@ -295,11 +336,49 @@ class BinData {
   uint32_t width_;
   size_t size_;
   union {
-    /** Pointer to raw data iff isInline() is false.  */
+    /** Pointer to raw data iff isInline() is false.  Points into memory
+        kept alive by owner_ if that is set, owned by this instance
+        otherwise.  */
     uint8_t *data_;
     /** The array containing raw data iff isInline() is true.  */
     uint8_t idata_[8];
   };
+  /** Keeps shared raw data alive.  Never set for inline instances.  */
+  std::shared_ptr<const void> owner_;
+
+  BinData(uint32_t width, size_t size, const uint8_t *data,
+          std::shared_ptr<const void> owner)
+    : width_(width), size_(size) {
+    assert(width != 0);
+    if (isInline()) {
+      memset(idata_, 0, sizeof idata_);
+      memcpy(idata_, data, octets());
+    } else {
+      data_ = const_cast<uint8_t *>(data);
+      owner_ = std::move(owner);
+    }
+  }
+
+  uint8_t *storage() { return isInline() ? idata_ : data_; }
+  const uint8_t *storage() const { return isInline() ? idata_ : data_; }
+
+  /** Frees owned raw data, or drops the reference to shared data.  */
+  void release() {
+    if (owner_)
+      owner_.reset();
+    else if (!isInline())
+      delete[] data_;
+  }
+
+  /** Replaces shared raw data with a private copy, before it's modified.  */
+  void detach() {
+    if (!owner_)
+      return;
+    uint8_t *copy = new uint8_t[octets()];
+    memcpy(copy, data_, octets());
+    data_ = copy;
+    owner_.reset();
+  }
   /** Returns true iff this instance has inline data, ie. stores the raw data
       directly in the instance (as opposed to new[]-allocated memory).  This
       is currently done for single-element arrays of up to 64-bit width.  */
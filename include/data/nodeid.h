@@ -16,9 +16,14 @@
  */
 #pragma once
 
-#include <random>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
 #include <vector>
 
+#include <QHash>
 #include <QString>
 #include <msgpack.hpp>
 
@@ -31,12 +36,13 @@ class NodeID {
 
  private:
   uint8_t value[WIDTH];
-  static std::mt19937 random_;
 
  public:
   static const uint8_t NIL_VALUE[WIDTH];
   static const uint8_t ROOT_VALUE[WIDTH];
 
+  /** Creates a new random ID.  Each thread has its own generator, so this
+      is cheap and safe to call from anywhere.  */
   NodeID();
   explicit NodeID(const uint8_t* data);
   explicit NodeID(const std::string& data);
@@ -45,14 +51,46 @@ class NodeID {
   QString toHexString() const;
   static std::shared_ptr<NodeID> fromHexString(QString& val);
   std::vector<uint8_t> asStdVector() const;
+  const uint8_t* data() const { return value; }
   // functions for more convenient getting of special values
   static std::shared_ptr<NodeID> getRootNodeId();
   static std::shared_ptr<NodeID> getNilId();
-  bool operator==(const NodeID& other) const;
-  bool operator!=(const NodeID& other) const;
-  bool operator<(const NodeID& other) const;
+  /** Mixes all the bytes of the ID into a word, for hash containers.  */
+  size_t hash() const {
+    uint64_t words[WIDTH / 8];
+    memcpy(words, value, WIDTH);
+    uint64_t h = words[0];
+    for (size_t i = 1; i < WIDTH / 8; i++) {
+      h = (h ^ words[i]) * 0x9e3779b97f4a7c15ULL;
+    }
+    return static_cast<size_t>(h ^ (h >> 32));
+  }
+  bool operator==(const NodeID& other) const {
+    return memcmp(value, other.value, WIDTH) == 0;
+  }
+  bool operator!=(const NodeID& other) const {
+    return !(*this == other);
+  }
+  bool operator<(const NodeID& other) const {
+    return memcmp(value, other.value, WIDTH) < 0;
+  }
   explicit operator bool() const;
 };
 
+inline uint qHash(const NodeID& id, uint seed = 0) {
+  return ::qHash(static_cast<quint64>(id.hash()), seed);
+}
+
 }  // namespace data
 }  // namespace veles
+
+namespace std {
+
+template<>
+struct hash<veles::data::NodeID> {
+  size_t operator()(const veles::data::NodeID& id) const {
+    return id.hash();
+  }
+};
+
+}  // namespace std
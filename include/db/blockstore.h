@@ -0,0 +1,104 @@
+/*
+ * Copyright 2017 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include <QMultiHash>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QWeakPointer>
+
+#include "data/bindata.h"
+
+namespace veles {
+namespace db {
+
+/** An immutable piece of blob data, shared by every blob which contains
+    the same bytes.  */
+class DataBlock {
+  friend class BlockStore;
+  uint8_t *data_;
+  size_t octets_;
+  uint hash_;
+
+  DataBlock(const uint8_t *data, size_t octets, uint hash);
+
+ public:
+  ~DataBlock() { delete[] data_; }
+  const uint8_t *data() const { return data_; }
+  size_t octets() const { return octets_; }
+};
+
+typedef QSharedPointer<const DataBlock> PDataBlock;
+
+/** Content-addressed store of data blocks.  Interning the same bytes
+    twice gives the same block, and a block is dropped once the last
+    blob using it lets go of it.  Thread-safe.  */
+class BlockStore {
+  struct Entry {
+    const DataBlock *block;
+    QWeakPointer<const DataBlock> ref;
+  };
+  QMutex mutex_;
+  QMultiHash<uint, Entry> blocks_;
+  uint64_t octets_;
+
+  BlockStore() : octets_(0) {}
+  static void release(DataBlock *block);
+
+ public:
+  static BlockStore *instance();
+  PDataBlock intern(const uint8_t *data, size_t octets);
+  /** Returns the number of unique octets held by the store.  */
+  uint64_t octets();
+};
+
+/** Blob data kept as a sequence of shared blocks.
+
+    Block boundaries are content-defined (picked by a rolling hash), so
+    identical regions of different blobs end up in the same blocks even
+    when they're at different offsets, and an edit only replaces the
+    blocks it touches.  */
+class BlockData {
+  uint32_t width_;
+  uint64_t size_;
+  std::vector<PDataBlock> blocks_;
+  // Element index at which each block starts.
+  std::vector<uint64_t> starts_;
+
+  unsigned octetsPerElement() const { return (width_ + 7) / 8; }
+  size_t blockAt(uint64_t pos) const;
+  void split(const uint8_t *data, size_t octets,
+             std::vector<PDataBlock> &out) const;
+
+ public:
+  BlockData() : width_(8), size_(0) {}
+  explicit BlockData(const data::BinData &data);
+  uint32_t width() const { return width_; }
+  uint64_t size() const { return size_; }
+  const std::vector<PDataBlock> &blocks() const { return blocks_; }
+  /** Copies out elements [start, end), clamped to the data size.  */
+  data::BinData data(uint64_t start, uint64_t end) const;
+  /** Replaces elements [start, end) with the given data, which may be of
+      a different size.  The width has to match.  */
+  void setData(uint64_t start, uint64_t end, const data::BinData &data);
+};
+
+}  // namespace db
+}  // namespace veles
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2017 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include <QObject>
+#include <QPointer>
+
+#include "db/getter.h"
+#include "db/types.h"
+
+namespace veles {
+namespace db {
+
+/** Carries requests into the database thread.
+
+    Requests are pushed onto a lock-free multi-producer single-consumer
+    queue and the database thread is woken up with a single event per
+    batch, instead of a queued signal and a fresh getter / runner object
+    per request.  Requests made from the database thread itself are run
+    directly.
+
+    Callbacks are called exactly once, usually on the database thread -
+    but method replies may come from another thread (eg. the parser one),
+    so they have to be thread-safe.  Subscriptions go through the same
+    queue, so that they are set up in order with the other requests made
+    by a thread, but reply through their own long-lived getters.  */
+class RequestChannel : public QObject {
+  struct Node {
+    std::atomic<Node *> next;
+  };
+
+  struct Slot : Node {
+    PLocalObject obj;
+    PInfoRequest info_req;
+    PMethodRequest method_req;
+    InfoCallback info_done;
+    MethodCallback method_done;
+    // Set for subscriptions, which have no callback.
+    QPointer<InfoGetter> sub_getter;
+    // Counted in the blob's pending writes until the slot is done.
+    bool blob_write;
+  };
+
+  // Producers push at head_, the database thread pops at tail_.
+  std::atomic<Node *> head_;
+  Node *tail_;
+  Node stub_;
+  std::atomic<bool> scheduled_;
+
+  std::mutex pool_mutex_;
+  std::vector<Slot *> pool_;
+
+  InfoGetter *getter_;
+  MethodRunner *runner_;
+
+  void push(Node *node);
+  Node *pop();
+  Slot *allocSlot();
+  void freeSlot(Slot *slot);
+  void enqueue(Slot *slot);
+  void dispatch(Slot *slot);
+  void drain();
+
+ protected:
+  bool event(QEvent *event) override;
+
+ public:
+  explicit RequestChannel(QObject *parent = nullptr);
+  ~RequestChannel();
+  void getInfo(PLocalObject obj, PInfoRequest req, InfoCallback done);
+  void runMethod(PLocalObject obj, PMethodRequest req, MethodCallback done);
+  /** Subscribes getter, which has to live on the database thread, to
+      the object.  */
+  void subInfo(PLocalObject obj, PInfoRequest req, InfoGetter *getter);
+};
+
+}  // namespace db
+}  // namespace veles
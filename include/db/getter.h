@@ -16,6 +16,8 @@
  */
 #pragma once
 
+#include <functional>
+
 #include <QObject>
 #include "db/types.h"
 #include "dbif/types.h"
@@ -23,8 +25,12 @@
 namespace veles {
 namespace db {
 
+typedef std::function<void(PInfoReply, PError)> InfoCallback;
+typedef std::function<void(PMethodReply, PError)> MethodCallback;
+
 class InfoGetter : public QObject {
   Q_OBJECT
+  InfoCallback callback_;
 
  signals:
   void gotInfo(veles::dbif::PInfoReply x);
@@ -32,18 +38,33 @@ class InfoGetter : public QObject {
   void getInfo(veles::db::PLocalObject obj, veles::db::InfoGetter *getter, veles::dbif::PInfoRequest req, bool once);
 
  public:
+  /** When a callback is set, replies are passed to it directly instead
+      of being emitted.  Returns the previous callback.  */
+  InfoCallback setCallback(InfoCallback callback) {
+    std::swap(callback, callback_);
+    return callback;
+  }
   template<typename Reply, typename... Args>
   void sendInfo(Args... args) {
-    emit gotInfo(QSharedPointer<Reply>::create(args...));
+    PInfoReply reply = QSharedPointer<Reply>::create(args...);
+    if (callback_)
+      callback_(reply, PError());
+    else
+      emit gotInfo(reply);
   }
   template<typename Err, typename... Args>
   void sendError(Args... args) {
-    emit gotError(QSharedPointer<Err>::create(args...));
+    PError err = QSharedPointer<Err>::create(args...);
+    if (callback_)
+      callback_(PInfoReply(), err);
+    else
+      emit gotError(err);
   }
 };
 
 class MethodRunner : public QObject {
   Q_OBJECT
+  MethodCallback callback_;
 
  signals:
   void gotResult(veles::dbif::PMethodReply x);
@@ -51,13 +72,26 @@ class MethodRunner : public QObject {
   void runMethod(veles::db::PLocalObject obj, veles::db::MethodRunner *runner, veles::dbif::PMethodRequest req);
 
  public:
+  /** Same as InfoGetter::setCallback.  */
+  MethodCallback setCallback(MethodCallback callback) {
+    std::swap(callback, callback_);
+    return callback;
+  }
   template<typename Err, typename... Args>
   void sendError(Args... args) {
-    emit gotError(QSharedPointer<Err>::create(args...));
+    PError err = QSharedPointer<Err>::create(args...);
+    if (callback_)
+      callback_(PMethodReply(), err);
+    else
+      emit gotError(err);
   }
   template<typename Reply, typename... Args>
   void sendResult(Args... args) {
-    emit gotResult(QSharedPointer<Reply>::create(args...));
+    PMethodReply reply = QSharedPointer<Reply>::create(args...);
+    if (callback_)
+      callback_(reply, PError());
+    else
+      emit gotResult(reply);
   }
   MethodRunner *forwarder(QThread *thread);
 };
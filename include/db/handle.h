@@ -27,6 +27,11 @@ class LocalObjectHandle : public dbif::ObjectHandleBase {
   Universe *db_;
   PLocalObject obj_;
   dbif::ObjectType type_;
+
+ protected:
+  PInfoReply baseSyncGetInfo(PInfoRequest req) override;
+  PMethodReply baseSyncRunMethod(PMethodRequest req) override;
+
  public:
   LocalObjectHandle(Universe *db, PLocalObject obj, dbif::ObjectType type) :
     db_(db), obj_(obj), type_(type) {}
@@ -36,6 +41,7 @@ class LocalObjectHandle : public dbif::ObjectHandleBase {
   dbif::ObjectType type() const override {
     return type_;
   }
+  bool canDeferChunks() const override { return true; }
   PLocalObject obj() const { return obj_; }
 };
 
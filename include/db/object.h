@@ -20,12 +20,17 @@
 
 #include <QSet>
 #include <QMap>
+#include <QReadWriteLock>
 #include <QtGlobal>
 #include <QEnableSharedFromThis>
 #include "dbif/universe.h"
 #include "dbif/types.h"
+#include "dbif/itemstore.h"
+#include "db/blockstore.h"
 #include "db/types.h"
+#include "db/storage.h"
 #include "data/bindata.h"
+#include "util/atom.h"
 
 namespace veles {
 namespace db {
@@ -37,9 +42,16 @@ class LocalObject : public QEnableSharedFromThis<LocalObject> {
   static std::atomic<uint64_t> static_id_;
   uint64_t id_;
   QSet<PLocalObject> children_;
-  QSet<InfoGetter *> children_watchers_;
+  // Values tell if the watcher accepts ChildrenAddedReply.
+  QMap<InfoGetter *, bool> children_watchers_;
   QSet<InfoGetter *> description_watchers_;
+  // Changes not yet sent to watchers, see Universe::scheduleUpdate.
+  QSet<PLocalObject> added_children_;
+  bool children_removed_;
+  bool children_dirty_;
+  bool description_dirty_;
   void children_reply(InfoGetter *getter);
+  void flush_children();
   void remove_description_watcher(InfoGetter * getter);
   void remove_children_watcher(InfoGetter * getter);
 
@@ -48,22 +60,29 @@ class LocalObject : public QEnableSharedFromThis<LocalObject> {
   void description_updated();
   virtual void children_updated();
   virtual void description_reply(InfoGetter *getter);
+  bool hasChildrenWatchers() const { return !children_watchers_.isEmpty(); }
 
  public:
-  LocalObject(Universe *db, QString name) : db_(db), name_(name), id_(++static_id_) {}
+  LocalObject(Universe *db, QString name) :
+    db_(db), name_(name), id_(++static_id_), children_removed_(false),
+    children_dirty_(false), description_dirty_(false) {}
   virtual ~LocalObject() { Q_ASSERT(dead()); }
   virtual void getInfo(InfoGetter *getter, PInfoRequest req, bool once);
   virtual void runMethod(MethodRunner *runner, PMethodRequest req);
   bool dead() const { return db_ == nullptr; }
   Universe *db() const { return db_; }
   void kill();
+  /** Sends coalesced updates to watchers.  Called by Universe.  */
+  virtual void flushUpdates();
   void addChild(PLocalObject obj);
+  void addChildren(const QList<PLocalObject> &objs);
   void delChild(PLocalObject obj);
   virtual dbif::ObjectType type() const = 0;
   QString name() const { return name_; }
   QString comment() const { return comment_; }
   uint64_t id() const { return id_; }
-  const QSet<PLocalObject>& children() { return children_; }
+  const QSet<PLocalObject>& children() const { return children_; }
+  void setName(QString name);
   void setComment(QString comment);
 };
 
@@ -85,17 +104,48 @@ class RootLocalObject : public LocalObject {
   }
 };
 
+/** Name and comment the user gave to a chunk which is about to be
+    re-created by its parser.  */
+struct ChunkLabel {
+  // Where the chunk starts after the edit.
+  uint64_t start;
+  QString chunk_type;
+  bool has_name;
+  QString name;
+  bool has_comment;
+  QString comment;
+};
+
 class DataBlobObject : public LocalObject {
   LocalObject *parent_;
-  data::BinData data_;
-  QMap<InfoGetter *, std::pair<uint64_t, uint64_t>> data_watchers_;
+  BlockData data_;
+  // Guards data_ against readers from outside of the database thread -
+  // the database thread itself only needs it for writing.
+  mutable QReadWriteLock data_lock_;
+  bool gone_;
+  // ChangeDataRequests queued for this blob but not applied yet.
+  std::atomic<int> pending_writes_;
+  struct DataWatch {
+    uint64_t start;
+    uint64_t end;
+    bool deltas;
+  };
+  QMap<InfoGetter *, DataWatch> data_watchers_;
 
   void data_reply(InfoGetter *getter, uint64_t start, uint64_t end);
+  /** Tells the watcher that [start, end) got replaced with
+      end - start + shift new bytes.  Sends a delta if the watcher accepts
+      them and it's worth it, nothing if its view didn't change.  */
+  void data_delta_reply(InfoGetter *getter, const DataWatch &watch,
+                        uint64_t start, uint64_t end, int64_t shift);
   void remove_data_watcher(InfoGetter *getter);
+  void reparse_changed(uint64_t start, uint64_t end, int64_t shift);
+  void applyLabels(const QList<ChunkLabel> &labels);
 
  protected:
   DataBlobObject(LocalObject *parent, const data::BinData &data, const QString &name) :
-    LocalObject(parent->db(), name), parent_(parent), data_(data) {}
+    LocalObject(parent->db(), name), parent_(parent), data_(data),
+    gone_(false), pending_writes_(0) {}
   void description_reply(InfoGetter *getter) override;
   void killed() override;
 
@@ -103,7 +153,17 @@ class DataBlobObject : public LocalObject {
   LocalObject *parent() { return parent_; }
   void getInfo(InfoGetter *getter, PInfoRequest req, bool once) override;
   void runMethod(MethodRunner *runner, PMethodRequest req) override;
-  const data::BinData &data() const { return data_; }
+  const BlockData &data() const { return data_; }
+  /** Answers a one-shot BlobDataRequest.  Unlike everything else here,
+      this can be called from any thread.  */
+  void readData(uint64_t start, uint64_t end, PInfoReply &reply,
+                PError &err) const;
+  /** Counts writes queued by RequestChannel.  readData() can only skip
+      the queue while there are none, or a thread could miss its own
+      earlier write.  */
+  void writeQueued() { pending_writes_++; }
+  void writeDone() { pending_writes_--; }
+  bool hasPendingWrites() const { return pending_writes_.load() != 0; }
 };
 
 class FileBlobObject : public DataBlobObject {
@@ -147,22 +207,57 @@ class SubBlobObject : public DataBlobObject {
 };
 
 class ChunkObject : public LocalObject {
+ public:
+  typedef std::vector<std::pair<uint64_t, uint64_t>> Ranges;
+
+ private:
   friend class QSharedPointer<ChunkObject>;
+  friend class DataBlobObject;
+  friend class ProjectReader;
+  friend class ProjectWriter;
   PLocalObject blob_;
   PLocalObject parent_chunk_;
   uint64_t start_;
   uint64_t end_;
-  QString chunk_type_;
-  std::vector<data::ChunkDataItem> items_;
-  std::vector<data::ChunkDataItem> parseReplyItems_;
+  util::Atom chunk_type_;
+  QString parser_id_;
+  dbif::ChunkItemStore items_;
+  std::vector<dbif::PDeferredChunk> deferred_;
+  // Set for chunks loaded from a project file until they're looked into.
+  StoredChunkBody stored_;
+  // Set if stored_ turned out to be corrupted - sent to everybody asking
+  // for the chunk's parse or children.
+  QString stored_error_;
+  // Sorted, disjoint blob ranges this chunk was parsed from.
+  Ranges deps_;
   QSet<InfoGetter *> parse_watchers_;
+  // parse_watchers_ need a new reply.
+  bool parse_dirty_;
+  // Name and comment were set by the user, not by the parser - they're
+  // carried over when the parser run gets redone.
+  bool user_name_;
+  bool user_comment_;
 
   ChunkObject(PLocalObject blob, PLocalObject parent_chunk,
-              uint64_t start, uint64_t end, const QString &chunk_type,
-              const QString &name) :
+              uint64_t start, uint64_t end, util::Atom chunk_type,
+              const QString &name, const QString &parser_id) :
     LocalObject(blob->db(), name), blob_(blob), parent_chunk_(parent_chunk),
-    start_(start), end_(end), chunk_type_(chunk_type) {}
-  void calcParseReplyItems();
+    start_(start), end_(end), chunk_type_(chunk_type), parser_id_(parser_id),
+    parse_dirty_(false), user_name_(false),
+    user_comment_(false) {
+    calcDeps();
+  }
+  /** Builds the parse reply - items_ plus subchunk and subblob items for
+      children not referred to by any of them.  Not cached, replies are
+      only wanted by the rare watcher.  */
+  std::vector<data::ChunkDataItem> parseReplyItems() const;
+  void calcDeps();
+  bool depsChanged(uint64_t start, uint64_t end) const;
+  void collectLabels(uint64_t start, uint64_t end, int64_t shift,
+                     QList<ChunkLabel> &labels);
+  void expandDeferred();
+  /** Returns false if the stored body is corrupted.  */
+  bool expandStored();
   void remove_parse_watcher(InfoGetter *getter);
 
  protected:
@@ -172,15 +267,17 @@ class ChunkObject : public LocalObject {
   virtual void parse_reply(InfoGetter *getter);
   void getInfo(InfoGetter *getter, PInfoRequest req, bool once) override;
   void runMethod(MethodRunner *runner, PMethodRequest req) override;
+  void flushUpdates() override;
   dbif::ObjectType type() const override { return dbif::CHUNK; }
   void killed() override;
 
  public:
   static PLocalObject create(PLocalObject blob, PLocalObject parent_chunk,
-                             uint64_t start, uint64_t end, const QString &chunk_type,
-                             const QString &name) {
+                             uint64_t start, uint64_t end, util::Atom chunk_type,
+                             const QString &name,
+                             const QString &parser_id = QString()) {
     PLocalObject res = QSharedPointer<ChunkObject>::create(blob, parent_chunk,
-      start, end, chunk_type, name);
+      start, end, chunk_type, name, parser_id);
     if (parent_chunk)
       parent_chunk->addChild(res);
     else
@@ -189,8 +286,21 @@ class ChunkObject : public LocalObject {
   }
   uint64_t start() const { return start_; }
   uint64_t end() const { return end_; }
-  QString chunkType() const { return chunk_type_; }
-  const std::vector<data::ChunkDataItem>& items() const { return items_; }
+  QString chunkType() const { return chunk_type_.toString(); }
+  PLocalObject parentChunk() const { return parent_chunk_; }
+  /** Id of the parser which created this chunk as the outermost chunk of
+      its run, empty for all other chunks.  */
+  QString parserId() const { return parser_id_; }
+  /** Collects the smallest parser runs in this subtree which need to be
+      redone after the blob changed in [start, end).  Returns true if
+      the part of this subtree not covered by any parser run is affected.
+      Data past the edit only moves, it doesn't make anything stale.  */
+  bool collectStale(uint64_t start, uint64_t end,
+                    QList<QSharedPointer<ChunkObject>> &stale);
+  /** Updates positions in this subtree after [start, end) got replaced
+      with end - start + shift bytes.  */
+  void move(uint64_t start, uint64_t end, int64_t shift);
+  const dbif::ChunkItemStore &itemStore() const { return items_; }
 };
 
 }  // namespace db
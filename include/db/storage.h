@@ -0,0 +1,78 @@
+/*
+ * Copyright 2017 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include <QFile>
+#include <QList>
+#include <QSharedPointer>
+#include <QString>
+
+#include "db/types.h"
+
+namespace veles {
+namespace db {
+
+/** A project snapshot, mapped into memory for as long as some of the
+    chunks loaded from it haven't been fully created yet.  */
+class ProjectFile {
+  QFile file_;
+  const uchar *data_;
+  qint64 size_;
+
+ public:
+  explicit ProjectFile(const QString &path);
+  ~ProjectFile();
+  /** Maps the file, returns false if it can't be done.  */
+  bool open();
+  const uchar *data() const { return data_; }
+  qint64 size() const { return size_; }
+};
+
+typedef QSharedPointer<ProjectFile> PProjectFile;
+
+/** Items and children of a chunk which still sit in a project file.  */
+struct StoredChunkBody {
+  PProjectFile file;
+  qint64 offset;
+  qint64 size;
+  // Covers every range the chunk's items and subtree were parsed from.
+  uint64_t start;
+  uint64_t end;
+  // Added to blob positions read from the body - the chunk got moved by
+  // edits in front of it since it was loaded.
+  int64_t shift;
+
+  StoredChunkBody() : offset(0), size(0), start(0), end(0), shift(0) {}
+  bool isNull() const { return file.isNull(); }
+};
+
+/** Writes all blobs in the database to a snapshot at the given path.
+    Chunks which haven't been loaded from an earlier snapshot yet are
+    copied over as they are.  Must be called on the database thread.  */
+bool saveProject(LocalObject *root, const QString &path, QString *error);
+
+/** Adds blobs from a snapshot to the database.  Only blobs and their
+    top-level chunks are created right away - items and children of
+    a chunk are read from the mapped file when the chunk is first looked
+    into.  Must be called on the database thread.  */
+bool loadProject(LocalObject *root, const QString &path,
+                 QList<PLocalObject> *blobs, QString *error);
+
+}  // namespace db
+}  // namespace veles
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <QObject>
+#include <QSet>
 #include <QStringList>
 #include "data/bindata.h"
 #include "db/types.h"
@@ -47,18 +48,26 @@ signals:
   void newParser(QString id);
 };
 
+class RequestChannel;
+
 class Universe : public QObject {
   Q_OBJECT
 
   PLocalObject root_;
   ParserWorker *parser_;
+  RequestChannel *channel_;
+  QSet<PLocalObject> dirty_;
+  bool flush_scheduled_;
 
  public slots:
   void getInfo(veles::db::PLocalObject obj, InfoGetter *getter, veles::dbif::PInfoRequest req, bool once);
   void runMethod(veles::db::PLocalObject obj, MethodRunner *runner, veles::dbif::PMethodRequest req);
 
+ private slots:
+  void flushUpdates();
+
  public:
-  Universe(ParserWorker *parser) : parser_(parser) {}
+  Universe(ParserWorker *parser);
   dbif::ObjectHandle handle(PLocalObject obj);
   void setRoot(PLocalObject root) { root_ = root; }
   ~Universe();
@@ -66,6 +75,12 @@ class Universe : public QObject {
     return parser_->thread();
   }
   ParserWorker* parser() {return parser_;}
+  RequestChannel *channel() { return channel_; }
+  /** Queues watcher updates of the given object.  Updates are sent at
+      most once per UPDATE_INTERVAL_MS, no matter how many changes were
+      made in the meantime.  */
+  void scheduleUpdate(PLocalObject obj);
+  static const int UPDATE_INTERVAL_MS = 20;
 
  signals:
   void parse(
@@ -0,0 +1,144 @@
+/*
+ * Copyright 2017 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+
+#include <QObject>
+
+#include "data/bindata.h"
+#include "dbif/types.h"
+
+namespace veles {
+namespace dbif {
+
+/** Client-side cache of a blob's data, fetched in fixed-size pages on
+    demand.
+
+    Cached pages stay subscribed, with deltas, so they follow changes to
+    the blob without refetching whole pages.  Once
+    the pages take more memory than the budget allows, the least recently
+    requested ones are dropped.  */
+class BlobPageCache : public QObject {
+  Q_OBJECT
+
+ public:
+  /** Page size, in elements.  */
+  static const uint64_t PAGE_SIZE = 0x10000;
+  /** Number of pages fetched ahead of each requested range.  */
+  static const uint64_t PREFETCH_PAGES = 4;
+  /** Default memory budget, in octets.  */
+  static const size_t DEFAULT_BUDGET = 64 * 1024 * 1024;
+
+  BlobPageCache(ObjectHandle blob, uint64_t size, unsigned width,
+                size_t budget = DEFAULT_BUDGET, QObject *parent = nullptr);
+
+  uint64_t size() const { return size_; }
+  unsigned width() const { return width_; }
+
+  /** Makes sure the pages covering elements [start, end), and a few pages
+      ahead of them, are cached or on their way.  */
+  void request(uint64_t start, uint64_t end);
+  /** Returns true iff all elements in [start, end) are cached.  */
+  bool isLoaded(uint64_t start, uint64_t end) const;
+  /** Stores a cached element in *value and returns true, or returns false
+      if its page hasn't arrived.  width() must be at most 64.  */
+  bool element(uint64_t pos, uint64_t *value) const;
+  /** Returns elements [start, end), which have to be cached.  */
+  data::BinData data(uint64_t start, uint64_t end) const;
+
+ signals:
+  /** Emitted when a requested page arrives.  */
+  void pageLoaded(qint64 start, qint64 end);
+  /** Emitted when elements [start, end) of a cached page change.  */
+  void pageChanged(qint64 start, qint64 end);
+
+ private:
+  struct Page {
+    InfoPromise *promise;
+    data::BinData data;
+    bool loaded;
+    uint64_t last_use;
+  };
+  typedef std::map<uint64_t, Page> PageMap;
+
+  ObjectHandle blob_;
+  uint64_t size_;
+  unsigned width_;
+  size_t budget_;
+  PageMap pages_;
+  uint64_t use_clock_;
+  /** Memory taken by all pages in pages_, including the ones still being
+      fetched.  */
+  size_t cached_octets_;
+
+  uint64_t pageCount() const;
+  size_t pageOctets(uint64_t page) const;
+  const Page *loadedPage(uint64_t page) const;
+  void fetch(uint64_t page);
+  void drop(PageMap::iterator iter);
+  void evict(uint64_t keep_first, uint64_t keep_last);
+  void gotPage(uint64_t page, PInfoReply reply);
+};
+
+/** Reads elements [start, end) of a blob in pieces of at most PIECE_SIZE
+    elements, so that even huge ranges are never fetched in one go or held
+    in memory whole.
+
+    Pieces are delivered in order through gotData().  The next piece is
+    requested only once the previous one has been handled, so a slow
+    consumer (eg. writing to a file) doesn't let the data pile up.
+    Like the dbif promises, the reader starts on construction and reports
+    back from the event loop.  It deletes itself after emitting finished()
+    or failed(); deleting it earlier (with deleteLater() from inside its
+    own signals) cancels the read.  */
+class BlobRangeReader : public QObject {
+  Q_OBJECT
+
+ public:
+  /** Piece size, in elements.  */
+  static const uint64_t PIECE_SIZE = 16 * BlobPageCache::PAGE_SIZE;
+
+  BlobRangeReader(ObjectHandle blob, uint64_t start, uint64_t end,
+                  QObject *parent = nullptr);
+
+  uint64_t start() const { return start_; }
+  uint64_t end() const { return end_; }
+
+ signals:
+  /** Emitted for each piece, pos is the position of its first element.  */
+  void gotData(qint64 pos, const veles::data::BinData &data);
+  void finished();
+  void failed(veles::dbif::PError error);
+
+ private:
+  ObjectHandle blob_;
+  uint64_t start_;
+  uint64_t end_;
+  /** Position of the next piece to request.  */
+  uint64_t pos_;
+
+ private slots:
+  void readNext();
+  void gotPiece(veles::dbif::PInfoReply reply);
+  void gotError(veles::dbif::PError error);
+};
+
+}  // namespace dbif
+}  // namespace veles
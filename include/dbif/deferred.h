@@ -0,0 +1,75 @@
+/*
+ * Copyright 2017 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <QString>
+#include <QWeakPointer>
+
+#include "dbif/itemstore.h"
+#include "dbif/types.h"
+#include "dbif/universe.h"
+#include "util/atom.h"
+
+namespace veles {
+namespace dbif {
+
+/** A chunk subtree recorded by a parser, but not created in the database
+    yet.  Deferred chunks are handed over to the database together with
+    the parse of their nearest real ancestor and turned into proper chunk
+    objects only when someone asks for that ancestor's children or parse
+    data.  */
+struct DeferredChunk {
+  uint64_t start;
+  uint64_t end;
+  util::Atom type;
+  QString name;
+  QString comment;
+  // Kept packed - a parser may leave a lot of these behind.
+  ChunkItemStore items;
+  std::vector<PDeferredChunk> children;
+  // Nearest ancestor which exists in the database.  Weak - the record ends
+  // up stored in that very chunk, a strong handle would keep both alive
+  // for good.  The parser holds on to the chunks it created while it runs.
+  QWeakPointer<ObjectHandleBase> anchor;
+  // Set once the record has been sent to the database - from then on
+  // it belongs to the database thread, which moves it along with blob
+  // edits.
+  bool shipped;
+
+  DeferredChunk(uint64_t start, util::Atom type, const QString &name) :
+    start(start), end(start), type(type), name(name), shipped(false) {}
+};
+
+/** Handle given out by parsers for deferred chunks.  It only identifies
+    the chunk (ie. in SUBCHUNK items and as a parent for nested streams) -
+    all requests made through it fail with ObjectInvalidRequestError.  */
+class DeferredChunkHandle : public ObjectHandleBase {
+  PDeferredChunk record_;
+
+ public:
+  explicit DeferredChunkHandle(PDeferredChunk record) : record_(record) {}
+  InfoPromise *getInfo(PInfoRequest req) override;
+  InfoPromise *subInfo(PInfoRequest req) override;
+  MethodResultPromise *runMethod(PMethodRequest req) override;
+  ObjectType type() const override { return CHUNK; }
+  PDeferredChunk record() const { return record_; }
+};
+
+}  // namespace dbif
+}  // namespace veles
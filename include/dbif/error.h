@@ -37,6 +37,10 @@ struct ObjectInvalidRequestError : Error {};
 struct BlobDataInvalidRangeError : Error {};
 struct BlobDataInvalidWidthError : Error {};
 struct InvalidTypeError : Error {};
+struct ProjectFileError : Error {
+  QString message;
+  explicit ProjectFileError(const QString &message) : message(message) {}
+};
 
 }  // namespace dbif
 }  // namespace veles
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <algorithm>
 #include <vector>
 #include <QString>
 
@@ -46,6 +47,10 @@ struct DescriptionRequest : InfoRequest {
 };
 
 struct ChildrenRequest : InfoRequest {
+  // If set, subscribers may get ChildrenAddedReply instead of full
+  // ChildrenReply when children are only added.
+  const bool deltas;
+  explicit ChildrenRequest(bool deltas = false) : deltas(deltas) {}
   typedef ChildrenReply ReplyType;
 };
 
@@ -56,8 +61,11 @@ struct ParsersListRequest : InfoRequest {
 struct BlobDataRequest : InfoRequest {
   const uint64_t start;
   const uint64_t end;
-  explicit BlobDataRequest(uint64_t start, uint64_t end) :
-    start(start), end(end) {}
+  // If set, subscribers may get BlobDataDeltaReply instead of full
+  // BlobDataReply after the data changes.
+  const bool deltas;
+  explicit BlobDataRequest(uint64_t start, uint64_t end, bool deltas = false) :
+    start(start), end(end), deltas(deltas) {}
   typedef BlobDataReply ReplyType;
 };
 
@@ -128,6 +136,13 @@ struct ChildrenReply : InfoReply {
     objects(objects) {}
 };
 
+/** Lists children added since the previous reply.  */
+struct ChildrenAddedReply : InfoReply {
+  const std::vector<ObjectHandle> objects;
+  explicit ChildrenAddedReply(const std::vector<ObjectHandle> &objects) :
+    objects(objects) {}
+};
+
 struct ParsersListReply : InfoReply  {
   const QStringList parserIds;
   explicit ParsersListReply(const QStringList &ids) :
@@ -139,7 +154,40 @@ struct BlobDataReply : InfoReply {
   BlobDataReply(const data::BinData &data) :
     data(data) {}
   BlobDataReply(data::BinData &&data) :
-    data(data) {}
+    data(std::move(data)) {}
+};
+
+/** Describes a change within a watched data range: removed elements
+    starting at start (relative to the watched range) were replaced with
+    inserted, and the range is now size elements long.  */
+struct BlobDataDeltaReply : InfoReply {
+  uint64_t start;
+  uint64_t removed;
+  data::BinData inserted;
+  uint64_t size;
+  BlobDataDeltaReply(uint64_t start, uint64_t removed,
+                     const data::BinData &inserted, uint64_t size) :
+    start(start), removed(removed), inserted(inserted), size(size) {}
+
+  /** Applies the change to the previous contents of the range.  */
+  void apply(data::BinData &data) const {
+    if (removed == inserted.size() && size == data.size()) {
+      data.setData(start, start + removed, inserted);
+      return;
+    }
+    data::BinData res(data.width(), size);
+    uint64_t head = std::min(start, size);
+    res.setData(0, head, data.data(0, head));
+    uint64_t mid = std::min(start + inserted.size(), size);
+    if (mid > head) {
+      res.setData(head, mid, inserted.data(0, mid - head));
+    }
+    if (size > mid) {
+      uint64_t tail = start + removed;
+      res.setData(mid, size, data.data(tail, tail + size - mid));
+    }
+    std::swap(data, res);
+  }
 };
 
 struct ChunkDataReply : InfoReply {
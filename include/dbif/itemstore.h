@@ -0,0 +1,100 @@
+/*
+ * Copyright 2017 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "data/field.h"
+#include "dbif/types.h"
+#include "util/atom.h"
+
+namespace veles {
+namespace dbif {
+
+/** Compact storage for the parse items of a chunk.
+
+    A ChunkDataItem is a couple hundred bytes plus a few heap blocks, most
+    of it unused for any given item type.  Here every item is a small
+    fixed-size entry: names are atoms, field formats (repacker + high
+    type) are stored once per chunk and referred to by index, raw values
+    of all items share one octet arena, and references live in one
+    handle array.  Items are turned back into ChunkDataItems only when someone
+    asks for them.  */
+class ChunkItemStore {
+  static const uint32_t NO_FORMAT = 0xffffffff;
+
+  struct Entry {
+    uint64_t start;
+    uint64_t end;
+    uint64_t num_elements;
+    uint64_t value_size;
+    uint64_t value_offset;
+    uint32_t value_width;
+    util::Atom name;
+    uint32_t ref_first;
+    uint32_t ref_count;
+    uint32_t format;
+    uint8_t type;
+  };
+
+  struct Format {
+    data::Repacker repack;
+    data::FieldHighType high_type;
+  };
+
+  std::vector<Entry> entries_;
+  std::vector<Format> formats_;
+  std::vector<uint8_t> values_;
+  std::vector<ObjectHandle> refs_;
+
+  uint32_t addFormat(const data::ChunkDataItem &item);
+
+ public:
+  void assign(const std::vector<data::ChunkDataItem> &items);
+  size_t size() const { return entries_.size(); }
+  bool empty() const { return entries_.empty(); }
+  data::ChunkDataItem::ChunkDataItemType type(size_t idx) const {
+    return data::ChunkDataItem::ChunkDataItemType(entries_[idx].type);
+  }
+  uint64_t start(size_t idx) const { return entries_[idx].start; }
+  uint64_t end(size_t idx) const { return entries_[idx].end; }
+  void setRange(size_t idx, uint64_t start, uint64_t end) {
+    entries_[idx].start = start;
+    entries_[idx].end = end;
+  }
+  size_t refCount(size_t idx) const { return entries_[idx].ref_count; }
+  ObjectHandle ref(size_t idx, size_t num) const {
+    return refs_[entries_[idx].ref_first + num];
+  }
+  void setRef(size_t idx, size_t num, ObjectHandle ref) {
+    refs_[entries_[idx].ref_first + num] = ref;
+  }
+  data::ChunkDataItem item(size_t idx) const;
+  std::vector<data::ChunkDataItem> items() const;
+
+  /** Tells if start and end of items of the given type are blob
+      positions - bitfields count bits of their field instead.  */
+  static bool hasBlobRange(data::ChunkDataItem::ChunkDataItemType type) {
+    return type == data::ChunkDataItem::SUBCHUNK ||
+        type == data::ChunkDataItem::FIELD ||
+        type == data::ChunkDataItem::PAD;
+  }
+};
+
+}  // namespace dbif
+}  // namespace veles
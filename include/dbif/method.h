@@ -38,6 +38,7 @@ struct MethodRequest {
 
 struct CreatedReply;
 struct NullReply;
+struct ProjectLoadedReply;
 
 struct RootCreateFileBlobFromDataRequest : MethodRequest {
   data::BinData data;
@@ -49,17 +50,35 @@ struct RootCreateFileBlobFromDataRequest : MethodRequest {
   typedef CreatedReply ReplyType;
 };
 
+// Writes all blobs, chunks and comments to a project file.
+struct RootSaveProjectRequest : MethodRequest {
+  QString path;
+  explicit RootSaveProjectRequest(const QString &path) : path(path) {}
+  typedef NullReply ReplyType;
+};
+
+// Adds everything from a project file to the database.
+struct RootLoadProjectRequest : MethodRequest {
+  QString path;
+  explicit RootLoadProjectRequest(const QString &path) : path(path) {}
+  typedef ProjectLoadedReply ReplyType;
+};
+
 struct ChunkCreateRequest : MethodRequest {
   QString name;
   QString chunk_type;
   ObjectHandle parent_chunk;
   uint64_t start;
   uint64_t end;
+  // Set for the outermost chunk of a parser run - makes the database re-run
+  // that parser when data the chunk was parsed from changes.
+  QString parser_id;
   explicit ChunkCreateRequest(const QString &name, const QString &chunk_type,
                               ObjectHandle parent_chunk,
-                              uint64_t start, uint64_t end) :
+                              uint64_t start, uint64_t end,
+                              const QString &parser_id = QString()) :
     name(name), chunk_type(chunk_type), parent_chunk(parent_chunk),
-    start(start), end(end) {}
+    start(start), end(end), parser_id(parser_id) {}
   typedef CreatedReply ReplyType;
 };
 
@@ -85,7 +104,11 @@ struct SetNameRequest : MethodRequest {
 
 struct SetCommentRequest : MethodRequest {
   QString comment;
-  explicit SetCommentRequest(const QString &comment): comment(comment) {}
+  // Comments from anywhere but parsers are the user's, and are carried
+  // over when the chunk gets re-parsed.
+  bool from_parser;
+  explicit SetCommentRequest(const QString &comment, bool from_parser = false):
+    comment(comment), from_parser(from_parser) {}
   typedef NullReply ReplyType;
 };
 
@@ -114,9 +137,12 @@ struct SetChunkParseRequest : MethodRequest {
   uint64_t start;
   uint64_t end;
   std::vector<data::ChunkDataItem> items;
+  // Child chunks which the database should create on first access.
+  std::vector<PDeferredChunk> deferred;
   SetChunkParseRequest(uint64_t start, uint64_t end,
-    std::vector<data::ChunkDataItem> items) :
-    start(start), end(end), items(items) {}
+    std::vector<data::ChunkDataItem> items,
+    std::vector<PDeferredChunk> deferred = std::vector<PDeferredChunk>()) :
+    start(start), end(end), items(items), deferred(deferred) {}
   typedef NullReply ReplyType;
 };
 
@@ -146,5 +172,12 @@ struct CreatedReply : MethodReply {
   explicit CreatedReply(ObjectHandle object) : object(object) {}
 };
 
+struct ProjectLoadedReply : MethodReply {
+  // File blobs read from the project.
+  const std::vector<ObjectHandle> blobs;
+  explicit ProjectLoadedReply(const std::vector<ObjectHandle> &blobs) :
+    blobs(blobs) {}
+};
+
 }  // namespace dbif
 }  // namespace veles
@@ -16,16 +16,47 @@
  */
 #pragma once
 
+#include <mutex>
+
 #include <QObject>
+#include <QEvent>
 
 #include "dbif/types.h"
 
 namespace veles {
 namespace dbif {
 
+/** Lets a reply be posted to a promise from any thread without keeping
+    the promise alive - if the promise is already gone, the reply is
+    dropped.  */
+struct PromiseLink {
+  std::mutex mutex;
+  QObject *target;
+
+  explicit PromiseLink(QObject *target) : target(target) {}
+  void post(QEvent *event);
+  void reset();
+};
+
+typedef QSharedPointer<PromiseLink> PPromiseLink;
+
 class InfoPromise : public QObject {
   Q_OBJECT
 
+ public:
+  InfoPromise();
+  ~InfoPromise();
+  /** Returns a link which can be used to resolve this promise once from
+      any thread with deliver().  The promise deletes itself afterwards.  */
+  PPromiseLink link() const { return link_; }
+  static void deliver(const PPromiseLink &link, PInfoReply reply, PError err);
+
+ protected:
+  bool event(QEvent *event) override;
+
+ private:
+  PPromiseLink link_;
+
  signals:
   void gotInfo(veles::dbif::PInfoReply x);
   void gotError(veles::dbif::PError x);
@@ -34,6 +65,20 @@ class InfoPromise : public QObject {
 class MethodResultPromise : public QObject {
   Q_OBJECT
 
+ public:
+  MethodResultPromise();
+  ~MethodResultPromise();
+  /** Same as InfoPromise::link().  */
+  PPromiseLink link() const { return link_; }
+  static void deliver(const PPromiseLink &link, PMethodReply reply,
+                      PError err);
+
+ protected:
+  bool event(QEvent *event) override;
+
+ private:
+  PPromiseLink link_;
+
  signals:
   void gotResult(veles::dbif::PMethodReply x);
   void gotError(veles::dbif::PError x);
@@ -27,6 +27,7 @@ struct InfoReply;
 struct MethodRequest;
 struct MethodReply;
 struct Error;
+struct DeferredChunk;
 class InfoPromise;
 class MethodResultPromise;
 typedef QSharedPointer<InfoRequest> PInfoRequest;
@@ -34,6 +35,7 @@ typedef QSharedPointer<InfoReply> PInfoReply;
 typedef QSharedPointer<MethodRequest> PMethodRequest;
 typedef QSharedPointer<MethodReply> PMethodReply;
 typedef QSharedPointer<Error> PError;
+typedef QSharedPointer<DeferredChunk> PDeferredChunk;
 
 enum ObjectType {
   ROOT,
@@ -30,7 +30,11 @@ namespace veles {
 namespace dbif {
 
 class ObjectHandleBase {
-  PInfoReply baseSyncGetInfo(PInfoRequest req) {
+ protected:
+  /** Generic blocking calls - they spin the event loop of the calling
+      thread until the reply arrives.  Handles which can do better should
+      override them.  */
+  virtual PInfoReply baseSyncGetInfo(PInfoRequest req) {
     QPointer<InfoPromise> promise = getInfo(req);
     PInfoReply res;
     PError err;
@@ -55,7 +59,7 @@ class ObjectHandleBase {
     }
   }
 
-  PMethodReply baseSyncRunMethod(PMethodRequest req) {
+  virtual PMethodReply baseSyncRunMethod(PMethodRequest req) {
     QPointer<MethodResultPromise> promise = runMethod(req);
     PMethodReply res;
     PError err;
@@ -87,6 +91,9 @@ class ObjectHandleBase {
   virtual InfoPromise *subInfo(PInfoRequest req) = 0;
   virtual MethodResultPromise *runMethod(PMethodRequest req) = 0;
   virtual ObjectType type() const = 0;
+  // True if SetChunkParseRequest sent through this handle may carry
+  // deferred chunks.
+  virtual bool canDeferChunks() const { return false; }
 
   template<typename Request, typename... Args>
   QSharedPointer<typename Request::ReplyType> syncGetInfo(Args... args) {
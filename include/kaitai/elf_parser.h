@@ -7,6 +7,7 @@ public:
     ElfParser() : parser::Parser("elf (ksy)") {}
     void parse(dbif::ObjectHandle blob, uint64_t start = 0, 
     dbif::ObjectHandle parent_chunk = dbif::ObjectHandle()) override {
+        parser::LazyChunksScope lazy_chunks;
         try {
             auto stream = kaitai::kstream(blob, start, parent_chunk);
             auto parser = kaitai::elf::elf_t(&stream);
@@ -27,6 +27,16 @@
 namespace veles {
 namespace kaitai {
 
+/** Non-owning view of bytes read from a kstream.  It's only valid until
+    the next read from the same stream.  */
+struct bytes_view {
+  const uint8_t *data;
+  size_t size;
+
+  const uint8_t *begin() const { return data; }
+  const uint8_t *end() const { return data + size; }
+};
+
 /**
  * Kaitai Stream class (veles::kaitai::kstream) is an implementation of
  * Kaitai Struct stream API for Veles.
@@ -84,7 +94,13 @@ class kstream {
   std::vector<uint8_t> read_bytes_full();
   std::vector<uint8_t> ensure_fixed_contents(std::string);
 
-  static std::string bytes_to_string(std::vector<uint8_t>, const char *);
+  static std::string bytes_to_string(const std::vector<uint8_t> &,
+                                     const char *);
+
+  /** Zero-copy variants of read_bytes / read_bytes_full */
+  bytes_view read_bytes_view(size_t);
+  bytes_view read_bytes_full_view();
+  static std::string bytes_to_string(bytes_view, const char *);
 
   /** addiational methods required by Veles */
   void pushName(const char *);
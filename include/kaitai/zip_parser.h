@@ -2,14 +2,27 @@
 #include "kaitai/zip.h"
 namespace veles {
 namespace kaitai {
+
+/**
+ * Creates a sub-blob with decompressed contents for every stored or
+ * deflated member of an already parsed ZIP archive.  Member list is taken
+ * from the central directory (falling back to local file headers if there
+ * is none) and the decompression itself runs on the "parser" thread pool
+ * topic, a bounded batch of members at a time.  Sub-blobs are attached to
+ * the corresponding local_file chunks.
+ */
+void inflateZipMembers(zip::zip_t *zip, dbif::ObjectHandle blob,
+                       uint64_t start);
+
 class ZipParser : public parser::Parser {
 public:
     ZipParser() : parser::Parser("zip (ksy)") {}
-    void parse(dbif::ObjectHandle blob, uint64_t start = 0, 
+    void parse(dbif::ObjectHandle blob, uint64_t start = 0,
     dbif::ObjectHandle parent_chunk = dbif::ObjectHandle()) override {
         try {
             auto stream = kaitai::kstream(blob, start, parent_chunk);
             auto parser = kaitai::zip::zip_t(&stream);
+            inflateZipMembers(&parser, blob, start);
         } catch(std::exception) {}
     }
 };
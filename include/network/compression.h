@@ -0,0 +1,54 @@
+/*
+ * Copyright 2017 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace veles {
+namespace messages {
+
+/** Packed messages smaller than this are always sent uncompressed - for
+    them the compression overhead isn't worth it.  */
+const size_t COMPRESSION_THRESHOLD = 1024;
+
+/** Decompressed messages bigger than this are rejected, so that a tiny
+    message can't make us allocate gigabytes.  */
+const size_t MAX_DECOMPRESSED_SIZE = 256 * 1024 * 1024;
+
+/** Names of the supported compression algorithms, most preferred first,
+    as used in MsgSetCompression.  */
+std::vector<std::string> compressionAlgorithms();
+
+bool compressionSupported(const std::string& algorithm);
+
+/** Compresses size bytes at data into out.  Returns false, leaving out
+    untouched, if data is below COMPRESSION_THRESHOLD or doesn't get any
+    smaller.  */
+bool compress(const std::string& algorithm, const char* data, size_t size,
+              std::vector<uint8_t>* out);
+
+/** Throws proto::SchemaError for an unknown algorithm, corrupted data or
+    data decompressing to more than max_size bytes.  */
+std::vector<uint8_t> decompress(const std::string& algorithm,
+                                const std::vector<uint8_t>& data,
+                                size_t max_size = MAX_DECOMPRESSED_SIZE);
+
+}  // namespace messages
+}  // namespace veles
@@ -0,0 +1,172 @@
+/*
+ * Copyright 2017 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#pragma once
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <msgpack.hpp>
+
+#include "fwd_models.h"
+#include "data/bindata.h"
+#include "data/nodeid.h"
+#include "network/msgpackobject.h"
+#include "proto/exceptions.h"
+
+namespace veles {
+namespace messages {
+
+// Direct conversions between msgpack::object / MsgpackPacker and model
+// fields.  Unlike fromMsgpackObject / toMsgpackObject, these don't build
+// an intermediate MsgpackObject tree - the generated models use them for
+// everything that goes over the wire.  Type mismatches throw
+// proto::SchemaError.
+
+void fromMsgpack(const msgpack::object& obj, bool& out);
+void fromMsgpack(const msgpack::object& obj, int64_t& out);
+void fromMsgpack(const msgpack::object& obj, uint64_t& out);
+void fromMsgpack(const msgpack::object& obj, double& out);
+void fromMsgpack(const msgpack::object& obj, std::shared_ptr<std::string>& out);
+void fromMsgpack(const msgpack::object& obj, std::shared_ptr<std::vector<uint8_t>>& out);
+void fromMsgpack(const msgpack::object& obj, std::shared_ptr<data::NodeID>& out);
+void fromMsgpack(const msgpack::object& obj, std::shared_ptr<data::BinData>& out);
+void fromMsgpack(const msgpack::object& obj, std::shared_ptr<proto::VelesException>& out);
+void fromMsgpack(const msgpack::object& obj, std::shared_ptr<MsgpackObject>& out);
+
+/** While alive, BinData fields decoded on the current thread reference
+    their payload in the given zone instead of copying it out, as long as
+    the payload is large enough to be worth it.  The zone has to keep alive
+    all memory of the objects being decoded - a zone released from an
+    object_handle does, including the unpacker buffer it references.  */
+class SharedZoneScope {
+  const std::shared_ptr<msgpack::zone> *saved_;
+  std::shared_ptr<msgpack::zone> zone_;
+
+ public:
+  explicit SharedZoneScope(std::shared_ptr<msgpack::zone> zone);
+  ~SharedZoneScope();
+};
+
+void toMsgpack(MsgpackPacker& pk, bool val);
+void toMsgpack(MsgpackPacker& pk, int64_t val);
+void toMsgpack(MsgpackPacker& pk, uint64_t val);
+void toMsgpack(MsgpackPacker& pk, double val);
+void toMsgpack(MsgpackPacker& pk, const std::string& val);
+void toMsgpack(MsgpackPacker& pk, const std::shared_ptr<std::string> val);
+void toMsgpack(MsgpackPacker& pk, const std::shared_ptr<std::vector<uint8_t>> val);
+void toMsgpack(MsgpackPacker& pk, const std::shared_ptr<data::NodeID> val);
+void toMsgpack(MsgpackPacker& pk, const std::shared_ptr<data::BinData> val);
+void toMsgpack(MsgpackPacker& pk, const std::shared_ptr<proto::VelesException> val);
+void toMsgpack(MsgpackPacker& pk, const std::shared_ptr<MsgpackObject> val);
+
+namespace details_ {
+
+inline void checkType(const msgpack::object& obj, msgpack::type::object_type type,
+                      const char* what) {
+  if (obj.type != type) {
+    throw proto::SchemaError(std::string("Wrong msgpack type when trying to get ") + what);
+  }
+}
+
+/** Used by the generated code for field names and enum values.  */
+template <size_t N>
+bool strEquals(const msgpack::object& obj, const char (&str)[N]) {
+  return obj.type == msgpack::type::STR && obj.via.str.size == N - 1 &&
+      memcmp(obj.via.str.ptr, str, N - 1) == 0;
+}
+
+template <size_t N>
+void packStr(MsgpackPacker& pk, const char (&str)[N]) {
+  pk.pack_str(static_cast<uint32_t>(N - 1));
+  pk.pack_str_body(str, static_cast<uint32_t>(N - 1));
+}
+
+}  // namespace details_
+
+template <class T>
+void fromMsgpack(const msgpack::object& obj, std::shared_ptr<std::vector<T>>& out) {
+  details_::checkType(obj, msgpack::type::ARRAY, "array");
+  out = std::make_shared<std::vector<T>>();
+  out->reserve(obj.via.array.size);
+  for (uint32_t i = 0; i < obj.via.array.size; i++) {
+    T conv;
+    fromMsgpack(obj.via.array.ptr[i], conv);
+    out->push_back(conv);
+  }
+}
+
+template <class T>
+void fromMsgpack(const msgpack::object& obj, std::shared_ptr<std::unordered_set<T>>& out) {
+  details_::checkType(obj, msgpack::type::ARRAY, "array");
+  out = std::make_shared<std::unordered_set<T>>();
+  for (uint32_t i = 0; i < obj.via.array.size; i++) {
+    T conv;
+    fromMsgpack(obj.via.array.ptr[i], conv);
+    out->insert(conv);
+  }
+}
+
+template <class T>
+void fromMsgpack(const msgpack::object& obj, std::shared_ptr<std::unordered_map<std::string, T>>& out) {
+  details_::checkType(obj, msgpack::type::MAP, "map");
+  out = std::make_shared<std::unordered_map<std::string, T>>();
+  for (uint32_t i = 0; i < obj.via.map.size; i++) {
+    const msgpack::object_kv& kv = obj.via.map.ptr[i];
+    details_::checkType(kv.key, msgpack::type::STR, "string");
+    T conv;
+    fromMsgpack(kv.val, conv);
+    (*out)[std::string(kv.key.via.str.ptr, kv.key.via.str.size)] = conv;
+  }
+}
+
+template <class T>
+void toMsgpack(MsgpackPacker& pk, const std::shared_ptr<std::vector<T>> val) {
+  if (!val)
+    throw proto::SchemaError("Unexpected nullptr");
+  pk.pack_array(static_cast<uint32_t>(val->size()));
+  for (const auto& el : *val) {
+    toMsgpack(pk, el);
+  }
+}
+
+template <class T>
+void toMsgpack(MsgpackPacker& pk, const std::shared_ptr<std::unordered_set<T>> val) {
+  if (!val)
+    throw proto::SchemaError("Unexpected nullptr");
+  pk.pack_array(static_cast<uint32_t>(val->size()));
+  for (const auto& el : *val) {
+    toMsgpack(pk, el);
+  }
+}
+
+template <class T>
+void toMsgpack(MsgpackPacker& pk, const std::shared_ptr<std::unordered_map<std::string, T>> val) {
+  if (!val)
+    throw proto::SchemaError("Unexpected nullptr");
+  pk.pack_map(static_cast<uint32_t>(val->size()));
+  for (const auto& el : *val) {
+    toMsgpack(pk, el.first);
+    toMsgpack(pk, el.second);
+  }
+}
+
+}  // namespace messages
+}  // namespace veles
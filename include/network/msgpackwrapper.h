@@ -17,10 +17,12 @@
 #pragma once
 
 #include <cstdint>
+#include <cstring>
 
 #include <msgpack.hpp>
-#include <QtNetwork/QTcpSocket>
+#include <QIODevice>
 
+#include "network/msgpackcodec.h"
 #include "network/msgpackobject.h"
 #include "proto/exceptions.h"
 #include "models.h"
@@ -30,36 +32,74 @@ namespace messages {
 
 class MsgpackWrapper {
   msgpack::unpacker unp_;
-  static const int READ_SIZE_ = 1024;
+  /** Smallest read done when the device doesn't report how much it has
+      buffered (eg. sequential devices without a read buffer).  */
+  static const qint64 MIN_READ_SIZE_ = 64 * 1024;
 
  public:
   static std::shared_ptr<proto::MsgpackMsg> parseMessage(msgpack::object_handle* handle) {
     msgpack::object obj = handle->get();
+    // Large BinData payloads in the message keep referencing the zone (and
+    // the unpacker buffer behind it) instead of being copied out of it.
+    SharedZoneScope scope(
+        std::shared_ptr<msgpack::zone>(std::move(handle->zone())));
     return proto::MsgpackMsg::polymorphicLoad(obj);
   }
 
-  template <class Packer, class T>
-  static void dumpObject(Packer& pk, std::shared_ptr<T> ptr) {
-    auto mss = toMsgpackObject(ptr);
-    pk.pack(mss);
+  template <class T>
+  static void dumpObject(MsgpackPacker& pk, std::shared_ptr<T> ptr) {
+    toMsgpack(pk, ptr);
   }
 
-  std::shared_ptr<proto::MsgpackMsg> loadMessage(QTcpSocket* connection) {
-    // This method can throw msgpack::type_error when malformed message is read
+  /** Moves everything the device has buffered into the unpacker, in a single
+      read.  While a message is incomplete, at least as much space as it
+      already takes is reserved, so the buffer of a big message grows
+      geometrically instead of with every read.  Returns false if nothing
+      was read.  */
+  bool readAvailable(QIODevice* device) {
+    qint64 size = device->bytesAvailable();
+    if (size < MIN_READ_SIZE_) {
+      size = MIN_READ_SIZE_;
+    }
+    if (size < static_cast<qint64>(unp_.nonparsed_size())) {
+      size = static_cast<qint64>(unp_.nonparsed_size());
+    }
+    unp_.reserve_buffer(static_cast<size_t>(size));
+    qint64 read = device->read(unp_.buffer(), size);
+    if (read <= 0) {
+      return false;
+    }
+    unp_.buffer_consumed(static_cast<size_t>(read));
+    return true;
+  }
+
+  /** Like readAvailable(), but takes the data from memory - used for
+      the contents of compressed messages.  */
+  void feed(const uint8_t* data, size_t size) {
+    unp_.reserve_buffer(size);
+    memcpy(unp_.buffer(), data, size);
+    unp_.buffer_consumed(size);
+  }
+
+  /** Returns the next complete message already read by readAvailable()
+      or feed(), or nullptr if there is none.  This method can throw
+      msgpack::type_error when malformed message is read, or
+      proto::SchemaError when the message doesn't match its schema - the
+      message is skipped in the latter case.  */
+  std::shared_ptr<proto::MsgpackMsg> nextMessage() {
     msgpack::object_handle handle;
     if (unp_.next(handle)) {
       return parseMessage(&handle);
     }
+    return nullptr;
+  }
 
+  std::shared_ptr<proto::MsgpackMsg> loadMessage(QIODevice* connection) {
+    // This method can throw msgpack::type_error when malformed message is read
     while (1) {
-      unp_.reserve_buffer(READ_SIZE_);
-      qint64 read = connection->read(unp_.buffer(), READ_SIZE_);
-      if (read <= 0) {
-        return nullptr;
-      }
-      unp_.buffer_consumed(read);
-      if (unp_.next(handle)) {
-        return parseMessage(&handle);
+      auto msg = nextMessage();
+      if (msg || !readAvailable(connection)) {
+        return msg;
       }
     }
   }
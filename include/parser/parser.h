@@ -23,6 +23,18 @@
 namespace veles {
 namespace parser {
 
+/** Parser run in progress on the current thread.  */
+struct ParseOrigin {
+  QString parser_id;
+  dbif::ObjectHandle blob;
+  uint64_t start;
+  dbif::ObjectHandle parent_chunk;
+};
+
+/** Returns the innermost parser run in progress on the current thread,
+    or nullptr.  */
+const ParseOrigin *currentParseOrigin();
+
 class Parser {
  public:
   virtual ~Parser() {}
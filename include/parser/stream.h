@@ -18,57 +18,224 @@
 
 #include <assert.h>
 
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+#include "dbif/deferred.h"
 #include "dbif/types.h"
 #include "dbif/universe.h"
 #include "dbif/info.h"
 #include "data/repack.h"
+#include "parser/parser.h"
 
 namespace veles {
 namespace parser {
 
+/** While set, StreamParsers created on this thread only create the
+    outermost chunk of every stream in the database right away - nested
+    chunks are recorded in memory and sent along with their materialized
+    ancestor, to be created by the database on first access.  */
+inline bool &lazyChunks() {
+  static thread_local bool lazy = false;
+  return lazy;
+}
+
+class LazyChunksScope {
+  bool saved_;
+
+ public:
+  LazyChunksScope() : saved_(lazyChunks()) { lazyChunks() = true; }
+  ~LazyChunksScope() { lazyChunks() = saved_; }
+};
+
 class StreamParser {
   dbif::ObjectHandle blob_;
   dbif::ObjectHandle parent_chunk_;
   uint64_t pos_;
+  bool lazy_;
 
   struct WorkChunk {
     dbif::ObjectHandle chunk;
+    bool deferred;
     uint64_t start;
-    QString type;
     QString name;
     std::vector<data::ChunkDataItem> items;
+    // Deferred children are collected here, also for materialized chunks.
+    dbif::PDeferredChunk record;
+    // Deferred parent chunk coming from outside of this stream, if any.
+    dbif::PDeferredChunk outer_parent;
   };
 
   std::vector<WorkChunk> stack_;
+  // Chunks created in the database so far - deferred records only point
+  // to them weakly (see DeferredChunk::anchor).
+  std::vector<dbif::ObjectHandle> chunks_;
   unsigned width_;
   size_t blob_size_;
 
+  // Blob data is fetched from the database in windows of at least this many
+  // elements, most reads are then served without a database roundtrip.
+  static const uint64_t WINDOW_SIZE = 0x10000;
+  data::BinData window_;
+  uint64_t window_start_;
+
+  /** Makes sure elements [start, start + num) are in the window, returns
+      the number of them actually present in the blob.  */
+  uint64_t fillWindow(uint64_t start, uint64_t num) {
+    if (start >= blob_size_)
+      return 0;
+    uint64_t end = std::min<uint64_t>(start + num, blob_size_);
+    if (start >= window_start_ && end <= window_start_ + window_.size())
+      return end - start;
+    uint64_t fetch_end = std::min<uint64_t>(
+      start + (num > WINDOW_SIZE ? num : WINDOW_SIZE), blob_size_);
+    window_ = blob_->syncGetInfo<dbif::BlobDataRequest>(start, fetch_end)->data;
+    window_start_ = start;
+    return end - start;
+  }
+
+  data::BinData windowData(uint64_t start, uint64_t num) {
+    num = fillWindow(start, num);
+    if (!num)
+      return data::BinData(width_, 0);
+    return window_.data(start - window_start_, start - window_start_ + num);
+  }
+
+  dbif::PDeferredChunk parentRecord() {
+    if (stack_.size())
+      return stack_.back().record;
+    if (auto deferred = parent_chunk_.dynamicCast<dbif::DeferredChunkHandle>())
+      return deferred->record();
+    return dbif::PDeferredChunk();
+  }
+
+  static void markShipped(const dbif::PDeferredChunk &record) {
+    record->shipped = true;
+    for (auto &child : record->children)
+      markShipped(child);
+  }
+
+  void materialize(const dbif::PDeferredChunk &record) {
+    markShipped(record);
+    dbif::ObjectHandle chunk = blob_->syncRunMethod<dbif::ChunkCreateRequest>(
+      record->name, record->type.toString(), record->anchor.toStrongRef(),
+      record->start, record->end)->object;
+    if (!record->comment.isEmpty())
+      chunk->syncRunMethod<dbif::SetCommentRequest>(record->comment, true);
+    chunk->syncRunMethod<dbif::SetChunkParseRequest>(
+      record->start, record->end, record->items.items(), record->children);
+  }
+
+  template<typename T>
+  static typename std::enable_if<std::is_floating_point<T>::value,
+                                 data::FieldHighType>::type fieldHighType() {
+    return data::FieldHighType::floating(
+        sizeof(T) == 4 ? data::FieldHighType::IEEE754_SINGLE
+                       : data::FieldHighType::IEEE754_DOUBLE);
+  }
+
+  template<typename T>
+  static typename std::enable_if<std::is_integral<T>::value,
+                                 data::FieldHighType>::type fieldHighType() {
+    return data::FieldHighType::fixed(std::is_signed<T>::value
+                                          ? data::FieldHighType::SIGNED
+                                          : data::FieldHighType::UNSIGNED);
+  }
+
+  template<typename T>
+  static typename std::enable_if<std::is_floating_point<T>::value, T>::type
+  fromRaw(uint64_t raw) {
+    typedef typename std::conditional<sizeof(T) == 4, uint32_t,
+                                      uint64_t>::type Bits;
+    Bits bits = static_cast<Bits>(raw);
+    T res;
+    memcpy(&res, &bits, sizeof(T));
+    return res;
+  }
+
+  template<typename T>
+  static typename std::enable_if<std::is_integral<T>::value, T>::type
+  fromRaw(uint64_t raw) {
+    return static_cast<T>(raw);
+  }
+
  public:
   StreamParser(dbif::ObjectHandle blob, uint64_t start,
                dbif::ObjectHandle parent_chunk = dbif::ObjectHandle())
-      : blob_(blob), parent_chunk_(parent_chunk), pos_(start) {
+      : blob_(blob), parent_chunk_(parent_chunk), pos_(start),
+        lazy_(lazyChunks() && blob->canDeferChunks()), window_start_(0) {
     auto desc = blob_->syncGetInfo<dbif::DescriptionRequest>();
     width_ = desc.dynamicCast<dbif::BlobDescriptionReply>()->width;
     blob_size_ = desc.dynamicCast<dbif::BlobDescriptionReply>()->size;
   }
 
-  dbif::ObjectHandle startChunk(const QString &type, const QString &name) {
+  dbif::ObjectHandle startChunk(const QString &type_str,
+                                const QString &name) {
+    // Parsers create the same few types over and over, keep them as atoms
+    // until they reach the database.  Names are mostly unique (think
+    // "chunks[1234]") and would only grow the atom table.
+    util::Atom type(type_str);
+    auto record = dbif::PDeferredChunk::create(pos_, type, name);
+    dbif::PDeferredChunk parent_record = parentRecord();
+    if (lazy_ && parent_record && !parent_record->shipped) {
+      record->anchor = parent_record->anchor;
+      dbif::ObjectHandle chunk(new dbif::DeferredChunkHandle(record));
+      stack_.push_back(WorkChunk{chunk, true, pos_, name,
+                                 std::vector<data::ChunkDataItem>(), record,
+                                 stack_.size() ? dbif::PDeferredChunk()
+                                               : parent_record});
+      return chunk;
+    }
     dbif::ObjectHandle parent = parent_chunk_;
-    if (stack_.size())
+    QString parser_id;
+    if (stack_.size()) {
       parent = stack_.back().chunk;
+    } else {
+      if (parent_record)
+        parent = parent_record->anchor.toStrongRef();
+      // Outermost chunk of the whole parser run.
+      const ParseOrigin *origin = currentParseOrigin();
+      if (origin && origin->blob == blob_ && origin->start == pos_ &&
+          origin->parent_chunk == parent_chunk_)
+        parser_id = origin->parser_id;
+    }
     dbif::ObjectHandle chunk = blob_->syncRunMethod<dbif::ChunkCreateRequest>(
-      name, type, parent, pos_, pos_)->object;
-    stack_.push_back(WorkChunk{chunk, pos_, type, name, std::vector<data::ChunkDataItem>()});
+      name, type_str, parent, pos_, pos_, parser_id)->object;
+    record->anchor = chunk;
+    chunks_.push_back(chunk);
+    stack_.push_back(WorkChunk{chunk, false, pos_, name,
+                               std::vector<data::ChunkDataItem>(), record,
+                               dbif::PDeferredChunk()});
     return chunk;
   }
 
   dbif::ObjectHandle endChunk() {
     auto &top = stack_.back();
+    auto record = top.record;
     auto res = top.chunk;
-    res->syncRunMethod<dbif::SetChunkParseRequest>(top.start, pos_, top.items);
+    if (!top.deferred) {
+      for (auto &child : record->children)
+        markShipped(child);
+      res->syncRunMethod<dbif::SetChunkParseRequest>(
+        top.start, pos_, top.items, record->children);
+    } else {
+      record->end = pos_;
+      record->items.assign(top.items);
+      dbif::PDeferredChunk parent_record = top.outer_parent;
+      if (stack_.size() > 1)
+        parent_record = stack_[stack_.size() - 2].record;
+      if (parent_record->shipped) {
+        // Outer parent got sent to the database in the meantime, create
+        // this chunk under the nearest materialized ancestor instead.
+        materialize(record);
+      } else {
+        parent_record->children.push_back(record);
+      }
+    }
     if (stack_.size() > 1) {
       stack_[stack_.size() - 2].items.push_back(
-        data::ChunkDataItem::subchunk(top.start, pos_, top.name, top.chunk)
+        data::ChunkDataItem::subchunk(top.start, pos_, top.name, res)
       );
     }
     stack_.pop_back();
@@ -83,9 +250,9 @@ class StreamParser {
     size_t src_sz = repack.repackSize(num_elements);
     if (pos_ >= blob_size_)
       return data::BinData();
-    auto data = blob_->syncGetInfo<veles::dbif::BlobDataRequest>(pos_, pos_+src_sz);
+    auto data = windowData(pos_, src_sz);
     pos_ += src_sz;
-    data::BinData res = repack.repack(data->data, 0, num_elements);
+    data::BinData res = repack.repack(data, 0, num_elements);
     stack_.back().items.push_back(data::ChunkDataItem::field(
       pos_ - src_sz, pos_, name,
       repack, num_elements, high_type, res
@@ -108,10 +275,7 @@ class StreamParser {
       if (pos_ + src_size > blob_size_) {
         src_size = blob_size_ - pos_;
       }
-      auto data = blob_
-                      ->syncGetInfo<veles::dbif::BlobDataRequest>(
-                          pos_ + bytes_read, pos_ + bytes_read + src_size)
-                      ->data;
+      auto data = windowData(pos_ + bytes_read, src_size);
 
       data = repack.repack(data, 0, num_elements);
 
@@ -138,6 +302,38 @@ class StreamParser {
     return res;
   }
 
+  /** Reads a single fixed-size value of type T straight from the blob
+      window, without going through Repacker.  The field is recorded the same
+      way getData would record it.  */
+  template<typename T, data::Endian endian>
+  T read(const QString &name) {
+    static_assert(std::is_arithmetic<T>::value && sizeof(T) <= 8,
+                  "read() only handles integer and floating point types");
+    assert(width_ == 8);
+    if (fillWindow(pos_, sizeof(T)) < sizeof(T)) {
+      // Not enough data left - fall back to the generic path, which knows
+      // how to handle that.
+      auto data = getData(name, data::Repacker{endian, 8, sizeof(T) * 8}, 1,
+                          fieldHighType<T>());
+      if (!data.size()) return T();
+      return fromRaw<T>(data.element64());
+    }
+    const uint8_t *src = window_.rawData(pos_ - window_start_);
+    uint64_t raw = 0;
+    for (size_t i = 0; i < sizeof(T); i++) {
+      size_t shift = endian == data::Endian::LITTLE ? i : sizeof(T) - 1 - i;
+      raw |= uint64_t(src[i]) << (8 * shift);
+    }
+    data::BinData value(sizeof(T) * 8, 1);
+    value.setElement64(raw);
+    stack_.back().items.push_back(data::ChunkDataItem::field(
+      pos_, pos_ + sizeof(T), name, data::Repacker{endian, 8, sizeof(T) * 8},
+      1, fieldHighType<T>(), value
+    ));
+    pos_ += sizeof(T);
+    return fromRaw<T>(raw);
+  }
+
   float getFloat32(const QString &name, data::Endian endian) {
     auto data = getData(
         name, data::Repacker{endian, 8, 32}, 1,
@@ -222,17 +418,33 @@ class StreamParser {
     return get64(name, sign_mode, data::Endian::BIG);
   }
 
-  std::vector<uint8_t> getBytes(const QString &name, uint64_t len) {
-    auto data = getData(
-      name, data::Repacker(), len,
-      data::FieldHighType());
-    std::vector<uint8_t> res;
-    for (size_t i = 0; i < data.size(); i++) {
-      res.push_back(static_cast<uint8_t>(data.element64(i)));
+  /** Reads len bytes as a single field, like getBytes, but returns
+      a pointer into the blob window instead of a copy.  The pointer is valid
+      until the next read.  len is set to the number of bytes actually
+      present in the blob.  */
+  const uint8_t *getBytesView(const QString &name, uint64_t &len) {
+    assert(width_ == 8);
+    if (pos_ >= blob_size_) {
+      len = 0;
+      return nullptr;
     }
+    uint64_t start = pos_;
+    uint64_t avail = fillWindow(start, len);
+    const uint8_t *res = window_.rawData(start - window_start_);
+    pos_ += len;
+    stack_.back().items.push_back(data::ChunkDataItem::field(
+      start, pos_, name, data::Repacker(), avail, data::FieldHighType(),
+      data::BinData(8, avail, res)
+    ));
+    len = avail;
     return res;
   }
 
+  std::vector<uint8_t> getBytes(const QString &name, uint64_t len) {
+    const uint8_t *data = getBytesView(name, len);
+    return std::vector<uint8_t>(data, data + len);
+  }
+
   std::vector<uint8_t> getBytesUntil(const QString &name, uint8_t termination,
                                      bool include_termination = true) {
     auto data =
@@ -289,7 +501,10 @@ class StreamParser {
 
   void setComment(const QString &comment) {
     auto &top = stack_.back();
-    top.chunk->syncRunMethod<dbif::SetCommentRequest>(comment);
+    if (top.deferred)
+      top.record->comment = comment;
+    else
+      top.chunk->syncRunMethod<dbif::SetCommentRequest>(comment, true);
   }
 
 };
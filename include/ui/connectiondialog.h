@@ -41,6 +41,7 @@ class ConnectionDialog : public QDialog {
   QString clientName();
   QString databaseFile();
   QString serverScript();
+  bool compression();
 
  public slots:
   void serverLocalhost();
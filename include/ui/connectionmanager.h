@@ -22,6 +22,7 @@
 #include <QString>
 #include <QStringList>
 #include <QProcess>
+#include <QTemporaryDir>
 #include <QLabel>
 #include <QPixmap>
 #include <QHBoxLayout>
@@ -82,6 +83,10 @@ class ConnectionManager : public QObject {
   QProcess* server_process_;
   ConnectionDialog* connection_dialog_;
   bool is_local_server_;
+  /** UNIX socket the locally created server listens on, if any.  */
+  QString local_socket_path_;
+  /** Private directory holding local_socket_path_, removed with it.  */
+  std::unique_ptr<QTemporaryDir> local_socket_dir_;
   client::NetworkClient* network_client_;
   QTextStream* network_client_output_;
 };
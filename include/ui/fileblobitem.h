@@ -21,6 +21,7 @@
 #include <QString>
 #include <QIcon>
 #include "dbif/types.h"
+#include "util/intervalindex.h"
 
 namespace veles {
 namespace ui {
@@ -36,6 +37,9 @@ class FileBlobItem : public QObject {
   virtual int childrenCount();
   virtual FileBlobItem *child(int index);
   virtual int childIndex(FileBlobItem *child);
+  /** Returns the index of the child covering pos, or -1 if there's
+      none.  */
+  int childIndexAt(uint64_t pos);
   virtual QString name();
   virtual QString comment();
   virtual QString value();
@@ -70,6 +74,10 @@ class FileBlobItem : public QObject {
  private:
   bool sortChildren();
 
+  // Child ranges, rebuilt on first lookup after children change.
+  util::IntervalIndex<int> childrenIndex_;
+  bool childrenIndexValid_;
+
  protected slots:
   virtual void insertingChildrenHandle(FileBlobItem *item, bool before,
                                        int count);
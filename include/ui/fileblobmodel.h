@@ -23,6 +23,7 @@
 #include <QString>
 #include <QObject>
 
+#include "dbif/blobcache.h"
 #include "dbif/types.h"
 #include "ui/fileblobitem.h"
 #include "data/bindata.h"
@@ -56,7 +57,17 @@ class FileBlobModel : public QAbstractItemModel {
   QModelIndex indexFromPos(uint64_t pos,
                            const QModelIndex &parent = QModelIndex());
 
-  const data::BinData& binData() {return binData_;}
+  /** Starts reading elements [start, end) (clipped to the blob size) in
+      pieces - see dbif::BlobRangeReader.  */
+  dbif::BlobRangeReader *readBinData(uint64_t start, uint64_t end,
+                                     QObject *parent = nullptr);
+  uint64_t binDataSize() const {return bytesCount_;}
+  unsigned binDataWidth() const {return bytesWidth_;}
+  /** Makes sure elements [start, end) are cached or being fetched -
+      binDataLoaded() is emitted as they arrive.  */
+  void fetchBinData(uint64_t start, uint64_t end);
+  /** Stores an element in *value if it's cached, returns false otherwise.  */
+  bool binDataElement(uint64_t pos, uint64_t *value) const;
   bool isRemovable(const QModelIndex &index = QModelIndex());
   void uploadNewData(const QByteArray &buf);
   void parse(QString parser = "", qint64 offset = 0,
@@ -75,16 +86,16 @@ class FileBlobModel : public QAbstractItemModel {
 
  signals:
   void newBinData();
+  void binDataLoaded(qint64 start, qint64 end);
 
  private:
   FileBlobItem *item_;
   dbif::ObjectHandle fileBlob_;
-  dbif::InfoPromise *bytesPromise_;
-  size_t bytesCount_;
+  dbif::BlobPageCache *pages_;
+  uint64_t bytesCount_;
+  unsigned bytesWidth_;
   QStringList path_;
 
-  data::BinData binData_;
-
   QColor color(int colorIndex) const;
   FileBlobItem *itemFromIndex(const QModelIndex &index) const;
   QModelIndex indexFromItem(FileBlobItem *item) const;
@@ -94,7 +105,8 @@ class FileBlobModel : public QAbstractItemModel {
 
  private slots:
   void gotDescriptionResponse(veles::dbif::PInfoReply reply);
-  void gotBytesResponse(veles::dbif::PInfoReply reply);
+  void gotPage(qint64 start, qint64 end);
+  void pageChanged(qint64 start, qint64 end);
 };
 
 }  // namespace ui
@@ -154,7 +154,9 @@ public slots:
   QString hexRepresentationFromBytePos(qint64 pos);
   QString asciiRepresentationFromBytePos(qint64 pos);
 
-  qint64 byteValue(qint64 pos);
+  /** Stores the value of a byte in *value, returns false if it hasn't
+      been fetched yet.  */
+  bool byteValue(qint64 pos, uint64_t *value);
   QColor byteTextColorFromPos(qint64 pos);
   QColor byteBackroundColorFromPos(qint64 pos);
 
@@ -65,6 +65,7 @@ class NodeWidget : public View {
 
   util::UniformSampler* sampler_;
   QByteArray sampler_data_;
+  QPointer<dbif::BlobRangeReader> minimap_reader_;
 };
 
 }  // namespace ui
@@ -16,12 +16,16 @@
  */
 #pragma once
 
+#include <functional>
+
 #include <QDialog>
 #include <QtCore>
 #include <QMessageBox>
+#include <QPointer>
 
 #include "include/ui/hexedit.h"
 #include "data/bindata.h"
+#include "dbif/blobcache.h"
 
 namespace Ui {
 class SearchDialog;
@@ -35,7 +39,9 @@ class SearchDialog : public QDialog {
  public:
   explicit SearchDialog(HexEdit *hexEdit, QWidget *parent = 0);
   ~SearchDialog();
-  qint64 findNext();
+  /** Starts looking for the next match, the result shows up once the
+      search is done.  */
+  void findNext();
   Ui::SearchDialog *ui;
 
  signals:
@@ -53,9 +59,20 @@ class SearchDialog : public QDialog {
   data::BinData getContent(int comboIndex, const QString &input);
   bool isHexStr(QString hexStr);
   qint64 replaceOccurrence(qint64 idx, const data::BinData &replaceBa);
-  qint64 findIndex(qint64 startSearchPos);
-  qint64 lastIndexOf(const data::BinData& pattern, qint64 startPos);
-  qint64 indexOf(const data::BinData& pattern, qint64 startPos);
+  void findNext(std::function<void(qint64)> done);
+  void foundAt(qint64 idx);
+  void replaceAllFrom(int replaceCounter);
+  /** Looks for the first match of pattern starting in [start, end) (the
+      last one if backwards is set) and calls done with its position, or
+      -1 if there's none.  The blob is read a window at a time, so this
+      never holds more than one window of data.  Any search already
+      running is cancelled.  */
+  void startSearch(const data::BinData &pattern, uint64_t start,
+                   uint64_t end, bool backwards,
+                   std::function<void(qint64)> done);
+  void searchStep();
+  void finishSearch(qint64 idx);
+  void cancelSearch();
   void replace(qint64 pos, qint64 len, const data::BinData &data);
 
   HexEdit *_hexEdit;
@@ -64,6 +81,18 @@ class SearchDialog : public QDialog {
   qint64 _lastFoundSize;
   QMessageBox* message_box_not_found_;
   QMessageBox* message_box_not_valid_hex_string_;
+
+  data::BinData search_pattern_;
+  bool search_backwards_;
+  /** Positions still to be checked are [search_start_, search_end_).  */
+  uint64_t search_start_;
+  uint64_t search_end_;
+  /** Data of the window being read, search_window_filled_ elements of
+      it have arrived.  */
+  data::BinData search_window_;
+  uint64_t search_window_filled_;
+  std::function<void(qint64)> search_done_;
+  QPointer<dbif::BlobRangeReader> search_reader_;
 };
 
 }  // namespace ui
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2017 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+
+#include <QHash>
+#include <QString>
+
+namespace veles {
+namespace util {
+
+/** An interned string, represented by a 32-bit id.
+
+    Equal strings always get the same id, so atoms are compared and hashed
+    as plain integers.  The strings live in a global, thread-safe table
+    for the rest of the program - use atoms for names which repeat a lot
+    (chunk types, field names), not for arbitrary data.  The default atom
+    is the empty string.  */
+class Atom {
+  uint32_t id_;
+
+  explicit Atom(uint32_t id) : id_(id) {}
+
+ public:
+  Atom() : id_(0) {}
+  Atom(const QString &str);
+  Atom(const char *str) : Atom(QString(str)) {}
+
+  static Atom fromId(uint32_t id) { return Atom(id); }
+  uint32_t id() const { return id_; }
+  bool isEmpty() const { return id_ == 0; }
+  /** Returns the interned string.  Doesn't allocate - the result shares
+      its data with the table.  */
+  QString toString() const;
+
+  bool operator==(Atom other) const { return id_ == other.id_; }
+  bool operator!=(Atom other) const { return id_ != other.id_; }
+  bool operator<(Atom other) const { return id_ < other.id_; }
+};
+
+inline uint qHash(Atom atom, uint seed = 0) {
+  return ::qHash(atom.id(), seed);
+}
+
+}  // namespace util
+}  // namespace veles
+
+namespace std {
+
+template<>
+struct hash<veles::util::Atom> {
+  size_t operator()(veles::util::Atom atom) const {
+    return hash<uint32_t>()(atom.id());
+  }
+};
+
+}  // namespace std
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2017 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+namespace veles {
+namespace util {
+
+/** Static index of [start, end) intervals for position lookups.
+
+    Intervals are kept sorted by start, together with the running maximum
+    of their ends and, for each interval, the closest earlier one which
+    ends past it - for properly nested intervals, its parent.  find() is
+    a binary search followed by a walk up those links, so it costs the
+    nesting depth rather than the number of enclosed siblings.
+    overlapping() is a binary search followed by a scan over the
+    intervals which actually overlap the query (plus ones nested between
+    them).  Call build() after adding intervals and before querying.  */
+template<typename T>
+class IntervalIndex {
+  struct Entry {
+    uint64_t start;
+    uint64_t end;
+    T value;
+    bool operator<(const Entry &other) const { return start < other.start; }
+  };
+  std::vector<Entry> entries_;
+  std::vector<uint64_t> max_end_;
+  // Index + 1 of the closest earlier entry with a bigger end, or 0.
+  std::vector<size_t> enclosing_;
+
+ public:
+  void clear() {
+    entries_.clear();
+    max_end_.clear();
+    enclosing_.clear();
+  }
+
+  bool empty() const { return entries_.empty(); }
+
+  void add(uint64_t start, uint64_t end, const T &value) {
+    if (end > start) {
+      entries_.push_back(Entry{start, end, value});
+    }
+  }
+
+  void build() {
+    std::stable_sort(entries_.begin(), entries_.end());
+    max_end_.resize(entries_.size());
+    enclosing_.resize(entries_.size());
+    uint64_t max_end = 0;
+    // Earlier entries not ended by any later one so far, ends decreasing.
+    std::vector<size_t> open;
+    for (size_t i = 0; i < entries_.size(); i++) {
+      max_end = std::max(max_end, entries_[i].end);
+      max_end_[i] = max_end;
+      while (!open.empty() && entries_[open.back()].end <= entries_[i].end) {
+        open.pop_back();
+      }
+      enclosing_[i] = open.empty() ? 0 : open.back() + 1;
+      open.push_back(i);
+    }
+  }
+
+  /** Returns the last-starting interval containing pos - for nested
+      intervals, that's the innermost one.  */
+  const T *find(uint64_t pos) const {
+    auto iter = std::upper_bound(
+        entries_.begin(), entries_.end(), pos,
+        [](uint64_t pos, const Entry &entry) { return pos < entry.start; });
+    // Entries skipped by a link end no later than the one it starts
+    // from, so they can't contain pos either.
+    for (size_t i = iter - entries_.begin(); i > 0; i = enclosing_[i - 1]) {
+      if (entries_[i - 1].end > pos) {
+        return &entries_[i - 1].value;
+      }
+    }
+    return nullptr;
+  }
+
+  /** Appends all intervals overlapping [start, end), in start order.  */
+  void overlapping(uint64_t start, uint64_t end, std::vector<T> &out) const {
+    auto first = std::upper_bound(max_end_.begin(), max_end_.end(), start);
+    for (size_t i = first - max_end_.begin();
+         i < entries_.size() && entries_[i].start < end; i++) {
+      if (entries_[i].end > start) {
+        out.push_back(entries_[i].value);
+      }
+    }
+  }
+};
+
+}  // namespace util
+}  // namespace veles
@@ -55,6 +55,10 @@ QString serverScriptDefault();
 QString serverScript();
 void setServerScript(QString server_script);
 
+bool compressionDefault();
+bool compression();
+void setCompression(bool compression);
+
 QString currentProfile();
 void setCurrentProfile(QString profile);
 QStringList profileList();
@@ -16,11 +16,13 @@
 
 import logging
 import asyncio
+import os
 import signal
 import importlib
 
 from veles.server.conn import AsyncLocalConnection
-from veles.server.proto import create_unix_server, create_tcp_server
+from veles.server.proto import (
+    create_unix_server, create_tcp_server, check_private_socket_path)
 from veles.util import helpers
 
 parser = helpers.get_logging_argparse()
@@ -34,7 +36,16 @@ parser.add_argument(
     help='path to database file, in-memory will be used if empty')
 parser.add_argument('--plugin', action='append',
                     help='name plugin module to load')
+parser.add_argument('--unix-socket', metavar='PATH',
+                    help='additionally listen on a UNIX socket at PATH, '
+                         'for clients running on the same machine; PATH '
+                         'must not exist and its directory must be private')
 args = parser.parse_args()
+if args.unix_socket is not None:
+    try:
+        check_private_socket_path(args.unix_socket)
+    except (ValueError, OSError) as e:
+        parser.error('refusing to use --unix-socket: {}'.format(e))
 
 logging.basicConfig(level=logging.getLevelName(args.log_level))
 
@@ -56,10 +67,19 @@ else:
     logging.info('Starting TCP server...')
     loop.run_until_complete(
         create_tcp_server(conn, args.auth_key, host, int(port)))
+if args.unix_socket is not None:
+    logging.info('Starting UNIX server...')
+    loop.run_until_complete(
+        create_unix_server(conn, args.auth_key, args.unix_socket))
 logging.info('Ready.')
 try:
     loop.add_signal_handler(signal.SIGINT, loop.stop)
+    loop.add_signal_handler(signal.SIGTERM, loop.stop)
 except NotImplementedError:
     pass
-loop.run_forever()
+try:
+    loop.run_forever()
+finally:
+    if args.unix_socket is not None and os.path.exists(args.unix_socket):
+        os.remove(args.unix_socket)
 logging.info('Goodbye.')
@@ -58,14 +58,20 @@ def generate_cpp_code():
 #include "data/bindata.h"
 #include "data/nodeid.h"
 #include "network/msgpackobject.h"
+#include "network/msgpackcodec.h"
 '''
     source_code = license
     source_code += '''#include "models.h"
 '''
     fwd_header_code = license + '''#pragma once
+#include <memory>
+
+#include <msgpack.hpp>
+
 namespace veles {
 namespace messages {
 class MsgpackObject;
+typedef msgpack::packer<msgpack::sbuffer> MsgpackPacker;
 }  // namespace messages
 }  // namespace veles
 '''
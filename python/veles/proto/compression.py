@@ -0,0 +1,84 @@
+# Copyright 2017 CodiLime
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import zlib
+
+from veles.proto.exceptions import SchemaError
+
+
+# Packed messages smaller than this are always sent as they are - the
+# compression overhead isn't worth it.
+COMPRESSION_THRESHOLD = 1024
+
+# Fastest level - the point is to save bandwidth on big replies without
+# making the sender CPU-bound.
+ZLIB_LEVEL = 1
+
+# Decompressed messages bigger than this are rejected, so that a tiny
+# message can't make us allocate gigabytes.
+MAX_DECOMPRESSED_SIZE = 256 * 1024 * 1024
+
+
+def _zlib_decompress(data, max_size):
+    obj = zlib.decompressobj()
+    # One byte past max_size is enough to tell the data is too big.
+    res = obj.decompress(data, max_size + 1)
+    if len(res) > max_size:
+        raise SchemaError('decompressed data too big')
+    if not obj.eof:
+        raise SchemaError('corrupted compressed data')
+    return res
+
+
+ALGORITHMS = {
+    'zlib': (
+        lambda data: zlib.compress(data, ZLIB_LEVEL),
+        _zlib_decompress,
+    ),
+}
+
+
+def choose(algorithms):
+    """
+    Returns the first algorithm on the list that is supported, or None.
+    """
+    for algorithm in algorithms:
+        if algorithm in ALGORITHMS:
+            return algorithm
+    return None
+
+
+def compress(algorithm, data):
+    """
+    Returns compressed data, or None if it isn't worth compressing.
+    """
+    if len(data) < COMPRESSION_THRESHOLD:
+        return None
+    res = ALGORITHMS[algorithm][0](data)
+    if len(res) >= len(data):
+        return None
+    return res
+
+
+def decompress(algorithm, data, max_size=MAX_DECOMPRESSED_SIZE):
+    """
+    Raises SchemaError for an unknown algorithm, corrupted data or data
+    decompressing to more than max_size bytes.
+    """
+    if algorithm not in ALGORITHMS:
+        raise SchemaError('unknown compression algorithm')
+    try:
+        return ALGORITHMS[algorithm][1](data, max_size)
+    except zlib.error:
+        raise SchemaError('corrupted compressed data')
@@ -75,6 +75,54 @@ class MsgProtoError(MsgpackMsg):
     err = fields.Object(VelesException)
 
 
+class MsgBatch(MsgpackMsg):
+    """
+    Sent by the client to deliver several messages at once.  The server
+    handles them in order, as if they were sent separately.
+    """
+
+    object_type = 'batch'
+
+    msgs = fields.List(fields.Object(MsgpackMsg))
+
+
+class MsgSetCompression(MsgpackMsg):
+    """
+    Sent by the client after connecting to ask for compressed traffic.
+    The server picks the first algorithm on the list it supports and
+    replies with MsgCompressionSet.
+    """
+
+    object_type = 'set_compression'
+
+    algorithms = fields.List(fields.String())
+
+
+class MsgCompressionSet(MsgpackMsg):
+    """
+    Sent by the server in reply to MsgSetCompression.  From now on, either
+    side may wrap its messages in MsgCompressed using the chosen algorithm.
+    If algorithm is None, none of the requested ones is supported and
+    the traffic stays uncompressed.
+    """
+
+    object_type = 'compression_set'
+
+    algorithm = fields.String(optional=True)
+
+
+class MsgCompressed(MsgpackMsg):
+    """
+    One or more messages, packed one after another and compressed as
+    a whole.  Only used for messages big enough for compression to pay off.
+    """
+
+    object_type = 'compressed'
+
+    algorithm = fields.String()
+    data = fields.Binary()
+
+
 # queries and subscriptions
 
 
@@ -37,6 +37,8 @@ class EnumModel(Enum):
         code = '''void fromMsgpackObject(const std::shared_ptr<MsgpackObject>\
  obj, {0}& out);
 std::shared_ptr<MsgpackObject> toMsgpackObject({0} val);
+void fromMsgpack(const msgpack::object& obj, {0}& out);
+void toMsgpack(MsgpackPacker& pk, {0} val);
 '''.format(cls.cpp_type()[1])
         return code
 
@@ -64,4 +66,25 @@ std::shared_ptr<MsgpackObject> toMsgpackObject({0} val) {{
       return std::make_shared<MsgpackObject>("{1}");'''.format(
                cls.cpp_type()[1], name, name.upper())
                for name in cls.__members__]))
+        code += '''void fromMsgpack(const msgpack::object& obj, {0}& out) {{
+{1}
+  throw proto::SchemaError("Unrecognized enum value");
+}}
+void toMsgpack(MsgpackPacker& pk, {0} val) {{
+  switch (val) {{
+{2}
+    default:
+      throw proto::SchemaError("Unrecognized enum value");
+  }}
+}}
+'''.format(cls.cpp_type()[1],
+           '\n'.join(['''  if (details_::strEquals(obj, "{1}")) {{
+    out = {0}::{2};
+    return;
+  }}'''.format(cls.cpp_type()[1], name, name.upper())
+                        for name in cls.__members__]),
+           '\n'.join(['''    case {0}::{2}:
+      details_::packStr(pk, "{1}");
+      return;'''.format(cls.cpp_type()[1], name, name.upper())
+                      for name in cls.__members__]))
         return code
@@ -139,6 +139,7 @@ class Model(pep487.NewObject):
 '''.format(cls.cpp_type()[1])
         code += '''
   std::shared_ptr<messages::MsgpackObject> serializeToMsgpackObject();
+  void serializeToMsgpack(messages::MsgpackPacker& pk);
 '''
         code += '};\n'
 
@@ -199,11 +200,11 @@ class Model(pep487.NewObject):
 '''.format(''.join(to_object), '\n'.join(
             ['msg["{0}"] = messages::toMsgpackObject(this->{0});'.format(
                 extra) for extra in extra_pack]), cls.cpp_type()[0])
+        code += cls.generate_pack_code(extra_pack)
         code += '''
 std::shared_ptr<{0}> {1}::loadMessagePack(const msgpack::object& obj) {{
-  auto loc_obj = std::make_shared<messages::MsgpackObject>(obj);
   std::shared_ptr<{0}> out;
-  fromMsgpackObject(loc_obj, out);
+  messages::fromMsgpack(obj, out);
   return out;
 }}
 '''.format(cls.cpp_type()[1], cls.cpp_type()[0])
@@ -222,6 +223,10 @@ std::shared_ptr<{0}> {1}::loadMessagePack(const msgpack::object& obj) {{
                     cls.cpp_type()[1]))
         code += ('std::shared_ptr<MsgpackObject> toMsgpackObject'
                  '(std::shared_ptr<{}> val);\n'.format(cls.cpp_type()[1]))
+        code += ('void fromMsgpack(const msgpack::object& obj, '
+                 'std::shared_ptr<{}>& out);\n'.format(cls.cpp_type()[1]))
+        code += ('void toMsgpack(MsgpackPacker& pk, '
+                 'std::shared_ptr<{}> val);\n'.format(cls.cpp_type()[1]))
         return code
 
     @classmethod
@@ -264,8 +269,97 @@ toMsgpackObject(std::shared_ptr<{0}> val) {{
             return val->serializeToMsgpackObject();
           }}
         '''.format(cls.cpp_type()[1])
+        code += cls.generate_unpack_code()
         return code
 
+    @classmethod
+    def generate_unpack_code(cls):
+        """Generates fromMsgpack / toMsgpack for this model, which convert
+        directly between msgpack::object / MsgpackPacker and the model,
+        without going through a MsgpackObject tree."""
+        found_vars = []
+        matchers = []
+        checks = []
+        for field in cls.fields:
+            arg_type = (
+                '{}' if field.cpp_type()[1] else 'std::shared_ptr<{}>').format(
+                field.cpp_type()[0])
+            if field.optional:
+                setter = 'b.set_{0}(std::pair<bool, {1}>(true, val));'.format(
+                    field.name, arg_type)
+            else:
+                setter = '''b.set_{0}(val);
+      found_{0} = true;'''.format(field.name)
+                found_vars.append(
+                    '  bool found_{} = false;\n'.format(field.name))
+                checks.append('''  if (!found_{0}) {{
+    throw proto::SchemaError("Nonoptional field {0} not found when unpacking");
+  }}
+'''.format(field.name))
+            matchers.append('''if (details_::strEquals(kv.key, "{0}")) {{
+      {1} val;
+      fromMsgpack(kv.val, val);
+      {2}
+    }}'''.format(field.name, arg_type, setter))
+        return '''void fromMsgpack(const msgpack::object& obj, \
+std::shared_ptr<{0}>& out) {{
+  details_::checkType(obj, msgpack::type::MAP, "map");
+  {0}::Builder b;
+{1}  for (uint32_t i = 0; i < obj.via.map.size; i++) {{
+    const msgpack::object_kv& kv = obj.via.map.ptr[i];
+    // nil is the same as a missing field
+    if (kv.val.type == msgpack::type::NIL) {{
+      continue;
+    }}
+    {2}
+  }}
+{3}  out = b.build();
+}}
+
+void toMsgpack(MsgpackPacker& pk, std::shared_ptr<{0}> val) {{
+  if (val == nullptr) {{
+    pk.pack_nil();
+    return;
+  }}
+  val->serializeToMsgpack(pk);
+}}
+'''.format(cls.cpp_type()[1], ''.join(found_vars),
+           ' else '.join(matchers), ''.join(checks))
+
+    @classmethod
+    def generate_pack_code(cls, extra_pack):
+        """Generates serializeToMsgpack.  Keys are packed in sorted order,
+        same as serializeToMsgpackObject does through std::map."""
+        checks = []
+        entries = []
+        for field in cls.fields:
+            if field.optional:
+                entries.append((field.name, '''if (this->{0}.first) {{
+    messages::toMsgpack(pk, this->{0}.second);
+  }} else {{
+    pk.pack_nil();
+  }}'''.format(field.name)))
+            else:
+                if not field.cpp_type()[1]:
+                    checks.append('''  if (this->{0} == nullptr) {{
+    throw proto::SchemaError("Nonoptional field {0} not set when packing");
+  }}
+'''.format(field.name))
+                entries.append((field.name, 'messages::toMsgpack(pk, '
+                                'this->{});'.format(field.name)))
+        for extra in extra_pack:
+            entries.append((extra, 'messages::toMsgpack(pk, '
+                            'this->{});'.format(extra)))
+        entries.sort(key=lambda entry: entry[0])
+        return '''
+void {0}::serializeToMsgpack(messages::MsgpackPacker& pk) {{
+{1}  pk.pack_map({2});
+{3}}}
+'''.format(cls.cpp_type()[0], ''.join(checks), len(entries), ''.join(
+            '''  messages::details_::packStr(pk, "{0}");
+  {1}
+'''.format(name, code) for name, code in entries))
+
     @classmethod
     def cpp_type(cls):
         """returns a tuple containing class name and fully qualified name
@@ -344,6 +438,7 @@ class {0} {{
  public:
   virtual std::shared_ptr<messages::MsgpackObject> \
 serializeToMsgpackObject() = 0;
+  virtual void serializeToMsgpack(messages::MsgpackPacker& pk) = 0;
   static void initObjectTypes() {{
 {1}  }}
   template<typename T> static std::shared_ptr<{0}> \
@@ -352,12 +447,24 @@ serializeToMsgpackObject() = 0;
     fromMsgpackObject(obj, out);
     return out;
   }}
+  template<typename T> static std::shared_ptr<{0}> \
+  createInstanceFromMsgpack(const msgpack::object& obj) {{
+    std::shared_ptr<T> out;
+    messages::fromMsgpack(obj, out);
+    return out;
+  }}
   static std::map<std::string, std::shared_ptr<{0}>(*)\
 (const std::shared_ptr<messages::MsgpackObject>)>& objectTypes() {{
     static std::map<std::string, std::shared_ptr<{0}>(*)\
 (const std::shared_ptr<messages::MsgpackObject>)> object_types;
     return object_types;
   }}
+  static std::map<std::string, std::shared_ptr<{0}>(*)\
+(const msgpack::object&)>& msgpackTypes() {{
+    static std::map<std::string, std::shared_ptr<{0}>(*)\
+(const msgpack::object&)> msgpack_types;
+    return msgpack_types;
+  }}
   std::string object_type;
   {0}(std::string object_type) : object_type(object_type) {{}}
   virtual ~{0}() {{}}
@@ -367,8 +474,9 @@ serializeToMsgpackObject() = 0;
 
 '''.format(cls.cpp_type()[0],
            ''.join([
-               '    objectTypes()["{0}"] = &createInstance<{1}>;\n'.format(
-                   obj_type, obj_class.cpp_type()[0])
+               '    objectTypes()["{0}"] = &createInstance<{1}>;\n'
+               '    msgpackTypes()["{0}"] = &createInstanceFromMsgpack<{1}>;\n'
+               .format(obj_type, obj_class.cpp_type()[0])
                for obj_type, obj_class in cls.object_types.items()
                if obj_class.fields]))
         return code
@@ -376,9 +484,8 @@ serializeToMsgpackObject() = 0;
     @classmethod
     def generate_base_source_code(cls):
         code = '''std::shared_ptr<{0}> {0}::polymorphicLoad(const msgpack::object& obj) {{
-    auto loc_obj = std::make_shared<messages::MsgpackObject>(obj);
     std::shared_ptr<{0}> out;
-    fromMsgpackObject(loc_obj, out);
+    messages::fromMsgpack(obj, out);
     return out;
   }}
 '''.format(cls.cpp_type()[0])
@@ -389,6 +496,8 @@ serializeToMsgpackObject() = 0;
         code = '''void fromMsgpackObject(const std::shared_ptr<MsgpackObject>\
  obj, std::shared_ptr<{0}>& out);
 std::shared_ptr<MsgpackObject> toMsgpackObject(std::shared_ptr<{0}> val);
+void fromMsgpack(const msgpack::object& obj, std::shared_ptr<{0}>& out);
+void toMsgpack(MsgpackPacker& pk, std::shared_ptr<{0}> val);
 '''.format(cls.cpp_type()[1])
         return code
 
@@ -410,6 +519,36 @@ std::shared_ptr<MsgpackObject> toMsgpackObject(std::shared_ptr<{0}> val);
 std::shared_ptr<MsgpackObject> toMsgpackObject(std::shared_ptr<{0}> val) {{
   return val->serializeToMsgpackObject();
 }}
+
+void fromMsgpack(const msgpack::object& obj, std::shared_ptr<{0}>& out) {{
+  auto& types = {0}::msgpackTypes();
+  if (types.size() == 0) {{
+    {0}::initObjectTypes();
+  }}
+  details_::checkType(obj, msgpack::type::MAP, "map");
+  for (uint32_t i = 0; i < obj.via.map.size; i++) {{
+    const msgpack::object_kv& kv = obj.via.map.ptr[i];
+    if (details_::strEquals(kv.key, "object_type")) {{
+      details_::checkType(kv.val, msgpack::type::STR, "string");
+      std::string obj_type(kv.val.via.str.ptr, kv.val.via.str.size);
+      auto type = types.find(obj_type);
+      if (type == types.end()) {{
+        throw proto::SchemaError("Unknown object_type: " + obj_type);
+      }}
+      out = type->second(obj);
+      return;
+    }}
+  }}
+  throw proto::SchemaError("A polymorphic model has no type");
+}}
+
+void toMsgpack(MsgpackPacker& pk, std::shared_ptr<{0}> val) {{
+  if (val == nullptr) {{
+    pk.pack_nil();
+    return;
+  }}
+  val->serializeToMsgpack(pk);
+}}
 '''.format(cls.cpp_type()[1])
         return code
 
@@ -19,10 +19,12 @@
 
 import asyncio
 import hmac
+import os
+import stat
 
 import msgpack
 
-from veles.proto import messages, msgpackwrap
+from veles.proto import messages, msgpackwrap, compression
 from veles.util.helpers import prepare_auth_key
 from veles.db.subscriber import (
     BaseSubscriberNode,
@@ -282,6 +284,7 @@ class ServerProto(asyncio.Protocol):
         self.client_type = None
         self.quit_on_close = False
         self.cid = None
+        self.compression = None
 
     def connection_made(self, transport):
         self.transport = transport
@@ -307,10 +310,30 @@ class ServerProto(asyncio.Protocol):
         while True:
             try:
                 msg = messages.MsgpackMsg.load(self.unpacker.unpack())
-                loop = asyncio.get_event_loop()
-                loop.create_task(self.handle_msg(msg))
             except msgpack.OutOfData:
                 return
+            self.dispatch_msg(msg)
+
+    def dispatch_msg(self, msg):
+        # Batches and compressed messages are unwrapped right away, so that
+        # the messages inside are handled in the order they were sent.
+        loop = asyncio.get_event_loop()
+        try:
+            if self.connected and msg.object_type == 'batch':
+                for sub in msg.msgs:
+                    self.dispatch_msg(sub)
+            elif self.connected and msg.object_type == 'compressed':
+                unpacker = msgpackwrap.MsgpackWrapper().unpacker
+                unpacker.feed(compression.decompress(
+                    msg.algorithm, msg.data))
+                for sub in unpacker:
+                    self.dispatch_msg(messages.MsgpackMsg.load(sub))
+            else:
+                loop.create_task(self.handle_msg(msg))
+        except VelesException as err:
+            self.send_msg(messages.MsgProtoError(
+                err=err,
+            ))
 
     async def handle_msg(self, msg):
         if self.connected:
@@ -325,6 +348,7 @@ class ServerProto(asyncio.Protocol):
                 'set_data': self.msg_set_data,
                 'set_bindata': self.msg_set_bindata,
                 'transaction': self.msg_transaction,
+                'set_compression': self.msg_set_compression,
                 'method_run': self.msg_method_run,
                 'broadcast_run': self.msg_broadcast_run,
                 'get': self.msg_get,
@@ -382,7 +406,15 @@ class ServerProto(asyncio.Protocol):
             loop.stop()
 
     def send_msg(self, msg):
-        self.transport.write(self.packer.pack(msg.dump()))
+        data = self.packer.pack(msg.dump())
+        if self.compression is not None:
+            compressed = compression.compress(self.compression, data)
+            if compressed is not None:
+                data = self.packer.pack(messages.MsgCompressed(
+                    algorithm=self.compression,
+                    data=compressed,
+                ).dump())
+        self.transport.write(data)
 
     async def do_request(self, msg, req):
         try:
@@ -397,6 +429,14 @@ class ServerProto(asyncio.Protocol):
                 rid=msg.rid,
             ))
 
+    async def msg_set_compression(self, msg):
+        algorithm = compression.choose(msg.algorithms)
+        # The reply itself goes out uncompressed.
+        self.send_msg(messages.MsgCompressionSet(
+            algorithm=algorithm,
+        ))
+        self.compression = algorithm
+
     async def msg_connect(self, msg):
         # TODO more sophisticated checking if versions are compatible
         if PROTO_VERSION != msg.proto_version:
@@ -711,6 +751,26 @@ class ServerProto(asyncio.Protocol):
                 self.conn, self, msg.qid)
 
 
+def check_private_socket_path(path):
+    """
+    Makes sure a UNIX socket can be safely created at path: nothing may be
+    there yet, and the directory has to be ours and closed to other users,
+    so that nobody else can replace the socket or connect to it.  Raises
+    ValueError otherwise.
+    """
+    if os.path.lexists(path):
+        raise ValueError('{} already exists'.format(path))
+    directory = os.path.dirname(os.path.abspath(path))
+    st = os.lstat(directory)
+    if not stat.S_ISDIR(st.st_mode):
+        raise ValueError('{} is not a directory'.format(directory))
+    if st.st_uid != os.getuid():
+        raise ValueError('{} is not owned by us'.format(directory))
+    if st.st_mode & 0o077:
+        raise ValueError(
+            '{} is accessible to other users'.format(directory))
+
+
 async def create_unix_server(conn, key, path):
     key = prepare_auth_key(key)
     return await conn.loop.create_unix_server(
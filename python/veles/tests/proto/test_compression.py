@@ -0,0 +1,63 @@
+# Copyright 2017 CodiLime
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import random
+import unittest
+
+from veles.proto import compression
+from veles.proto.exceptions import SchemaError
+
+
+class TestCompression(unittest.TestCase):
+    def test_choose(self):
+        self.assertEqual(compression.choose(['zlib']), 'zlib')
+        self.assertEqual(compression.choose(['lz4', 'zlib']), 'zlib')
+        self.assertEqual(compression.choose(['lz4']), None)
+        self.assertEqual(compression.choose([]), None)
+
+    def test_roundtrip(self):
+        data = b'abcd' * 1000
+        res = compression.compress('zlib', data)
+        self.assertLess(len(res), len(data))
+        self.assertEqual(compression.decompress('zlib', res), data)
+
+    def test_threshold(self):
+        data = b'a' * (compression.COMPRESSION_THRESHOLD - 1)
+        self.assertIsNone(compression.compress('zlib', data))
+        data = b'a' * compression.COMPRESSION_THRESHOLD
+        self.assertIsNotNone(compression.compress('zlib', data))
+
+    def test_incompressible(self):
+        rand = random.Random(0)
+        data = bytes(rand.getrandbits(8) for _ in range(4096))
+        res = compression.compress('zlib', data)
+        self.assertIsNone(res)
+
+    def test_bad_data(self):
+        with self.assertRaises(SchemaError):
+            compression.decompress('zlib', b'abcd')
+        with self.assertRaises(SchemaError):
+            compression.decompress('lz4', b'abcd')
+
+    def test_size_limit(self):
+        data = b'x' * (1024 * 1024)
+        res = compression.compress('zlib', data)
+        self.assertEqual(
+            compression.decompress('zlib', res, len(data)), data)
+        with self.assertRaises(SchemaError):
+            compression.decompress('zlib', res, len(data) - 1)
+        with self.assertRaises(SchemaError):
+            compression.decompress('zlib', res, 0)
+        with self.assertRaises(SchemaError):
+            compression.decompress('zlib', res[:-4])
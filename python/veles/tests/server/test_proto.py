@@ -0,0 +1,112 @@
+
+import asyncio
+import os
+import tempfile
+import unittest
+import zlib
+
+from veles.proto import messages
+from veles.proto.msgpackwrap import MsgpackWrapper
+from veles.schema.nodeid import NodeID
+from veles.server.proto import ServerProto, check_private_socket_path
+
+
+class FakeTransport:
+    def __init__(self):
+        self.written = []
+
+    def write(self, data):
+        self.written.append(data)
+
+    def close(self):
+        pass
+
+
+class TestServerProtoDispatch(unittest.TestCase):
+    def setUp(self):
+        self.loop = asyncio.new_event_loop()
+        asyncio.set_event_loop(self.loop)
+        self.proto = ServerProto(None, b'k' * 64)
+        self.proto.connection_made(FakeTransport())
+        # Skip the handshake.
+        self.proto.authorized = True
+        self.proto.connected = True
+        self.handled = []
+
+        async def msg_get(msg):
+            self.handled.append(msg.qid)
+        self.proto.msg_get = msg_get
+
+    def tearDown(self):
+        asyncio.set_event_loop(None)
+        self.loop.close()
+
+    def get(self, qid):
+        return messages.MsgGet(qid=qid, id=NodeID())
+
+    def pack(self, *msgs):
+        packer = MsgpackWrapper().packer
+        return b''.join(packer.pack(msg.dump()) for msg in msgs)
+
+    def receive(self, data):
+        self.proto.data_received(data)
+        self.loop.run_until_complete(asyncio.sleep(0.01))
+
+    def test_batch_order(self):
+        # Messages following a batch in the same read used to overtake
+        # the ones inside it.
+        self.receive(self.pack(
+            self.get(1),
+            messages.MsgBatch(msgs=[self.get(2), self.get(3)]),
+            self.get(4),
+        ))
+        self.assertEqual(self.handled, [1, 2, 3, 4])
+
+    def test_batch_order_across_reads(self):
+        data = self.pack(
+            messages.MsgBatch(msgs=[self.get(1), self.get(2)]),
+            self.get(3),
+        )
+        self.proto.data_received(data[:5])
+        self.receive(data[5:])
+        self.assertEqual(self.handled, [1, 2, 3])
+
+    def test_compressed_order(self):
+        inner = self.pack(
+            self.get(1),
+            messages.MsgBatch(msgs=[self.get(2), self.get(3)]),
+        )
+        self.receive(self.pack(
+            messages.MsgCompressed(algorithm='zlib',
+                                   data=zlib.compress(inner)),
+            self.get(4),
+        ))
+        self.assertEqual(self.handled, [1, 2, 3, 4])
+
+
+@unittest.skipUnless(hasattr(os, 'getuid'), 'UNIX sockets only')
+class TestPrivateSocketPath(unittest.TestCase):
+    def setUp(self):
+        self.dir = tempfile.TemporaryDirectory()
+        os.chmod(self.dir.name, 0o700)
+        self.path = os.path.join(self.dir.name, 'server.sock')
+
+    def tearDown(self):
+        self.dir.cleanup()
+
+    def test_private_dir(self):
+        check_private_socket_path(self.path)
+
+    def test_shared_dir(self):
+        os.chmod(self.dir.name, 0o755)
+        with self.assertRaises(ValueError):
+            check_private_socket_path(self.path)
+
+    def test_existing_path(self):
+        open(self.path, 'w').close()
+        with self.assertRaises(ValueError):
+            check_private_socket_path(self.path)
+        os.remove(self.path)
+        os.symlink('/nonexistent', self.path)
+        with self.assertRaises(ValueError):
+            check_private_socket_path(self.path)
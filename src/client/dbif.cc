@@ -15,10 +15,12 @@
  *
  */
 
+#include <algorithm>
 #include <memory>
 #include <vector>
 
 #include <QSharedPointer>
+#include <QTimer>
 
 #include "db/getter.h"
 #include "data/types.h"
@@ -64,18 +66,44 @@ bool NCObjectHandle::operator==(NCObjectHandle& other) {
 }
 
 /*****************************************************************************/
-/* ChunkDataItemQuery */
+/* NodeCacheEntry */
 /*****************************************************************************/
 
-ChunkDataItemQuery::ChunkDataItemQuery(
-    uint64_t children_qid, uint64_t data_items_qid,
-    QPointer<dbif::InfoPromise> promise, data::NodeID id, bool sub)
-    : children_qid(children_qid), data_items_qid(data_items_qid),
-    children_loaded(false), data_items_loaded(false), promise(promise),
-    id(id), sub(sub) {}
+NodeCacheEntry::NodeCacheEntry() {
+  for (int part = 0; part < PART_COUNT; part++) {
+    qids[part] = 0;
+    loaded[part] = false;
+  }
+}
+
+bool NodeCacheEntry::needs(RequestKind kind, Part part) {
+  switch (kind) {
+  case RequestKind::DESCRIPTION:
+    return part == NODE;
+  case RequestKind::CHILDREN:
+    return part == CHILDREN;
+  case RequestKind::CHUNK_DATA:
+    return part == CHILDREN || part == DATA_ITEMS;
+  }
+  return false;
+}
 
-bool ChunkDataItemQuery::ready() {
-  return children_loaded && data_items_loaded;
+bool NodeCacheEntry::ready(RequestKind kind) const {
+  for (int part = 0; part < PART_COUNT; part++) {
+    if (needs(kind, static_cast<Part>(part)) && !loaded[part]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool NodeCacheEntry::watched() const {
+  for (const auto& watcher : watchers) {
+    if (watcher.promise) {
+      return true;
+    }
+  }
+  return false;
 }
 
 /*****************************************************************************/
@@ -240,82 +268,23 @@ void NCWrapper::handleGetListReplyMessage(msg_ptr message) {
           << reply->qid << endl;
     }
 
-    const auto promise_iter = promises_.find(reply->qid);
-    if (promise_iter != promises_.end()  && promise_iter->second) {
-      handleGetChildrenListReply(reply, promise_iter->second);
-    } else {
-      auto chunk_data_item_query_iter = chunk_data_item_queries_.find(
-          reply->qid);
-      if(chunk_data_item_query_iter != chunk_data_item_queries_.end()
-          && chunk_data_item_query_iter->second->promise != nullptr) {
-        handleGetChunkDataItemsReply(reply,
-            chunk_data_item_query_iter->second);
+    data::NodeID id = *data::NodeID::getNilId();
+    auto entry = nodeCacheEntry(reply->qid, NodeCacheEntry::CHILDREN, &id);
+    if (entry) {
+      for (auto child : *reply->objs) {
+        entry->children[*child->id] = child;
+      }
+      for (auto child_gone : *reply->gone) {
+        entry->children.erase(*child_gone);
       }
+      entry->loaded[NodeCacheEntry::CHILDREN] = true;
+      notifyWatchers(id, NodeCacheEntry::CHILDREN);
     }
   } else {
     wrongMessageType("get_list_reply", "MsgGetListReply");
   }
 }
 
-void NCWrapper::handleGetChildrenListReply(
-      std::shared_ptr<proto::MsgGetListReply> reply,
-      QPointer<dbif::InfoPromise> promise) {
-  auto iter_subscriptions = subscriptions_.find(reply->qid);
-
-  auto children_map_iter = children_maps_.find(reply->qid);
-  QSharedPointer<ChildrenMap> children_map;
-  if (children_map_iter == children_maps_.end()) {
-    children_map = QSharedPointer<ChildrenMap>::create();
-    if (iter_subscriptions != subscriptions_.end()) {
-      children_maps_[reply->qid] = children_map;
-    }
-  } else {
-    children_map = children_map_iter->second;
-  }
-
-  for (auto child : *reply->objs) {
-    (*children_map)[*child->id] = NCObjectHandle(
-        this, *child->id, typeFromTags(child->tags));
-  }
-
-  for (auto child_gone : *reply->gone) {
-    children_map->erase(*child_gone);
-  }
-
-  std::vector<dbif::ObjectHandle> objects;
-
-  for (auto child : *children_map) {
-    objects.push_back(QSharedPointer<NCObjectHandle>::create(
-        child.second));
-  }
-
-  emit promise->gotInfo(
-      QSharedPointer<dbif::ChildrenRequest::ReplyType>::create(objects));
-}
-
-void NCWrapper::handleGetChunkDataItemsReply(
-      std::shared_ptr<proto::MsgGetListReply> reply,
-      std::shared_ptr<ChunkDataItemQuery> chunk_data_item_query) {
-
-  if (chunk_data_item_query->promise) {
-    updateChildrenDataItems(*chunk_data_item_query, reply->objs, reply->gone);
-
-    if (chunk_data_item_query->ready()) {
-      std::vector<data::ChunkDataItem> items = resultDataItems(
-          *chunk_data_item_query);
-      emit chunk_data_item_query->promise->gotInfo(
-          QSharedPointer<dbif::ChunkDataReply>::create(items));
-
-      if (!chunk_data_item_query->sub) {
-        uint64_t qid1 = chunk_data_item_query->children_qid;
-        uint64_t qid2 = chunk_data_item_query->data_items_qid;
-        chunk_data_item_queries_.erase(qid1);
-        chunk_data_item_queries_.erase(qid2);
-      }
-    }
-  }
-}
-
 void NCWrapper::handleRequestAckMessage(msg_ptr message) {
   auto reply = std::dynamic_pointer_cast<proto::MsgRequestAck>(message);
 
@@ -383,107 +352,17 @@ void NCWrapper::handleGetReplyMessage(msg_ptr message) {
   auto reply = std::dynamic_pointer_cast<proto::MsgGetReply>(message);
 
   if (reply) {
-    const auto promise_iter = promises_.find(reply->qid);
-    if (promise_iter != promises_.end() && promise_iter->second) {
-      QString name("");
-      QString comment("");
-
-      getQStringAttr(reply->obj->attr, "name", name);
-      getQStringAttr(reply->obj->attr, "comment", comment);
-
-      dbif::ObjectType node_type = typeFromTags(reply->obj->tags);
-
-      if (node_type == dbif::ObjectType::FILE_BLOB
-          || node_type == dbif::ObjectType::SUB_BLOB) {
-
-        uint64_t base(0);
-        uint64_t size(0);
-        uint64_t width(8);
-
-        getAttr<uint64_t>(reply->obj->attr, "base", base);
-        getAttr<uint64_t>(reply->obj->attr, "size", size);
-        getAttr<uint64_t>(reply->obj->attr, "width", width);
-
-        if (node_type == dbif::ObjectType::FILE_BLOB) {
-          QString path;
-          getQStringAttr(reply->obj->attr, "path", path);
-
-          if (nc_->output() && detailed_debug_info_) {
-            *nc_->output() << QString("NCWrapper: received MsgGetReply "
-                "(file blob) - name: \"%1\" comment: \"%2\";").arg(name)
-                .arg(comment) << endl << QString("    base: %1; size: %2;"
-                " width: %3; path: \"%4\".").arg(base).arg(size).arg(width)
-                .arg(path) << endl;
-          }
-
-          emit promise_iter->second->gotInfo(
-              QSharedPointer<dbif::FileBlobDescriptionReply>
-              ::create(name, comment, base, size, width, path));
-        } else {
-          auto parent = QSharedPointer<NCObjectHandle>::create(
-              this, *reply->obj->parent, dbif::ObjectType::CHUNK); //FIXME
-
-          if (nc_->output() && detailed_debug_info_) {
-            *nc_->output() << QString("NCWrapper: received MsgGetReply "
-                "(sub blob) - name: \"%1\" comment: \"%2\";").arg(name)
-                .arg(comment) << endl << QString("    base: %1; size: %2;"
-                " width: %3.").arg(base).arg(size).arg(width) << endl;
-          }
-
-          emit promise_iter->second->gotInfo(
-              QSharedPointer<dbif::SubBlobDescriptionReply>
-              ::create(name, comment, base, size, width, parent));
-        }
-      } else if (node_type == dbif::ObjectType::CHUNK) {
-        data::NodeID blob_id = *data::NodeID::getNilId();
-        getAttrSPtr<data::NodeID>(reply->obj->attr, "blob",
-            blob_id);
-        auto blob = QSharedPointer<NCObjectHandle>::create(
-            this, blob_id, dbif::ObjectType::FILE_BLOB); //FIXME
-        auto parent = QSharedPointer<NCObjectHandle>::create(
-            this, *reply->obj->parent, dbif::ObjectType::CHUNK);
-        if (*blob == *parent) {
-          parent = QSharedPointer<NCObjectHandle>::create(
-              this, *data::NodeID::getNilId(), dbif::ObjectType::CHUNK);
-        }
-        uint64_t start(0);
-        uint64_t end(0);
-        QString chunk_type;
-
-        if (reply->obj->pos_start.first) {
-          start = reply->obj->pos_start.second;
-        }
-
-        if (reply->obj->pos_end.first) {
-          end = reply->obj->pos_end.second;
-        }
-
-        getQStringAttr(reply->obj->attr, "type", chunk_type);
-
-        if (nc_->output() && detailed_debug_info_) {
-          *nc_->output() << QString("NCWrapper: received MsgGetReply "
-              "(chunk) - name: \"%1\" comment: \"%2\";").arg(name)
-              .arg(comment) << endl << QString("    start: %1; end: %2;"
-              " type: \"%3\".").arg(start).arg(end).arg(chunk_type) << endl;
-        }
-
-        emit promise_iter->second->gotInfo(
-            QSharedPointer<dbif::ChunkDescriptionReply>
-            ::create(name, comment, blob, parent, start, end, chunk_type));
-      } else {
-        if (nc_->output() && detailed_debug_info_) {
-          *nc_->output() << QString("NCWrapper: received MsgGetReply - name: \""
-              "%1\" comment: \"%2\".").arg(name).arg(comment)<< endl;
-        }
-
-        emit promise_iter->second->gotInfo(
-            QSharedPointer<dbif::DescriptionReply>
-            ::create(name, comment));
-      }
+    if (nc_->output() && detailed_debug_info_) {
+      *nc_->output() << "NCWrapper: received MsgGetReply. qid = "
+          << reply->qid << endl;
+    }
 
-      if (subscriptions_.find(reply->qid) == subscriptions_.end()) {
-        promises_.erase(promise_iter);
-      }
+    data::NodeID id = *data::NodeID::getNilId();
+    auto entry = nodeCacheEntry(reply->qid, NodeCacheEntry::NODE, &id);
+    if (entry) {
+      entry->node = reply->obj;
+      entry->loaded[NodeCacheEntry::NODE] = true;
+      notifyWatchers(id, NodeCacheEntry::NODE);
     }
   } else {
     wrongMessageType("get_reply", "MsgGetReply");
@@ -500,10 +379,13 @@ void NCWrapper::handleGetBinDataReplyMessage(msg_ptr message) {
 
     const auto promise_iter = promises_.find(reply->qid);
     if (promise_iter != promises_.end()  && promise_iter->second) {
-      data::BinData bindata(8, reply->data->size(), reply->data->data());
+      // The reply owns the buffer for good - share it instead of copying.
+      auto bindata = data::BinData::fromSharedData(
+          8, reply->data->size(), reply->data->data(), reply->data);
 
       emit promise_iter->second->gotInfo(
-          QSharedPointer<dbif::BlobDataRequest::ReplyType>::create(bindata));
+          QSharedPointer<dbif::BlobDataRequest::ReplyType>::create(
+          std::move(bindata)));
 
       if (subscriptions_.find(reply->qid) == subscriptions_.end()) {
         promises_.erase(promise_iter);
@@ -521,33 +403,20 @@ void NCWrapper::handleGetDataReplyMessage(msg_ptr message) {
       *nc_->output() << "NCWrapper: received MsgGetDataReply." << endl;
     }
 
-    auto chunk_data_item_query_iter = chunk_data_item_queries_.find(
-        reply->qid);
-    if (chunk_data_item_query_iter != chunk_data_item_queries_.end()
-        && chunk_data_item_query_iter->second->promise != nullptr) {
-      ChunkDataItemQuery& chunk_data_item_query
-          = *chunk_data_item_query_iter->second;
+    data::NodeID id = *data::NodeID::getNilId();
+    auto entry = nodeCacheEntry(reply->qid, NodeCacheEntry::DATA_ITEMS, &id);
+    if (entry) {
+      entry->data_items.clear();
       if (reply->data.first) {
-        auto data = reply->data.second;
-        updateDataItems(chunk_data_item_query, data);
-      } else {
-        chunk_data_item_query.items.clear();
-        chunk_data_item_query.data_items_loaded = true;
-      }
-
-      if (chunk_data_item_query.ready()) {
-        std::vector<data::ChunkDataItem> items = resultDataItems(
-            chunk_data_item_query);
-        emit chunk_data_item_query.promise->gotInfo(
-            QSharedPointer<dbif::ChunkDataReply>::create(items));
-
-        if (!chunk_data_item_query.sub) {
-          uint64_t qid1 = chunk_data_item_query.children_qid;
-          uint64_t qid2 = chunk_data_item_query.data_items_qid;
-          chunk_data_item_queries_.erase(qid1);
-          chunk_data_item_queries_.erase(qid2);
+        std::shared_ptr<std::vector<std::shared_ptr<messages::MsgpackObject>>>
+            data_items_vector;
+        fromMsgpackObject(reply->data.second, data_items_vector);
+        for (auto item_ptr : *data_items_vector) {
+          entry->data_items.push_back(msgpackToChunkDataItem(item_ptr));
         }
       }
+      entry->loaded[NodeCacheEntry::DATA_ITEMS] = true;
+      notifyWatchers(id, NodeCacheEntry::DATA_ITEMS);
     }
   } else {
     wrongMessageType("get_data_reply", "MsgGetDataReply");
@@ -563,6 +432,25 @@ void NCWrapper::handleQueryErrorMessage(msg_ptr message) {
           << "    code: " << QString::fromStdString(reply->err->code)
           << "  msg: " << QString::fromStdString(reply->err->msg) << endl;
     }
+
+    // The subscription stays active on the server (the node may come back),
+    // but whatever was cached for it is no longer valid.
+    auto qid_iter = node_cache_qids_.find(reply->qid);
+    if (qid_iter != node_cache_qids_.end()) {
+      auto entry_iter = node_cache_.find(qid_iter->second.first);
+      if (entry_iter != node_cache_.end()) {
+        NodeCacheEntry& entry = entry_iter->second;
+        NodeCacheEntry::Part part = qid_iter->second.second;
+        entry.loaded[part] = false;
+        if (part == NodeCacheEntry::NODE) {
+          entry.node = nullptr;
+        } else if (part == NodeCacheEntry::CHILDREN) {
+          entry.children.clear();
+        } else {
+          entry.data_items.clear();
+        }
+      }
+    }
   } else {
     wrongMessageType("query_error", "MsgQueryError");
   }
@@ -574,43 +462,13 @@ void NCWrapper::handleQueryErrorMessage(msg_ptr message) {
 
 dbif::InfoPromise* NCWrapper::handleDescriptionRequest(data::NodeID id,
     bool sub) {
-  uint64_t qid = nc_->nextQid();
-  if(nc_->connectionStatus() == NetworkClient::ConnectionStatus::Connected) {
-    if (nc_->output() && detailed_debug_info_) {
-      *nc_->output() << QString("NCWrapper: Sending MsgGet message "
-          "for node id \"%1\".").arg(id.toHexString()) << endl;
-    }
-
-    auto msg = std::make_shared<proto::MsgGet>(
-        qid,
-        std::make_shared<data::NodeID>(id),
-        sub);
-    nc_->sendMessage(msg);
-  }
-
-  return addInfoPromise(qid, sub);;
+  return watchNode(id, NodeCacheEntry::RequestKind::DESCRIPTION, sub);
 }
 
 dbif::InfoPromise* NCWrapper::handleChildrenRequest(data::NodeID id, bool sub) {
-  uint64_t qid = nc_->nextQid();
-  if(nc_->connectionStatus() == NetworkClient::ConnectionStatus::Connected) {
-    if (nc_->output() && detailed_debug_info_) {
-      *nc_->output() << "NCWrapper: Sending MsgGetList message." << endl;
-    }
-    const auto null_pos = std::pair<bool, int64_t>(false, 0);
-    auto msg = std::make_shared<proto::MsgGetList>(
-        qid,
-        std::make_shared<data::NodeID>(id),
-        std::make_shared<std::unordered_set<std::shared_ptr<std::string>>>(),
-        std::make_shared<proto::PosFilter>(
-            null_pos, null_pos, null_pos, null_pos),
-        sub);
-    nc_->sendMessage(msg);
-  }
-
-  auto promise = addInfoPromise(qid, sub);
+  auto promise = watchNode(id, NodeCacheEntry::RequestKind::CHILDREN, sub);
   if(sub && id == *data::NodeID::getRootNodeId()) {
-    root_children_promises_[qid] = promise;
+    root_children_promises_.push_back(promise);
   }
   return promise;
 }
@@ -646,41 +504,9 @@ dbif::InfoPromise* NCWrapper::handleBlobDataRequest(
 }
 
 dbif::InfoPromise* NCWrapper::handleChunkDataRequest(data::NodeID id, bool sub) {
-  uint64_t qid_data = nc_->nextQid();
-  uint64_t qid_children = nc_->nextQid();
-
-  if(nc_->connectionStatus() == NetworkClient::ConnectionStatus::Connected) {
-    if (nc_->output() && detailed_debug_info_) {
-      *nc_->output() << QString("NCWrapper: Sending MsgGetData and MsgGetList"
-          "message to get chunk data items of node \"%1\".")
-          .arg(id.toHexString()) << endl;
-    }
-
-    auto msg_data = std::make_shared<proto::MsgGetData>(
-        qid_data,
-        std::make_shared<data::NodeID>(id),
-        std::make_shared<std::string>("data_items"),
-        sub);
-    nc_->sendMessage(msg_data);
-
-    const auto null_pos = std::pair<bool, int64_t>(false, 0);
-
-    auto msg_children = std::make_shared<proto::MsgGetList>(
-        qid_children,
-        std::make_shared<data::NodeID>(id),
-        std::make_shared<std::unordered_set<std::shared_ptr<std::string>>>(),
-        std::make_shared<proto::PosFilter>(
-            null_pos, null_pos, null_pos, null_pos),
-        sub);
-    nc_->sendMessage(msg_children);
-  }
-
-  auto query = std::make_shared<ChunkDataItemQuery>(qid_children, qid_data,
-      new dbif::InfoPromise, id, sub);
-  chunk_data_item_queries_[qid_data] = query;
-  chunk_data_item_queries_[qid_children] = query;
-
-  return query->promise;
+  // Both the data items and the children come from the cache - with the
+  // subscriptions already set up, this is answered without a round trip.
+  return watchNode(id, NodeCacheEntry::RequestKind::CHUNK_DATA, sub);
 }
 
 /*****************************************************************************/
@@ -1302,55 +1128,128 @@ bool NCWrapper::nodeToChunkDataItem(
   return false;
 }
 
-void NCWrapper::updateChildrenDataItems(ChunkDataItemQuery& query,
-    std::shared_ptr<std::vector<std::shared_ptr<proto::Node>>> children,
-    std::shared_ptr<std::vector<std::shared_ptr<veles::data::NodeID>>> gone)
-    {
-  for (auto child : *children) {
-    query.children_map[*child->id] = child;
-  }
+dbif::PInfoReply NCWrapper::descriptionReply(
+    std::shared_ptr<proto::Node> node) {
+  QString name("");
+  QString comment("");
 
-  for (auto child_gone : *gone) {
-    query.children_map.erase(*child_gone);
-  }
+  getQStringAttr(node->attr, "name", name);
+  getQStringAttr(node->attr, "comment", comment);
 
-  query.children_loaded = true;
-}
+  dbif::ObjectType node_type = typeFromTags(node->tags);
+
+  if (node_type == dbif::ObjectType::FILE_BLOB
+      || node_type == dbif::ObjectType::SUB_BLOB) {
+
+    uint64_t base(0);
+    uint64_t size(0);
+    uint64_t width(8);
+
+    getAttr<uint64_t>(node->attr, "base", base);
+    getAttr<uint64_t>(node->attr, "size", size);
+    getAttr<uint64_t>(node->attr, "width", width);
+
+    if (node_type == dbif::ObjectType::FILE_BLOB) {
+      QString path;
+      getQStringAttr(node->attr, "path", path);
 
-void NCWrapper::updateDataItems(ChunkDataItemQuery& query,
-    std::shared_ptr<messages::MsgpackObject> data_items) {
-  query.items.clear();
+      if (nc_->output() && detailed_debug_info_) {
+        *nc_->output() << QString("NCWrapper: node description "
+            "(file blob) - name: \"%1\" comment: \"%2\";").arg(name)
+            .arg(comment) << endl << QString("    base: %1; size: %2;"
+            " width: %3; path: \"%4\".").arg(base).arg(size).arg(width)
+            .arg(path) << endl;
+      }
+
+      return QSharedPointer<dbif::FileBlobDescriptionReply>::create(
+          name, comment, base, size, width, path);
+    } else {
+      auto parent = QSharedPointer<NCObjectHandle>::create(
+          this, *node->parent, dbif::ObjectType::CHUNK); //FIXME
 
-  std::shared_ptr<std::vector<std::shared_ptr<messages::MsgpackObject>>>
-      data_items_vector;
-  fromMsgpackObject(data_items, data_items_vector);
-  for (auto item_ptr : *data_items_vector) {
-    auto chunk_data_item = msgpackToChunkDataItem(item_ptr);
+      if (nc_->output() && detailed_debug_info_) {
+        *nc_->output() << QString("NCWrapper: node description "
+            "(sub blob) - name: \"%1\" comment: \"%2\";").arg(name)
+            .arg(comment) << endl << QString("    base: %1; size: %2;"
+            " width: %3.").arg(base).arg(size).arg(width) << endl;
+      }
+
+      return QSharedPointer<dbif::SubBlobDescriptionReply>::create(
+          name, comment, base, size, width, parent);
+    }
+  } else if (node_type == dbif::ObjectType::CHUNK) {
+    data::NodeID blob_id = *data::NodeID::getNilId();
+    getAttrSPtr<data::NodeID>(node->attr, "blob", blob_id);
+    auto blob = QSharedPointer<NCObjectHandle>::create(
+        this, blob_id, dbif::ObjectType::FILE_BLOB); //FIXME
+    auto parent = QSharedPointer<NCObjectHandle>::create(
+        this, *node->parent, dbif::ObjectType::CHUNK);
+    if (*blob == *parent) {
+      parent = QSharedPointer<NCObjectHandle>::create(
+          this, *data::NodeID::getNilId(), dbif::ObjectType::CHUNK);
+    }
+    uint64_t start(0);
+    uint64_t end(0);
+    QString chunk_type;
+
+    if (node->pos_start.first) {
+      start = node->pos_start.second;
+    }
+
+    if (node->pos_end.first) {
+      end = node->pos_end.second;
+    }
 
-    query.items.push_back(chunk_data_item);
+    getQStringAttr(node->attr, "type", chunk_type);
+
+    if (nc_->output() && detailed_debug_info_) {
+      *nc_->output() << QString("NCWrapper: node description "
+          "(chunk) - name: \"%1\" comment: \"%2\";").arg(name)
+          .arg(comment) << endl << QString("    start: %1; end: %2;"
+          " type: \"%3\".").arg(start).arg(end).arg(chunk_type) << endl;
+    }
+
+    return QSharedPointer<dbif::ChunkDescriptionReply>::create(
+        name, comment, blob, parent, start, end, chunk_type);
+  } else {
+    if (nc_->output() && detailed_debug_info_) {
+      *nc_->output() << QString("NCWrapper: node description - name: \""
+          "%1\" comment: \"%2\".").arg(name).arg(comment)<< endl;
+    }
+
+    return QSharedPointer<dbif::DescriptionReply>::create(
+        name, comment);
   }
+}
+
+dbif::PInfoReply NCWrapper::childrenReply(const NodeCacheEntry& entry) {
+  std::vector<dbif::ObjectHandle> objects;
 
-  query.data_items_loaded = true;
+  for (auto child : entry.children) {
+    objects.push_back(QSharedPointer<NCObjectHandle>::create(
+        this, child.first, typeFromTags(child.second->tags)));
+  }
+
+  return QSharedPointer<dbif::ChildrenRequest::ReplyType>::create(objects);
 }
 
-std::vector<data::ChunkDataItem> NCWrapper::resultDataItems(
-    ChunkDataItemQuery& query) {
+dbif::PInfoReply NCWrapper::chunkDataReply(const NodeCacheEntry& entry) {
   std::vector<data::ChunkDataItem> chunk_data_items;
 
-  for (auto child : query.children_map) {
+  for (auto child : entry.children) {
     data::ChunkDataItem child_data_item;
     if (NCWrapper::nodeToChunkDataItem(child.second, child_data_item)) {
       chunk_data_items.push_back(child_data_item);
     }
   }
 
-  for (auto item : query.items) {
+  for (auto item : entry.data_items) {
     if ((item.type == data::ChunkDataItem::SUBBLOB
         || item.type == data::ChunkDataItem::SUBCHUNK)
         && item.ref.size() > 0) {
       auto handle = item.ref[0].dynamicCast<NCObjectHandle>();
-      if(handle && query.children_map.find(handle->id())
-          != query.children_map.end()) {
+      if(handle && entry.children.find(handle->id())
+          != entry.children.end()) {
         continue;
       }
     }
@@ -1358,7 +1257,7 @@ std::vector<data::ChunkDataItem> NCWrapper::resultDataItems(
     chunk_data_items.push_back(item);
   }
 
-  return chunk_data_items;
+  return QSharedPointer<dbif::ChunkDataReply>::create(chunk_data_items);
 }
 
 void NCWrapper::updateConnectionStatus(client::NetworkClient::ConnectionStatus
@@ -1369,32 +1268,28 @@ void NCWrapper::updateConnectionStatus(client::NetworkClient::ConnectionStatus
     promises_.clear();
     method_promises_.clear();
     created_objs_waiting_for_ack_.clear();
-    children_maps_.clear();
+    clearNodeCache();
 
-    const auto null_pos = std::pair<bool, int64_t>(false, 0);
-
-    for (auto entry : root_children_promises_) {
-      auto msg = std::make_shared<proto::MsgGetList>(
-          entry.first,
-          data::NodeID::getRootNodeId(),
-          std::make_shared<std::unordered_set<std::shared_ptr<std::string>>>(),
-          std::make_shared<proto::PosFilter>(
-              null_pos, null_pos, null_pos, null_pos),
-          true);
-      nc_->sendMessage(msg);
-      if (nc_->output() && detailed_debug_info_) {
-        *nc_->output() << "NCWrapper: Sending MsgGetList message for"
-            " the root node." << endl;
+    std::vector<QPointer<dbif::InfoPromise>> root_children_promises;
+    root_children_promises.swap(root_children_promises_);
+    for (auto promise : root_children_promises) {
+      if (promise) {
+        if (nc_->output() && detailed_debug_info_) {
+          *nc_->output() << "NCWrapper: Subscribing to the children of"
+              " the root node." << endl;
+        }
+        root_children_promises_.push_back(watchNode(
+            *data::NodeID::getRootNodeId(),
+            NodeCacheEntry::RequestKind::CHILDREN, true, promise));
       }
-      subscriptions_.insert(entry.first);
-      promises_[entry.first] = entry.second;
     }
   } else if(connection_status ==
       client::NetworkClient::ConnectionStatus::NotConnected) {
-    for (auto entry : root_children_promises_) {
-      if (entry.second) {
+    clearNodeCache();
+    for (auto promise : root_children_promises_) {
+      if (promise) {
         std::vector<dbif::ObjectHandle> objects;
-        emit entry.second->gotInfo(
+        emit promise->gotInfo(
             QSharedPointer<dbif::ChildrenRequest::ReplyType>::create(objects));
       }
     }
@@ -1442,6 +1337,208 @@ dbif::MethodResultPromise* NCWrapper::addMethodPromise(uint64_t qid) {
   return promise;
 }
 
+dbif::InfoPromise* NCWrapper::watchNode(data::NodeID id,
+    NodeCacheEntry::RequestKind kind, bool sub,
+    dbif::InfoPromise* promise) {
+  if (promise == nullptr) {
+    promise = new dbif::InfoPromise;
+  }
+  evictNodeCache();
+
+  auto entry_iter = node_cache_.find(id);
+  if (entry_iter == node_cache_.end()) {
+    entry_iter = node_cache_.insert(
+        std::make_pair(id, NodeCacheEntry())).first;
+    node_cache_lru_.push_front(id);
+  } else {
+    node_cache_lru_.splice(node_cache_lru_.begin(), node_cache_lru_,
+        entry_iter->second.lru_pos);
+  }
+  NodeCacheEntry& entry = entry_iter->second;
+  entry.lru_pos = node_cache_lru_.begin();
+
+  for (int part = 0; part < NodeCacheEntry::PART_COUNT; part++) {
+    if (NodeCacheEntry::needs(kind, static_cast<NodeCacheEntry::Part>(part))
+        && entry.qids[part] == 0) {
+      subscribeNodePart(id, entry, static_cast<NodeCacheEntry::Part>(part));
+    }
+  }
+
+  // Even a one-shot promise answered from the cache is a watcher until
+  // the reply goes out, so that the entry can't be evicted before that.
+  NodeCacheEntry::Watcher watcher = {promise, kind, sub};
+  entry.watchers.push_back(watcher);
+
+  if (entry.ready(kind)) {
+    if (nc_->output() && detailed_debug_info_) {
+      *nc_->output() << QString("NCWrapper: answering a request for node "
+          "\"%1\" from the cache.").arg(id.toHexString()) << endl;
+    }
+    // The caller connects to the promise only after we return it.
+    QTimer::singleShot(0, promise, [this, id, kind, sub, promise]() {
+      answerFromCache(id, kind, sub, promise);
+    });
+  }
+  return promise;
+}
+
+void NCWrapper::answerFromCache(data::NodeID id,
+    NodeCacheEntry::RequestKind kind, bool sub, dbif::InfoPromise* promise) {
+  auto entry_iter = node_cache_.find(id);
+  if (entry_iter == node_cache_.end() || !entry_iter->second.ready(kind)) {
+    return;
+  }
+  NodeCacheEntry& entry = entry_iter->second;
+  auto watcher_iter = std::find_if(entry.watchers.begin(),
+      entry.watchers.end(), [promise](const NodeCacheEntry::Watcher& watcher) {
+        return watcher.promise == promise;
+      });
+  // A one-shot promise may have been answered by an update in the meantime.
+  if (watcher_iter == entry.watchers.end()) {
+    return;
+  }
+  if (!sub) {
+    entry.watchers.erase(watcher_iter);
+  }
+  emit promise->gotInfo(cachedReply(entry, kind));
+}
+
+void NCWrapper::subscribeNodePart(data::NodeID id, NodeCacheEntry& entry,
+    NodeCacheEntry::Part part) {
+  if (nc_->connectionStatus() != NetworkClient::ConnectionStatus::Connected) {
+    return;
+  }
+
+  uint64_t qid = nc_->nextQid();
+  auto id_ptr = std::make_shared<data::NodeID>(id);
+  if (part == NodeCacheEntry::NODE) {
+    if (nc_->output() && detailed_debug_info_) {
+      *nc_->output() << QString("NCWrapper: Sending MsgGet message "
+          "for node id \"%1\".").arg(id.toHexString()) << endl;
+    }
+    nc_->sendMessage(std::make_shared<proto::MsgGet>(qid, id_ptr, true));
+  } else if (part == NodeCacheEntry::CHILDREN) {
+    if (nc_->output() && detailed_debug_info_) {
+      *nc_->output() << QString("NCWrapper: Sending MsgGetList message "
+          "for node id \"%1\".").arg(id.toHexString()) << endl;
+    }
+    const auto null_pos = std::pair<bool, int64_t>(false, 0);
+    nc_->sendMessage(std::make_shared<proto::MsgGetList>(
+        qid,
+        id_ptr,
+        std::make_shared<std::unordered_set<std::shared_ptr<std::string>>>(),
+        std::make_shared<proto::PosFilter>(
+            null_pos, null_pos, null_pos, null_pos),
+        true));
+  } else {
+    if (nc_->output() && detailed_debug_info_) {
+      *nc_->output() << QString("NCWrapper: Sending MsgGetData message "
+          "for node id \"%1\".").arg(id.toHexString()) << endl;
+    }
+    nc_->sendMessage(std::make_shared<proto::MsgGetData>(
+        qid,
+        id_ptr,
+        std::make_shared<std::string>("data_items"),
+        true));
+  }
+
+  entry.qids[part] = qid;
+  node_cache_qids_[qid] = std::make_pair(id, part);
+}
+
+NodeCacheEntry* NCWrapper::nodeCacheEntry(uint64_t qid,
+    NodeCacheEntry::Part part, data::NodeID* id) {
+  auto qid_iter = node_cache_qids_.find(qid);
+  if (qid_iter == node_cache_qids_.end()
+      || qid_iter->second.second != part) {
+    return nullptr;
+  }
+  auto entry_iter = node_cache_.find(qid_iter->second.first);
+  if (entry_iter == node_cache_.end()) {
+    return nullptr;
+  }
+  *id = entry_iter->first;
+  return &entry_iter->second;
+}
+
+dbif::PInfoReply NCWrapper::cachedReply(const NodeCacheEntry& entry,
+    NodeCacheEntry::RequestKind kind) {
+  switch (kind) {
+  case NodeCacheEntry::RequestKind::DESCRIPTION:
+    return descriptionReply(entry.node);
+  case NodeCacheEntry::RequestKind::CHILDREN:
+    return childrenReply(entry);
+  case NodeCacheEntry::RequestKind::CHUNK_DATA:
+    return chunkDataReply(entry);
+  }
+  return dbif::PInfoReply();
+}
+
+void NCWrapper::notifyWatchers(data::NodeID id, NodeCacheEntry::Part part) {
+  // Receivers may send new requests from their slots, which can add
+  // watchers to this entry or evict others - so the entry is looked up
+  // again after every reply, and only watchers present now are notified.
+  auto entry_iter = node_cache_.find(id);
+  if (entry_iter == node_cache_.end()) {
+    return;
+  }
+  size_t count = entry_iter->second.watchers.size();
+  for (size_t i = 0; i < count; i++) {
+    entry_iter = node_cache_.find(id);
+    if (entry_iter == node_cache_.end()
+        || i >= entry_iter->second.watchers.size()) {
+      return;
+    }
+    NodeCacheEntry& entry = entry_iter->second;
+    NodeCacheEntry::Watcher watcher = entry.watchers[i];
+    if (!watcher.promise || !NodeCacheEntry::needs(watcher.kind, part)
+        || !entry.ready(watcher.kind)) {
+      continue;
+    }
+    if (!watcher.sub) {
+      entry.watchers[i].promise = nullptr;
+    }
+    emit watcher.promise->gotInfo(cachedReply(entry, watcher.kind));
+  }
+
+  entry_iter = node_cache_.find(id);
+  if (entry_iter != node_cache_.end()) {
+    auto& watchers = entry_iter->second.watchers;
+    watchers.erase(std::remove_if(watchers.begin(), watchers.end(),
+        [](const NodeCacheEntry::Watcher& watcher) {
+          return !watcher.promise;
+        }), watchers.end());
+  }
+}
+
+void NCWrapper::evictNodeCache() {
+  auto lru_iter = node_cache_lru_.end();
+  while (node_cache_.size() > NODE_CACHE_SIZE
+      && lru_iter != node_cache_lru_.begin()) {
+    --lru_iter;
+    auto entry_iter = node_cache_.find(*lru_iter);
+    if (entry_iter->second.watched()) {
+      continue;
+    }
+    for (int part = 0; part < NodeCacheEntry::PART_COUNT; part++) {
+      uint64_t qid = entry_iter->second.qids[part];
+      if (qid != 0) {
+        nc_->sendMessage(std::make_shared<proto::MsgCancelSubscription>(qid));
+        node_cache_qids_.erase(qid);
+      }
+    }
+    node_cache_.erase(entry_iter);
+    lru_iter = node_cache_lru_.erase(lru_iter);
+  }
+}
+
+void NCWrapper::clearNodeCache() {
+  // The subscriptions are gone along with the connection.
+  node_cache_.clear();
+  node_cache_lru_.clear();
+  node_cache_qids_.clear();
+}
+
 void NCWrapper::wrongMessageType(QString name, QString expected_type) {
   if (nc_->output()) {
     *nc_->output() << QString("NCWrapper: error - declared message type is "
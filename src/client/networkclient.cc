@@ -22,6 +22,7 @@
 
 #include <QHostAddress>
 
+#include "network/compression.h"
 #include "proto/exceptions.h"
 #include "client/node.h"
 #include "client/nodetree.h"
@@ -59,7 +60,13 @@ NetworkClient::NetworkClient(QObject* parent) : QObject(parent),
     protocol_version_(1), client_name_(""),
     client_version_("[unspecified version]"), client_description_(""),
     client_type_(""), authentication_key_(""), quit_on_close_(false),
+    flush_timer_(new QTimer(this)), batch_messages_(false),
+    compress_messages_(false),
     output_stream_(nullptr), qid_(0) {
+  flush_timer_->setSingleShot(true);
+  flush_timer_->setInterval(0);
+  QObject::connect(flush_timer_, &QTimer::timeout,
+      this, &NetworkClient::flushMessages);
   registerMessageHandlers();
 }
 
@@ -99,49 +106,93 @@ void NetworkClient::connect(
 
   if (status_ != ConnectionStatus::Connected
       && status_ != ConnectionStatus::Connecting) {
-    client_socket_ = new QTcpSocket(this);
-    QObject::connect(client_socket_, &QAbstractSocket::connected,
-        this, &NetworkClient::socketConnected, Qt::QueuedConnection);
-    QObject::connect(client_socket_, &QAbstractSocket::disconnected,
-        this, &NetworkClient::socketDisconnected, Qt::QueuedConnection);
-    QObject::connect(client_socket_, &QIODevice::readyRead,
-        this, &NetworkClient::newDataAvailable);
-    QObject::connect(client_socket_,
-        static_cast<void(QAbstractSocket::*)(QAbstractSocket::SocketError)>(
-        &QAbstractSocket::error), this, &NetworkClient::socketError);
+    if (local_server_name_.isEmpty()) {
+      connectTcpSocket();
+    } else {
+      connectLocalSocket();
+    }
+  }
+}
+
+void NetworkClient::connectTcpSocket() {
+  QTcpSocket* socket = new QTcpSocket(this);
+  client_socket_ = socket;
+  QObject::connect(socket, &QAbstractSocket::connected,
+      this, &NetworkClient::socketConnected, Qt::QueuedConnection);
+  QObject::connect(socket, &QAbstractSocket::disconnected,
+      this, &NetworkClient::socketDisconnected, Qt::QueuedConnection);
+  QObject::connect(socket, &QIODevice::readyRead,
+      this, &NetworkClient::newDataAvailable);
+  QObject::connect(socket,
+      static_cast<void(QAbstractSocket::*)(QAbstractSocket::SocketError)>(
+      &QAbstractSocket::error), this, &NetworkClient::socketError);
+
+  if (output()) {
+  *output() << "NetworkClient::connect" << endl
+      << "    client interface: " << client_interface_name_ << endl
+      << "    server host: " << server_name_ << endl
+      << "    server port: " << server_port_ << endl;
+  }
 
+  if (1) {
+  // TODO: Why is bind causing a problem here?
+  // if (socket->bind(QHostAddress(client_interface_name))) {
     if (output()) {
-    *output() << "NetworkClient::connect" << endl
-        << "    client interface: " << client_interface_name_ << endl
-        << "    server host: " << server_name_ << endl
-        << "    server port: " << server_port_ << endl;
+      *output() << "NetworkClient: bind successful." << endl;
     }
-
-    if (1) {
-    // TODO: Why is bind causing a problem here?
-    // if (client_socket_->bind(QHostAddress(client_interface_name))) {
-      if (output()) {
-        *output() << "NetworkClient: bind successful." << endl;
-      }
-      client_socket_->connectToHost(server_name_, server_port_);
-      setConnectionStatus(ConnectionStatus::Connecting);
-    } else {
-      if (output()) {
-        *output() << "NetworkClient: bind failed." << endl;
-      }
+    socket->connectToHost(server_name_, server_port_);
+    setConnectionStatus(ConnectionStatus::Connecting);
+  } else {
+    if (output()) {
+      *output() << "NetworkClient: bind failed." << endl;
     }
   }
 }
 
+void NetworkClient::connectLocalSocket() {
+  QLocalSocket* socket = new QLocalSocket(this);
+  client_socket_ = socket;
+  QObject::connect(socket, &QLocalSocket::connected,
+      this, &NetworkClient::socketConnected, Qt::QueuedConnection);
+  QObject::connect(socket, &QLocalSocket::disconnected,
+      this, &NetworkClient::socketDisconnected, Qt::QueuedConnection);
+  QObject::connect(socket, &QIODevice::readyRead,
+      this, &NetworkClient::newDataAvailable);
+  QObject::connect(socket,
+      static_cast<void(QLocalSocket::*)(QLocalSocket::LocalSocketError)>(
+      &QLocalSocket::error), this, &NetworkClient::localSocketError);
+
+  if (output()) {
+    *output() << "NetworkClient::connect" << endl
+        << "    local server: " << local_server_name_ << endl;
+  }
+
+  socket->connectToServer(local_server_name_);
+  setConnectionStatus(ConnectionStatus::Connecting);
+}
+
+bool NetworkClient::socketValid() {
+  if (auto socket = qobject_cast<QTcpSocket*>(client_socket_)) {
+    return socket->isValid();
+  }
+  if (auto socket = qobject_cast<QLocalSocket*>(client_socket_)) {
+    return socket->isValid();
+  }
+  return false;
+}
+
 void NetworkClient::disconnect() {
   if (output()) {
     *output() << "NetworkClient: Disconnect." << endl;
   }
 
+  flushMessages();
   setConnectionStatus(ConnectionStatus::NotConnected);
 
-  if(client_socket_) {
-    client_socket_->disconnectFromHost();
+  if (auto socket = qobject_cast<QTcpSocket*>(client_socket_)) {
+    socket->disconnectFromHost();
+  } else if (auto socket = qobject_cast<QLocalSocket*>(client_socket_)) {
+    socket->disconnectFromServer();
   }
 }
 
@@ -185,6 +236,18 @@ void NetworkClient::setOutput(QTextStream* stream) {
   output_stream_ = stream;
 }
 
+void NetworkClient::setBatchMessages(bool batch) {
+  batch_messages_ = batch;
+}
+
+void NetworkClient::setCompressMessages(bool compress) {
+  compress_messages_ = compress;
+}
+
+void NetworkClient::setLocalServerName(QString name) {
+  local_server_name_ = name;
+}
+
 void NetworkClient::sendMsgConnect() {
   std::shared_ptr<std::string> client_name_ptr(
       new std::string(client_name_.toStdString()));
@@ -252,6 +315,10 @@ void NetworkClient::registerMessageHandlers() {
       = &NetworkClient::handleBroadcastRunMessage;
   message_handlers_["plugin_handler_unregistered"]
       = &NetworkClient::handlePluginHandlerUnregisteredMessage;
+  message_handlers_["compression_set"]
+      = &NetworkClient::handleCompressionSetMessage;
+  message_handlers_["compressed"]
+      = &NetworkClient::handleCompressedMessage;
 }
 
 void NetworkClient::handleNodeTreeRelatedMessage(msg_ptr msg) {
@@ -270,6 +337,15 @@ void NetworkClient::handleConnectedMessage(msg_ptr msg) {
     }
 
     setConnectionStatus(ConnectionStatus::Connected);
+
+    if (compress_messages_) {
+      auto algorithms = std::make_shared<
+          std::vector<std::shared_ptr<std::string>>>();
+      for (const auto& algorithm : messages::compressionAlgorithms()) {
+        algorithms->push_back(std::make_shared<std::string>(algorithm));
+      }
+      sendMessage(std::make_shared<proto::MsgSetCompression>(algorithms));
+    }
   }
 }
 
@@ -374,11 +450,106 @@ void NetworkClient::handlePluginHandlerUnregisteredMessage(msg_ptr msg) {
   // TODO - is this something that client should implement in a subclass?
 }
 
+void NetworkClient::handleCompressionSetMessage(msg_ptr msg) {
+  proto::MsgCompressionSet* csm
+      = dynamic_cast<proto::MsgCompressionSet*>(msg.get());
+  if (csm) {
+    if (csm->algorithm.first
+        && messages::compressionSupported(*csm->algorithm.second)) {
+      compression_ = *csm->algorithm.second;
+    } else {
+      compression_.clear();
+    }
+    if (output()) {
+      *output() << "NetworkClient: Compression: "
+          << (compression_.empty() ? QString("none")
+          : QString::fromStdString(compression_)) << "." << endl;
+    }
+  }
+}
+
+void NetworkClient::handleCompressedMessage(msg_ptr msg) {
+  proto::MsgCompressed* cm = dynamic_cast<proto::MsgCompressed*>(msg.get());
+  if (!cm) {
+    return;
+  }
+
+  messages::MsgpackWrapper wrapper;
+  try {
+    auto data = messages::decompress(*cm->algorithm, *cm->data);
+    wrapper.feed(data.data(), data.size());
+  } catch (proto::SchemaError& schema_error) {
+    if (output()) {
+      *output() << "NetworkClient: SchemaError - "
+          << QString::fromStdString(schema_error.msg) << endl;
+    }
+    return;
+  }
+
+  while (client_socket_) {
+    msg_ptr inner_msg = nullptr;
+    try {
+      inner_msg = wrapper.nextMessage();
+    } catch (proto::SchemaError& schema_error) {
+      if (output()) {
+        *output() << "NetworkClient: SchemaError - "
+            << QString::fromStdString(schema_error.msg) << endl;
+      }
+      continue;
+    }
+    if (!inner_msg) {
+      break;
+    }
+    handleMessage(inner_msg);
+  }
+}
+
 void NetworkClient::sendMessage(msg_ptr msg) {
-  if (client_socket_ && client_socket_->isValid()) {
-    msgpack::sbuffer buf;
-    msgpack::packer<msgpack::sbuffer> packer(buf);
-    messages::MsgpackWrapper::dumpObject(packer, msg);
+  if (socketValid()) {
+    pending_messages_.push_back(msg);
+    if (!flush_timer_->isActive()) {
+      flush_timer_->start();
+    }
+  }
+}
+
+void NetworkClient::flushMessages() {
+  flush_timer_->stop();
+  if (pending_messages_.empty()) {
+    return;
+  }
+  std::vector<msg_ptr> pending;
+  pending.swap(pending_messages_);
+  if (!socketValid()) {
+    return;
+  }
+
+  msgpack::sbuffer buf;
+  msgpack::packer<msgpack::sbuffer> packer(buf);
+  // The server only takes batches once the connection is set up.
+  if (batch_messages_ && pending.size() > 1
+      && status_ == ConnectionStatus::Connected) {
+    auto batch = std::make_shared<proto::MsgBatch>(
+        std::make_shared<std::vector<msg_ptr>>(std::move(pending)));
+    messages::MsgpackWrapper::dumpObject(packer, batch);
+  } else {
+    for (const auto& msg : pending) {
+      messages::MsgpackWrapper::dumpObject(packer, msg);
+    }
+  }
+
+  std::vector<uint8_t> compressed;
+  if (!compression_.empty()
+      && messages::compress(compression_, buf.data(), buf.size(),
+      &compressed)) {
+    msgpack::sbuffer compressed_buf;
+    msgpack::packer<msgpack::sbuffer> compressed_packer(compressed_buf);
+    auto msg = std::make_shared<proto::MsgCompressed>(
+        std::make_shared<std::string>(compression_),
+        std::make_shared<std::vector<uint8_t>>(std::move(compressed)));
+    messages::MsgpackWrapper::dumpObject(compressed_packer, msg);
+    client_socket_->write(compressed_buf.data(), compressed_buf.size());
+  } else {
     client_socket_->write(buf.data(), buf.size());
   }
 }
@@ -406,6 +577,8 @@ void NetworkClient::socketConnected() {
 }
 
 void NetworkClient::socketDisconnected() {
+  pending_messages_.clear();
+  compression_.clear();
   setConnectionStatus(ConnectionStatus::NotConnected);
   if(output()) {
     *output() << "NetworkClient: TCP socket disconnected." << endl;
@@ -422,35 +595,47 @@ void NetworkClient::socketDisconnected() {
 }
 
 void NetworkClient::newDataAvailable() {
+  // Take everything the socket has buffered in one go and handle all the
+  // complete messages it contains, rather than a message per read.
+  if (!client_socket_ || !msgpack_wrapper_.readAvailable(client_socket_)) {
+    return;
+  }
+
   while (client_socket_) {
     msg_ptr msg = nullptr;
     try {
-      msg = msgpack_wrapper_.loadMessage(client_socket_);
+      msg = msgpack_wrapper_.nextMessage();
     } catch (proto::SchemaError& schema_error) {
       if (output()) {
         *output() << "NetworkClient: SchemaError - "
             << QString::fromStdString(schema_error.msg) << endl;
       }
+      // The broken message has been consumed - go on with the rest.
+      continue;
     }
 
     if (msg) {
-      auto handler_iter = message_handlers_.find(msg->object_type);
-      if(handler_iter != message_handlers_.end()) {
-        MessageHandler handler = handler_iter->second;
-        (this->*handler)(msg);
-      } else {
-        if (output()) {
-          *output() << "NetworkClient: Received message of not handled "
-              "type: \"" << msg->object_type.c_str() << "\"." << endl;
-        }
-      }
-      emit messageReceived(msg);
+      handleMessage(msg);
     } else {
       break;
     }
   }
 }
 
+void NetworkClient::handleMessage(msg_ptr msg) {
+  auto handler_iter = message_handlers_.find(msg->object_type);
+  if(handler_iter != message_handlers_.end()) {
+    MessageHandler handler = handler_iter->second;
+    (this->*handler)(msg);
+  } else {
+    if (output()) {
+      *output() << "NetworkClient: Received message of not handled "
+          "type: \"" << msg->object_type.c_str() << "\"." << endl;
+    }
+  }
+  emit messageReceived(msg);
+}
+
 void NetworkClient::socketError(QAbstractSocket::SocketError socketError) {
   setConnectionStatus(ConnectionStatus::NotConnected);
   if (output() && client_socket_) {
@@ -459,5 +644,25 @@ void NetworkClient::socketError(QAbstractSocket::SocketError socketError) {
   }
 }
 
+void NetworkClient::localSocketError(
+    QLocalSocket::LocalSocketError socketError) {
+  if (output() && client_socket_) {
+    *output() << "NetworkClient: Local socket error - "
+        << client_socket_->errorString() << endl;
+  }
+
+  // The server can't be reached locally (eg. it doesn't listen on a local
+  // socket) - try TCP instead.
+  if (status_ == ConnectionStatus::Connecting && client_socket_
+      && !socketValid()) {
+    client_socket_->deleteLater();
+    client_socket_ = nullptr;
+    connectTcpSocket();
+    return;
+  }
+
+  setConnectionStatus(ConnectionStatus::NotConnected);
+}
+
 } // client
 } // veles
@@ -1,5 +1,8 @@
 #include "data/nodeid.h"
 
+#include <array>
+#include <random>
+
 #include "util/encoders/hex_encoder.h"
 
 using veles::util::encoders::HexEncoder;
@@ -13,16 +16,28 @@ const uint8_t NodeID::ROOT_VALUE[NodeID::WIDTH] = {
   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
 };
 
-std::mt19937 NodeID::random_= [](){
-    std::array<int, 5> seed_data;
+namespace {
+
+std::mt19937_64& randomGenerator() {
+  thread_local std::mt19937_64 generator = [](){
+    std::array<std::random_device::result_type, 8> seed_data;
     std::random_device r;
     std::generate_n(seed_data.data(), seed_data.size(), std::ref(r));
     std::seed_seq seq(seed_data.begin(), seed_data.end());
-    return std::mt19937(seq);
+    return std::mt19937_64(seq);
   }();
+  return generator;
+}
+
+}  // namespace
 
 NodeID::NodeID() {
-  std::generate_n(value, WIDTH, std::ref(random_));
+  // A whole 64-bit word per generator call, not a byte.
+  std::mt19937_64& generator = randomGenerator();
+  for (size_t i = 0; i < WIDTH; i += 8) {
+    uint64_t word = generator();
+    memcpy(value + i, &word, 8);
+  }
 }
 
 NodeID::NodeID(const uint8_t* data) {
@@ -64,26 +79,6 @@ std::shared_ptr<NodeID> NodeID::getNilId() {
   return nil;
 }
 
-bool NodeID::operator==(const NodeID &other) const {
-  return memcmp(this->value, other.value, WIDTH) == 0;
-}
-
-bool NodeID::operator!=(const NodeID &other) const {
-  return !(*this == other);
-}
-
-bool NodeID::operator<(const NodeID& other) const {
-  for(unsigned int i = 0; i < WIDTH; ++i) {
-    if(value[i] < other.value[i]) {
-      return true;
-    } else if(value[i] > other.value[i]) {
-      return false;
-    }
-  }
-
-  return false;
-}
-
 NodeID::operator bool() const {
   return memcmp(this->value, NIL_VALUE, WIDTH) != 0;
 }
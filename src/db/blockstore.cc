@@ -0,0 +1,212 @@
+/*
+ * Copyright 2017 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include <algorithm>
+#include <cstring>
+
+#include <QHash>
+#include <QMutexLocker>
+
+#include "db/blockstore.h"
+
+namespace veles {
+namespace db {
+
+namespace {
+
+// Block sizes, in octets.  Blocks are cut where the low bits of the
+// rolling hash selected by BLOCK_MASK are all zero, which makes them
+// about 8KiB on average.
+const size_t MIN_BLOCK_SIZE = 0x800;
+const size_t MAX_BLOCK_SIZE = 0x10000;
+const uint64_t BLOCK_MASK = 0x1fff;
+
+struct GearTable {
+  uint64_t values[256];
+  GearTable() {
+    // splitmix64 - the table only has to be fixed and well mixed.
+    uint64_t state = 0x56454c45534c424bULL;
+    for (auto &value : values) {
+      uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      value = z ^ (z >> 31);
+    }
+  }
+};
+
+const GearTable GEAR;
+
+}  // namespace
+
+DataBlock::DataBlock(const uint8_t *data, size_t octets, uint hash)
+    : data_(new uint8_t[octets]), octets_(octets), hash_(hash) {
+  memcpy(data_, data, octets);
+}
+
+BlockStore *BlockStore::instance() {
+  // Never destroyed - blocks may outlive static destruction.
+  static BlockStore *store = new BlockStore;
+  return store;
+}
+
+PDataBlock BlockStore::intern(const uint8_t *data, size_t octets) {
+  uint hash = qHashBits(data, octets);
+  QMutexLocker lock(&mutex_);
+  for (auto iter = blocks_.find(hash);
+       iter != blocks_.end() && iter.key() == hash; ++iter) {
+    const DataBlock *block = iter->block;
+    if (block->octets() != octets ||
+        memcmp(block->data(), data, octets) != 0) {
+      continue;
+    }
+    // May be null if the block is being released right now.
+    if (PDataBlock res = iter->ref.toStrongRef()) {
+      return res;
+    }
+  }
+  PDataBlock res(new DataBlock(data, octets, hash), &BlockStore::release);
+  blocks_.insert(hash, Entry{res.data(), res.toWeakRef()});
+  octets_ += octets;
+  return res;
+}
+
+void BlockStore::release(DataBlock *block) {
+  BlockStore *store = instance();
+  {
+    QMutexLocker lock(&store->mutex_);
+    for (auto iter = store->blocks_.find(block->hash_);
+         iter != store->blocks_.end() && iter.key() == block->hash_; ++iter) {
+      if (iter->block == block) {
+        store->blocks_.erase(iter);
+        break;
+      }
+    }
+    store->octets_ -= block->octets();
+  }
+  delete block;
+}
+
+uint64_t BlockStore::octets() {
+  QMutexLocker lock(&mutex_);
+  return octets_;
+}
+
+BlockData::BlockData(const data::BinData &data)
+    : width_(data.width()), size_(data.size()) {
+  split(data.rawData(), data.octets(), blocks_);
+  uint64_t pos = 0;
+  for (auto &block : blocks_) {
+    starts_.push_back(pos);
+    pos += block->octets() / octetsPerElement();
+  }
+}
+
+void BlockData::split(const uint8_t *data, size_t octets,
+                      std::vector<PDataBlock> &out) const {
+  BlockStore *store = BlockStore::instance();
+  unsigned element = octetsPerElement();
+  size_t start = 0;
+  uint64_t hash = 0;
+  for (size_t i = 0; i < octets; i++) {
+    hash = (hash << 1) + GEAR.values[data[i]];
+    size_t len = i + 1 - start;
+    if (len < MIN_BLOCK_SIZE || len % element != 0) {
+      continue;
+    }
+    if ((hash & BLOCK_MASK) == 0 || len + element > MAX_BLOCK_SIZE) {
+      out.push_back(store->intern(data + start, len));
+      start = i + 1;
+      hash = 0;
+    }
+  }
+  if (start < octets) {
+    out.push_back(store->intern(data + start, octets - start));
+  }
+}
+
+size_t BlockData::blockAt(uint64_t pos) const {
+  auto iter = std::upper_bound(starts_.begin(), starts_.end(), pos);
+  return iter == starts_.begin() ? 0 : iter - starts_.begin() - 1;
+}
+
+data::BinData BlockData::data(uint64_t start, uint64_t end) const {
+  end = std::min(end, size_);
+  if (end <= start) {
+    return data::BinData(width_, 0);
+  }
+  data::BinData res(width_, end - start);
+  unsigned element = octetsPerElement();
+  uint8_t *dst = res.rawData();
+  for (size_t idx = blockAt(start); idx < blocks_.size(); idx++) {
+    uint64_t block_start = starts_[idx];
+    if (block_start >= end) {
+      break;
+    }
+    uint64_t block_end = block_start + blocks_[idx]->octets() / element;
+    uint64_t from = std::max(start, block_start);
+    uint64_t to = std::min(end, block_end);
+    size_t octets = (to - from) * element;
+    memcpy(dst, blocks_[idx]->data() + (from - block_start) * element,
+           octets);
+    dst += octets;
+  }
+  return res;
+}
+
+void BlockData::setData(uint64_t start, uint64_t end,
+                        const data::BinData &data) {
+  unsigned element = octetsPerElement();
+  // Blocks [first, last) are the ones being replaced.
+  size_t first = 0;
+  size_t last = 0;
+  if (!blocks_.empty()) {
+    first = blockAt(std::min(start, size_ - 1));
+    last = end > start ? blockAt(end - 1) + 1 : first + 1;
+  }
+  std::vector<uint8_t> merged;
+  if (first < last) {
+    const PDataBlock &head = blocks_[first];
+    const PDataBlock &tail = blocks_[last - 1];
+    size_t prefix = (start - starts_[first]) * element;
+    size_t suffix = (std::max(end, starts_[last - 1]) - starts_[last - 1]) *
+        element;
+    merged.reserve(prefix + data.octets() + tail->octets() - suffix);
+    merged.insert(merged.end(), head->data(), head->data() + prefix);
+    merged.insert(merged.end(), data.rawData(),
+                  data.rawData() + data.octets());
+    merged.insert(merged.end(), tail->data() + suffix,
+                  tail->data() + tail->octets());
+  } else {
+    merged.assign(data.rawData(), data.rawData() + data.octets());
+  }
+  std::vector<PDataBlock> replacement;
+  split(merged.data(), merged.size(), replacement);
+  blocks_.erase(blocks_.begin() + first, blocks_.begin() + last);
+  blocks_.insert(blocks_.begin() + first, replacement.begin(),
+                 replacement.end());
+  size_ = size_ - (end - start) + data.size();
+  starts_.resize(first);
+  uint64_t pos = first ? starts_[first - 1] +
+      blocks_[first - 1]->octets() / element : 0;
+  for (size_t idx = first; idx < blocks_.size(); idx++) {
+    starts_.push_back(pos);
+    pos += blocks_[idx]->octets() / element;
+  }
+}
+
+}  // namespace db
+}  // namespace veles
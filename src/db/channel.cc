@@ -0,0 +1,238 @@
+/*
+ * Copyright 2017 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include <QCoreApplication>
+#include <QEvent>
+#include <QThread>
+
+#include "db/channel.h"
+#include "db/object.h"
+#include "dbif/error.h"
+#include "dbif/info.h"
+#include "dbif/method.h"
+
+namespace veles {
+namespace db {
+
+namespace {
+
+const size_t MAX_POOLED_SLOTS = 1024;
+
+QEvent::Type drainEventType() {
+  static int type = QEvent::registerEventType();
+  return static_cast<QEvent::Type>(type);
+}
+
+}  // namespace
+
+RequestChannel::RequestChannel(QObject *parent)
+    : QObject(parent), head_(&stub_), tail_(&stub_), scheduled_(false),
+      getter_(new InfoGetter), runner_(new MethodRunner) {
+  stub_.next.store(nullptr);
+  getter_->setParent(this);
+  runner_->setParent(this);
+}
+
+RequestChannel::~RequestChannel() {
+  while (Node *node = pop()) {
+    freeSlot(static_cast<Slot *>(node));
+  }
+  for (auto slot : pool_) {
+    delete slot;
+  }
+}
+
+void RequestChannel::push(Node *node) {
+  node->next.store(nullptr, std::memory_order_relaxed);
+  Node *prev = head_.exchange(node, std::memory_order_acq_rel);
+  prev->next.store(node, std::memory_order_release);
+}
+
+RequestChannel::Node *RequestChannel::pop() {
+  Node *tail = tail_;
+  Node *next = tail->next.load(std::memory_order_acquire);
+  if (tail == &stub_) {
+    if (!next) {
+      return nullptr;
+    }
+    tail_ = next;
+    tail = next;
+    next = next->next.load(std::memory_order_acquire);
+  }
+  if (next) {
+    tail_ = next;
+    return tail;
+  }
+  if (tail != head_.load(std::memory_order_acquire)) {
+    // A producer is in the middle of push(), it will schedule another
+    // drain when it's done.
+    return nullptr;
+  }
+  push(&stub_);
+  next = tail->next.load(std::memory_order_acquire);
+  if (next) {
+    tail_ = next;
+    return tail;
+  }
+  return nullptr;
+}
+
+RequestChannel::Slot *RequestChannel::allocSlot() {
+  {
+    std::unique_lock<std::mutex> lc(pool_mutex_);
+    if (!pool_.empty()) {
+      Slot *slot = pool_.back();
+      pool_.pop_back();
+      return slot;
+    }
+  }
+  Slot *slot = new Slot;
+  slot->blob_write = false;
+  return slot;
+}
+
+void RequestChannel::freeSlot(Slot *slot) {
+  if (slot->blob_write) {
+    slot->obj.staticCast<DataBlobObject>()->writeDone();
+    slot->blob_write = false;
+  }
+  slot->obj.clear();
+  slot->info_req.clear();
+  slot->method_req.clear();
+  slot->info_done = nullptr;
+  slot->method_done = nullptr;
+  slot->sub_getter.clear();
+  std::unique_lock<std::mutex> lc(pool_mutex_);
+  if (pool_.size() < MAX_POOLED_SLOTS) {
+    pool_.push_back(slot);
+  } else {
+    delete slot;
+  }
+}
+
+void RequestChannel::enqueue(Slot *slot) {
+  if (QThread::currentThread() == thread()) {
+    dispatch(slot);
+    freeSlot(slot);
+    return;
+  }
+  push(slot);
+  if (!scheduled_.exchange(true)) {
+    QCoreApplication::postEvent(this, new QEvent(drainEventType()));
+  }
+}
+
+void RequestChannel::dispatch(Slot *slot) {
+  if (slot->info_req && !slot->info_done) {
+    // The promise may have gone away (along with the getter) already.
+    if (InfoGetter *getter = slot->sub_getter) {
+      if (slot->obj->dead()) {
+        getter->sendError<dbif::ObjectGoneError>();
+      } else {
+        slot->obj->getInfo(getter, slot->info_req, false);
+      }
+    }
+    return;
+  }
+  if (slot->obj->dead()) {
+    if (slot->info_req) {
+      slot->info_done(PInfoReply(),
+                      QSharedPointer<dbif::ObjectGoneError>::create());
+    } else {
+      slot->method_done(PMethodReply(),
+                        QSharedPointer<dbif::ObjectGoneError>::create());
+    }
+    return;
+  }
+  // Save and restore the callbacks, in case a callback makes another
+  // direct request.
+  if (slot->info_req) {
+    auto saved = getter_->setCallback(slot->info_done);
+    slot->obj->getInfo(getter_, slot->info_req, true);
+    getter_->setCallback(saved);
+  } else {
+    auto saved = runner_->setCallback(slot->method_done);
+    slot->obj->runMethod(runner_, slot->method_req);
+    runner_->setCallback(saved);
+  }
+}
+
+void RequestChannel::drain() {
+  // Anything pushed after this point will schedule another drain.
+  scheduled_.store(false);
+  while (Node *node = pop()) {
+    Slot *slot = static_cast<Slot *>(node);
+    dispatch(slot);
+    freeSlot(slot);
+  }
+}
+
+bool RequestChannel::event(QEvent *event) {
+  if (event->type() == drainEventType()) {
+    drain();
+    return true;
+  }
+  return QObject::event(event);
+}
+
+void RequestChannel::getInfo(PLocalObject obj, PInfoRequest req,
+                             InfoCallback done) {
+  // Blob data reads are the bulk of the traffic and only need a read lock
+  // on the blob, serve them right here instead of queueing them behind
+  // everything else - unless a write to the blob is still queued.
+  if (auto datareq = req.dynamicCast<dbif::BlobDataRequest>()) {
+    auto blob = obj.dynamicCast<DataBlobObject>();
+    if (blob && !blob->hasPendingWrites()) {
+      PInfoReply reply;
+      PError err;
+      blob->readData(datareq->start, datareq->end, reply, err);
+      done(reply, err);
+      return;
+    }
+  }
+  Slot *slot = allocSlot();
+  slot->obj = obj;
+  slot->info_req = req;
+  slot->info_done = done;
+  enqueue(slot);
+}
+
+void RequestChannel::runMethod(PLocalObject obj, PMethodRequest req,
+                               MethodCallback done) {
+  Slot *slot = allocSlot();
+  slot->obj = obj;
+  slot->method_req = req;
+  slot->method_done = done;
+  if (req.dynamicCast<dbif::ChangeDataRequest>()) {
+    if (auto blob = obj.dynamicCast<DataBlobObject>()) {
+      blob->writeQueued();
+      slot->blob_write = true;
+    }
+  }
+  enqueue(slot);
+}
+
+void RequestChannel::subInfo(PLocalObject obj, PInfoRequest req,
+                             InfoGetter *getter) {
+  Slot *slot = allocSlot();
+  slot->obj = obj;
+  slot->info_req = req;
+  slot->sub_getter = getter;
+  enqueue(slot);
+}
+
+}  // namespace db
+}  // namespace veles
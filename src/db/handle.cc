@@ -14,7 +14,14 @@
  * limitations under the License.
  *
  */
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+#include <QThread>
+
 #include "db/handle.h"
+#include "db/channel.h"
 #include "db/universe.h"
 #include "db/object.h"
 #include "db/getter.h"
@@ -26,18 +33,70 @@
 namespace veles {
 namespace db {
 
+namespace {
+
+template<typename Reply>
+struct SyncWait {
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool done = false;
+  Reply reply;
+  PError err;
+
+  void finish(Reply r, PError e) {
+    std::unique_lock<std::mutex> lc(mutex);
+    reply = r;
+    err = e;
+    done = true;
+    cv.notify_one();
+  }
+
+  Reply wait() {
+    std::unique_lock<std::mutex> lc(mutex);
+    cv.wait(lc, [this] () { return done; });
+    if (err) {
+      throw err;
+    }
+    return reply;
+  }
+};
+
+}  // namespace
+
+PInfoReply LocalObjectHandle::baseSyncGetInfo(PInfoRequest req) {
+  // Info requests are answered synchronously by the database thread, so
+  // this never waits on the database thread itself - the request is run
+  // directly there.
+  auto wait = std::make_shared<SyncWait<PInfoReply>>();
+  db_->channel()->getInfo(obj_, req, [wait] (PInfoReply reply, PError err) {
+    wait->finish(reply, err);
+  });
+  return wait->wait();
+}
+
+PMethodReply LocalObjectHandle::baseSyncRunMethod(PMethodRequest req) {
+  QThread *current = QThread::currentThread();
+  // Parse requests are answered from the parser thread, after running
+  // the parser there - blocking either of the two threads involved would
+  // deadlock, so fall back to spinning the event loop.
+  if (req.dynamicCast<dbif::BlobParseRequest>() &&
+      (current == db_->thread() || current == db_->parserThread())) {
+    return ObjectHandleBase::baseSyncRunMethod(req);
+  }
+  auto wait = std::make_shared<SyncWait<PMethodReply>>();
+  db_->channel()->runMethod(obj_, req,
+                            [wait] (PMethodReply reply, PError err) {
+    wait->finish(reply, err);
+  });
+  return wait->wait();
+}
+
 InfoPromise *LocalObjectHandle::getInfo(PInfoRequest req) {
   InfoPromise *promise = new InfoPromise;
-  InfoGetter *getter = new InfoGetter;
-  getter->moveToThread(db_->thread());
-  QObject::connect(getter, &InfoGetter::gotInfo, promise, &InfoPromise::gotInfo);
-  QObject::connect(getter, &InfoGetter::gotError, promise, &InfoPromise::gotError);
-  QObject::connect(getter, &InfoGetter::gotInfo, promise, &QObject::deleteLater);
-  QObject::connect(getter, &InfoGetter::gotError, promise, &QObject::deleteLater);
-  QObject::connect(getter, &QObject::destroyed, promise, &QObject::deleteLater);
-  QObject::connect(promise, &QObject::destroyed, getter, &QObject::deleteLater);
-  QObject::connect(getter, &InfoGetter::getInfo, db_, &Universe::getInfo);
-  emit getter->getInfo(obj_, getter, req, true);
+  dbif::PPromiseLink link = promise->link();
+  db_->channel()->getInfo(obj_, req, [link] (PInfoReply reply, PError err) {
+    InfoPromise::deliver(link, reply, err);
+  });
   return promise;
 }
 
@@ -50,29 +109,30 @@ InfoPromise *LocalObjectHandle::subInfo(PInfoRequest req) {
   QObject::connect(getter, &InfoGetter::gotError, promise, &QObject::deleteLater);
   QObject::connect(getter, &QObject::destroyed, promise, &QObject::deleteLater);
   QObject::connect(promise, &QObject::destroyed, getter, &QObject::deleteLater);
-  QObject::connect(getter, &InfoGetter::getInfo, db_, &Universe::getInfo);
-  emit getter->getInfo(obj_, getter, req, false);
+  // Through the channel, so that the subscription is set up after any
+  // request made by this thread before.
+  db_->channel()->subInfo(obj_, req, getter);
   return promise;
 }
 
 MethodResultPromise *LocalObjectHandle::runMethod(PMethodRequest req) {
   MethodResultPromise *promise = new MethodResultPromise;
-  MethodRunner *runner = new MethodRunner;
-  runner->moveToThread(db_->thread());
-  QObject::connect(runner, &MethodRunner::gotResult, promise, &MethodResultPromise::gotResult);
-  QObject::connect(runner, &MethodRunner::gotError, promise, &MethodResultPromise::gotError);
-  QObject::connect(runner, &MethodRunner::gotResult, promise, &QObject::deleteLater);
-  QObject::connect(runner, &MethodRunner::gotError, promise, &QObject::deleteLater);
-  QObject::connect(runner, &QObject::destroyed, promise, &QObject::deleteLater);
-  QObject::connect(promise, &QObject::destroyed, runner, &QObject::deleteLater);
-  QObject::connect(runner, &MethodRunner::runMethod, db_, &Universe::runMethod);
-  emit runner->runMethod(obj_, runner, req);
+  dbif::PPromiseLink link = promise->link();
+  db_->channel()->runMethod(obj_, req,
+                            [link] (PMethodReply reply, PError err) {
+    MethodResultPromise::deliver(link, reply, err);
+  });
   return promise;
 }
 
 MethodRunner *MethodRunner::forwarder(QThread *thread) {
   MethodRunner *res = new MethodRunner;
   res->moveToThread(thread);
+  if (callback_) {
+    // Callbacks are thread-safe, the reply can skip this runner.
+    res->setCallback(callback_);
+    return res;
+  }
   QObject::connect(res, &MethodRunner::gotResult, this, &MethodRunner::gotResult);
   QObject::connect(res, &MethodRunner::gotError, this, &MethodRunner::gotError);
   return res;
@@ -14,10 +14,13 @@
  * limitations under the License.
  *
  */
+#include <algorithm>
+
 #include "db/handle.h"
 #include "db/object.h"
 #include "db/getter.h"
 #include "db/universe.h"
+#include "dbif/deferred.h"
 #include "dbif/error.h"
 #include "dbif/info.h"
 #include "dbif/method.h"
@@ -25,13 +28,98 @@
 namespace veles {
 namespace db {
 
+namespace {
+
+bool rangeChanged(uint64_t range_start, uint64_t range_end,
+                  uint64_t start, uint64_t end) {
+  if (start == end) {
+    // Insertion, only splits ranges it lands strictly inside of.
+    return range_start < start && start < range_end;
+  }
+  return range_start < end && start < range_end;
+}
+
+bool recordChanged(const dbif::PDeferredChunk &record,
+                   uint64_t start, uint64_t end) {
+  if (rangeChanged(record->start, record->end, start, end)) {
+    return true;
+  }
+  const dbif::ChunkItemStore &items = record->items;
+  for (size_t idx = 0; idx < items.size(); idx++) {
+    if (items.type(idx) == data::ChunkDataItem::FIELD &&
+        rangeChanged(items.start(idx), items.end(idx), start, end)) {
+      return true;
+    }
+  }
+  for (auto &child : record->children) {
+    if (recordChanged(child, start, end)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/** Maps blob positions from before to after [start, end) got replaced
+    with end - start + shift bytes.  */
+struct Move {
+  uint64_t start;
+  uint64_t end;
+  int64_t shift;
+
+  uint64_t pos(uint64_t old_pos, bool range_end) const {
+    // Bytes inserted right at the end of a range don't belong to it.
+    if (range_end ? old_pos <= start : old_pos < start) {
+      return old_pos;
+    }
+    if (old_pos >= end) {
+      return old_pos + shift;
+    }
+    // Inside the replaced part, which may have shrunk.
+    return std::min(old_pos, uint64_t(end + shift));
+  }
+
+  /** Returns true if the range moved.  */
+  bool range(uint64_t &range_start, uint64_t &range_end) const {
+    uint64_t new_start = pos(range_start, false);
+    uint64_t new_end = std::max(new_start, pos(range_end, true));
+    bool res = new_start != range_start || new_end != range_end;
+    range_start = new_start;
+    range_end = new_end;
+    return res;
+  }
+
+  void record(const dbif::PDeferredChunk &rec) const {
+    range(rec->start, rec->end);
+    dbif::ChunkItemStore &items = rec->items;
+    for (size_t idx = 0; idx < items.size(); idx++) {
+      if (dbif::ChunkItemStore::hasBlobRange(items.type(idx))) {
+        uint64_t item_start = items.start(idx);
+        uint64_t item_end = items.end(idx);
+        range(item_start, item_end);
+        items.setRange(idx, item_start, item_end);
+      }
+    }
+    for (auto &child : rec->children) {
+      record(child);
+    }
+  }
+};
+
+}  // namespace
+
 std::atomic<uint64_t> LocalObject::static_id_;
 
 void LocalObject::getInfo(InfoGetter *getter, PInfoRequest req, bool once) {
-  if (req.dynamicCast<dbif::ChildrenRequest>()) {
+  if (auto chreq = req.dynamicCast<dbif::ChildrenRequest>()) {
+    if (!once) {
+      // Children added since the last flush would otherwise reach a new
+      // watcher twice - in the list below, and in the next
+      // ChildrenAddedReply.
+      flush_children();
+    }
     children_reply(getter);
     if (!once) {
-      children_watchers_.insert(getter);
+      children_watchers_.insert(getter, chreq->deltas);
       auto shared_this = sharedFromThis();
       QObject::connect(getter, &QObject::destroyed, [shared_this, getter] () {
         shared_this->remove_children_watcher(getter);
@@ -78,14 +166,34 @@ void LocalObject::runMethod(MethodRunner *runner, PMethodRequest req) {
 
 void LocalObject::addChild(PLocalObject obj) {
   children_.insert(obj);
+  added_children_.insert(obj);
+  children_updated();
+}
+
+void LocalObject::addChildren(const QList<PLocalObject> &objs) {
+  for (auto &obj : objs) {
+    children_.insert(obj);
+    added_children_.insert(obj);
+  }
   children_updated();
 }
 
 void LocalObject::delChild(PLocalObject obj) {
-  children_.remove(obj);
+  // Objects killed before being attached (eg. by a failed project load)
+  // were never announced.
+  if (!children_.remove(obj)) {
+    return;
+  }
+  if (!added_children_.remove(obj)) {
+    children_removed_ = true;
+  }
   children_updated();
 }
 
+void LocalObject::setName(QString name) {
+  name_ = name;
+}
+
 void LocalObject::setComment(QString comment) {
   comment_ = comment;
 }
@@ -103,15 +211,52 @@ void LocalObject::description_reply(InfoGetter *getter) {
 }
 
 void LocalObject::children_updated() {
-  for (InfoGetter *getter : children_watchers_) {
-    children_reply(getter);
+  children_dirty_ = true;
+  if (!dead()) {
+    db()->scheduleUpdate(sharedFromThis());
   }
 }
 
 void LocalObject::description_updated() {
-  for (InfoGetter *getter : description_watchers_) {
-    description_reply(getter);
+  description_dirty_ = true;
+  if (!dead()) {
+    db()->scheduleUpdate(sharedFromThis());
+  }
+}
+
+void LocalObject::flushUpdates() {
+  if (description_dirty_) {
+    description_dirty_ = false;
+    for (InfoGetter *getter : description_watchers_) {
+      description_reply(getter);
+    }
+  }
+  flush_children();
+}
+
+void LocalObject::flush_children() {
+  if (!children_dirty_) {
+    return;
+  }
+  children_dirty_ = false;
+  std::vector<dbif::ObjectHandle> added;
+  if (!children_removed_) {
+    for (PLocalObject obj : added_children_) {
+      added.push_back(db()->handle(obj));
+    }
+  }
+  for (auto iter = children_watchers_.begin();
+       iter != children_watchers_.end(); ++iter) {
+    if (iter.value() && !children_removed_) {
+      if (!added.empty()) {
+        iter.key()->sendInfo<dbif::ChildrenAddedReply>(added);
+      }
+    } else {
+      children_reply(iter.key());
+    }
   }
+  added_children_.clear();
+  children_removed_ = false;
 }
 
 void LocalObject::kill() {
@@ -123,7 +268,7 @@ void LocalObject::kill() {
     obj->kill();
   }
 
-  auto children_watchers = children_watchers_;
+  auto children_watchers = children_watchers_.keys();
   for (auto getter: children_watchers) {
     getter->sendError<dbif::ObjectGoneError>();
   }
@@ -140,6 +285,25 @@ void RootLocalObject::runMethod(MethodRunner *runner, PMethodRequest req) {
   if (auto blobreq = req.dynamicCast<dbif::RootCreateFileBlobFromDataRequest>()) {
     PLocalObject obj = FileBlobObject::create(this, blobreq->data, blobreq->path);
     runner->sendResult<dbif::CreatedReply>(db()->handle(obj));
+  } else if (auto savereq = req.dynamicCast<dbif::RootSaveProjectRequest>()) {
+    QString error;
+    if (saveProject(this, savereq->path, &error)) {
+      runner->sendResult<dbif::NullReply>();
+    } else {
+      runner->sendError<dbif::ProjectFileError>(error);
+    }
+  } else if (auto loadreq = req.dynamicCast<dbif::RootLoadProjectRequest>()) {
+    QString error;
+    QList<PLocalObject> blobs;
+    if (loadProject(this, loadreq->path, &blobs, &error)) {
+      std::vector<dbif::ObjectHandle> handles;
+      for (auto blob : blobs) {
+        handles.push_back(db()->handle(blob));
+      }
+      runner->sendResult<dbif::ProjectLoadedReply>(handles);
+    } else {
+      runner->sendError<dbif::ProjectFileError>(error);
+    }
   } else {
     LocalObject::runMethod(runner, req);
   }
@@ -168,9 +332,63 @@ void DataBlobObject::description_reply(InfoGetter *getter) {
 
 void DataBlobObject::data_reply(InfoGetter *getter, uint64_t start, uint64_t end) {
     end = std::min(end, uint64_t(data_.size()));
+    start = std::min(start, end);
     getter->sendInfo<dbif::BlobDataReply>(data_.data(start, end));
 }
 
+void DataBlobObject::data_delta_reply(InfoGetter *getter,
+                                      const DataWatch &watch, uint64_t start,
+                                      uint64_t end, int64_t shift) {
+  // Positions below are relative to watch.start.
+  auto viewSize = [&watch] (uint64_t total) {
+    uint64_t view_end = std::min(watch.end, total);
+    return view_end > watch.start ? view_end - watch.start : 0;
+  };
+  auto viewPos = [&watch] (uint64_t pos) {
+    return pos > watch.start ? pos - watch.start : 0;
+  };
+  uint64_t new_size = viewSize(data_.size());
+  uint64_t old_size = viewSize(data_.size() - shift);
+  // Everything before the edit stays.
+  uint64_t head = std::min({viewPos(start), old_size, new_size});
+  // Everything past the edit is the old view moved by shift - as long
+  // as it doesn't reach past the old view's end, which happens when
+  // data scrolls in from behind it.
+  uint64_t tail = std::max(head, viewPos(end + shift));
+  if (shift > 0) {
+    tail = std::max(tail, uint64_t(shift));
+  }
+  if (tail >= new_size || int64_t(new_size) - shift > int64_t(old_size)) {
+    tail = new_size;
+  }
+  uint64_t removed = tail == new_size ? old_size - head : tail - shift - head;
+  if (removed == 0 && tail == head && old_size == new_size) {
+    return;
+  }
+  if (!watch.deltas || tail - head >= new_size) {
+    data_reply(getter, watch.start, watch.end);
+    return;
+  }
+  getter->sendInfo<dbif::BlobDataDeltaReply>(
+      head, removed, data_.data(watch.start + head, watch.start + tail),
+      new_size);
+}
+
+void DataBlobObject::readData(uint64_t start, uint64_t end,
+                              PInfoReply &reply, PError &err) const {
+  QReadLocker lock(&data_lock_);
+  if (gone_) {
+    err = QSharedPointer<dbif::ObjectGoneError>::create();
+    return;
+  }
+  if (start > data_.size()) {
+    err = QSharedPointer<dbif::BlobDataInvalidRangeError>::create();
+    return;
+  }
+  end = std::max(start, std::min(end, uint64_t(data_.size())));
+  reply = QSharedPointer<dbif::BlobDataReply>::create(data_.data(start, end));
+}
+
 void DataBlobObject::remove_data_watcher(InfoGetter *getter) {
   data_watchers_.remove(getter);
 }
@@ -183,7 +401,8 @@ void DataBlobObject::getInfo(InfoGetter *getter, PInfoRequest req, bool once) {
     }
     data_reply(getter, datareq->start, datareq->end);
     if (!once) {
-      data_watchers_[getter] = { datareq->start, datareq->end };
+      data_watchers_[getter] = DataWatch{datareq->start, datareq->end,
+                                         datareq->deltas};
       auto shared_this = sharedFromThis();
       QObject::connect(getter, &QObject::destroyed, [shared_this, getter] () {
         shared_this.dynamicCast<DataBlobObject>()->remove_data_watcher(getter);
@@ -208,35 +427,33 @@ void DataBlobObject::runMethod(MethodRunner *runner, PMethodRequest req) {
       runner->sendError<dbif::BlobDataInvalidWidthError>();
       return;
     }
-    if (oldsize == newdata.size()) {
+    {
+      QWriteLocker lock(&data_lock_);
       data_.setData(start, end, newdata);
-    } else {
-      data::BinData merged(data_.width(), data_.size() - oldsize + newdata.size());
-      merged.setData(0, start, data_.data(0, start));
-      uint64_t newend = start + newdata.size();
-      merged.setData(start, newend, newdata);
-      merged.setData(newend, merged.size(), data_.data(end, data_.size()));
-      std::swap(data_, merged);
-    }
-    bool moved = newdata.size() != oldsize;
+    }
+    int64_t shift = int64_t(newdata.size()) - int64_t(oldsize);
     for (auto iter = data_watchers_.begin(); iter != data_watchers_.end(); iter++) {
-      if (iter.value().second >= start &&
-          (moved || iter.value().first <= end)) {
-        data_reply(iter.key(), iter.value().first, iter.value().second);
-      }
+      data_delta_reply(iter.key(), iter.value(), start, end, shift);
     }
+    reparse_changed(start, end, shift);
     runner->sendResult<dbif::NullReply>();
   } else if (auto chreq = req.dynamicCast<dbif::ChunkCreateRequest>()) {
     PLocalObject parent_chunk;
     if (chreq->parent_chunk) {
-      parent_chunk = chreq->parent_chunk.dynamicCast<LocalObjectHandle>()->obj();
+      auto parent_handle = chreq->parent_chunk.dynamicCast<LocalObjectHandle>();
+      if (!parent_handle) {
+        runner->sendError<dbif::InvalidTypeError>();
+        return;
+      }
+      parent_chunk = parent_handle->obj();
       if (!parent_chunk.dynamicCast<ChunkObject>()) {
         runner->sendError<dbif::InvalidTypeError>();
         return;
       }
     }
     PLocalObject obj = ChunkObject::create(sharedFromThis(), parent_chunk,
-      chreq->start, chreq->end, chreq->chunk_type, chreq->name);
+      chreq->start, chreq->end, chreq->chunk_type, chreq->name,
+      chreq->parser_id);
     runner->sendResult<dbif::CreatedReply>(db()->handle(obj));
   } else if (auto parse_req = req.dynamicCast<dbif::BlobParseRequest>()) {
     emit db()->parse(
@@ -247,8 +464,95 @@ void DataBlobObject::runMethod(MethodRunner *runner, PMethodRequest req) {
   }
 }
 
+void DataBlobObject::reparse_changed(uint64_t start, uint64_t end,
+                                     int64_t shift) {
+  QList<QSharedPointer<ChunkObject>> stale;
+  for (PLocalObject obj : children()) {
+    if (auto chunk = obj.dynamicCast<ChunkObject>()) {
+      chunk->collectStale(start, end, stale);
+    }
+  }
+  QList<QPair<QSharedPointer<ChunkObject>, QList<ChunkLabel>>> runs;
+  for (auto chunk : stale) {
+    QList<ChunkLabel> labels;
+    chunk->collectLabels(start, end, shift, labels);
+    runs.append(qMakePair(chunk, labels));
+    chunk->kill();
+  }
+  if (shift != 0) {
+    for (PLocalObject obj : children()) {
+      if (auto chunk = obj.dynamicCast<ChunkObject>()) {
+        chunk->move(start, end, shift);
+      }
+    }
+  }
+  for (auto &run : runs) {
+    auto chunk = run.first;
+    uint64_t parse_start = Move{start, end, shift}.pos(chunk->start(), false);
+    dbif::ObjectHandle parent_chunk = db()->handle(chunk->parentChunk());
+    MethodRunner *runner = new MethodRunner;
+    runner->moveToThread(db()->parserThread());
+    if (!run.second.isEmpty()) {
+      // The parser is done by the time it replies, put the user's labels
+      // back on whatever it re-created.
+      auto self = sharedFromThis();
+      auto labels = run.second;
+      QObject::connect(runner, &MethodRunner::gotResult, db(),
+                       [self, labels] () {
+        if (!self->dead()) {
+          self.staticCast<DataBlobObject>()->applyLabels(labels);
+        }
+      });
+    }
+    emit db()->parse(db()->handle(sharedFromThis()), runner,
+                     chunk->parserId(), parse_start, parent_chunk);
+  }
+}
+
+void DataBlobObject::applyLabels(const QList<ChunkLabel> &labels) {
+  for (auto &label : labels) {
+    // Only chunks around the label's position need to exist for real.
+    QList<PLocalObject> level = children().toList();
+    QSharedPointer<ChunkObject> found;
+    while (!found && !level.isEmpty()) {
+      QList<PLocalObject> next;
+      for (PLocalObject obj : level) {
+        auto chunk = obj.dynamicCast<ChunkObject>();
+        if (!chunk || label.start < chunk->start() ||
+            label.start > chunk->end()) {
+          continue;
+        }
+        if (chunk->start() == label.start &&
+            chunk->chunkType() == label.chunk_type) {
+          found = chunk;
+          break;
+        }
+        chunk->expandDeferred();
+        next.append(chunk->children().toList());
+      }
+      level.swap(next);
+    }
+    if (!found) {
+      continue;
+    }
+    if (label.has_name) {
+      found->setName(label.name);
+      found->user_name_ = true;
+    }
+    if (label.has_comment) {
+      found->setComment(label.comment);
+      found->user_comment_ = true;
+    }
+    found->description_updated();
+  }
+}
+
 void DataBlobObject::killed() {
   LocalObject::killed();
+  {
+    QWriteLocker lock(&data_lock_);
+    gone_ = true;
+  }
   parent_->delChild(sharedFromThis());
   auto data_watchers = data_watchers_.keys();
   for (auto getter: data_watchers) {
@@ -274,21 +578,36 @@ void ChunkObject::children_updated() {
 }
 
 void ChunkObject::parse_updated() {
-  calcParseReplyItems();
-  for (InfoGetter *getter : parse_watchers_) {
-    parse_reply(getter);
+  parse_dirty_ = true;
+  if (!dead()) {
+    db()->scheduleUpdate(sharedFromThis());
+  }
+}
+
+void ChunkObject::flushUpdates() {
+  LocalObject::flushUpdates();
+  if (parse_dirty_) {
+    parse_dirty_ = false;
+    if (!parse_watchers_.isEmpty()) {
+      auto items = parseReplyItems();
+      for (InfoGetter *getter : parse_watchers_) {
+        getter->sendInfo<dbif::ChunkDataReply>(items);
+      }
+    }
   }
 }
 
-void ChunkObject::calcParseReplyItems() {
-  parseReplyItems_ = items_;
+std::vector<data::ChunkDataItem> ChunkObject::parseReplyItems() const {
+  std::vector<data::ChunkDataItem> res = items_.items();
 
   QSet<PLocalObject> chunksInItems;
-  for (auto &item : items_) {
-    if (item.type != data::ChunkDataItem::SUBCHUNK) {
+  for (size_t idx = 0; idx < items_.size(); idx++) {
+    if (items_.type(idx) != data::ChunkDataItem::SUBCHUNK ||
+        !items_.refCount(idx)) {
       continue;
     }
-    if (auto localObjectHandle = item.ref[0].dynamicCast<LocalObjectHandle>()) {
+    if (auto localObjectHandle =
+            items_.ref(idx, 0).dynamicCast<LocalObjectHandle>()) {
       chunksInItems.insert(localObjectHandle->obj());
     }
   }
@@ -298,18 +617,189 @@ void ChunkObject::calcParseReplyItems() {
       continue;
     }
     if (auto chunkObj = obj.dynamicCast<ChunkObject>()) {
-      parseReplyItems_.push_back(
+      res.push_back(
           data::ChunkDataItem::subchunk(chunkObj->start_, chunkObj->end_,
                                         chunkObj->name(), db()->handle(obj)));
     } else if (auto subBlobObj = obj.dynamicCast<SubBlobObject>()) {
-      parseReplyItems_.push_back(
+      res.push_back(
           data::ChunkDataItem::subblob(subBlobObj->name(), db()->handle(obj)));
     }
   }
+  return res;
+}
+
+void ChunkObject::calcDeps() {
+  Ranges ranges;
+  if (end_ > start_) {
+    ranges.push_back(std::make_pair(start_, end_));
+  }
+  for (size_t idx = 0; idx < items_.size(); idx++) {
+    if (items_.type(idx) == data::ChunkDataItem::FIELD &&
+        items_.end(idx) > items_.start(idx)) {
+      ranges.push_back(std::make_pair(items_.start(idx), items_.end(idx)));
+    }
+  }
+  std::sort(ranges.begin(), ranges.end());
+  deps_.clear();
+  for (auto &range : ranges) {
+    if (!deps_.empty() && range.first <= deps_.back().second) {
+      deps_.back().second = std::max(deps_.back().second, range.second);
+    } else {
+      deps_.push_back(range);
+    }
+  }
+}
+
+bool ChunkObject::depsChanged(uint64_t start, uint64_t end) const {
+  // deps_ is sorted and disjoint, so the first candidate is the last range
+  // starting before the edit.
+  auto iter = std::lower_bound(deps_.begin(), deps_.end(),
+                               std::make_pair(start, uint64_t(0)));
+  if (iter != deps_.begin()) {
+    --iter;
+  }
+  for (; iter != deps_.end(); ++iter) {
+    if (rangeChanged(iter->first, iter->second, start, end)) {
+      return true;
+    }
+    if (iter->first >= end) {
+      break;
+    }
+  }
+  for (auto &record : deferred_) {
+    if (recordChanged(record, start, end)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ChunkObject::collectStale(uint64_t start, uint64_t end,
+                               QList<QSharedPointer<ChunkObject>> &stale) {
+  QList<QSharedPointer<ChunkObject>> inner;
+  // A subtree still sitting in a project file can't be checked without
+  // loading it.
+  if (!stored_.isNull() &&
+      rangeChanged(stored_.start, stored_.end, start, end)) {
+    expandStored();
+  }
+  bool changed = depsChanged(start, end);
+  for (PLocalObject obj : children()) {
+    if (auto chunk = obj.dynamicCast<ChunkObject>()) {
+      if (chunk->collectStale(start, end, inner)) {
+        changed = true;
+      }
+    }
+  }
+  if (changed && !parser_id_.isEmpty()) {
+    // Whole parser run has to be redone, nested ones go away with it.
+    stale.append(sharedFromThis().staticCast<ChunkObject>());
+    return false;
+  }
+  stale.append(inner);
+  return changed;
+}
+
+void ChunkObject::move(uint64_t start, uint64_t end, int64_t shift) {
+  Move change{start, end, shift};
+  bool bounds_moved = change.range(start_, end_);
+  bool items_moved = false;
+  for (size_t idx = 0; idx < items_.size(); idx++) {
+    if (dbif::ChunkItemStore::hasBlobRange(items_.type(idx))) {
+      uint64_t item_start = items_.start(idx);
+      uint64_t item_end = items_.end(idx);
+      if (change.range(item_start, item_end)) {
+        items_.setRange(idx, item_start, item_end);
+        items_moved = true;
+      }
+    }
+  }
+  for (auto &record : deferred_) {
+    change.record(record);
+  }
+  // collectStale loaded the body if the edit reached into it, so it's
+  // either entirely before or entirely past the edit.
+  if (!stored_.isNull() && stored_.start >= end) {
+    stored_.start += shift;
+    stored_.end += shift;
+    stored_.shift += shift;
+  }
+  if (bounds_moved || items_moved) {
+    calcDeps();
+  }
+  if (bounds_moved) {
+    description_updated();
+  }
+  if (items_moved) {
+    parse_updated();
+  }
+  for (PLocalObject obj : children()) {
+    if (auto chunk = obj.dynamicCast<ChunkObject>()) {
+      chunk->move(start, end, shift);
+    }
+  }
+}
+
+void ChunkObject::collectLabels(uint64_t start, uint64_t end, int64_t shift,
+                                QList<ChunkLabel> &labels) {
+  // Labels could be hiding in a part which hasn't been looked at since
+  // loading.
+  expandStored();
+  if (user_name_ || user_comment_) {
+    ChunkLabel label;
+    label.start = Move{start, end, shift}.pos(start_, false);
+    label.chunk_type = chunkType();
+    label.has_name = user_name_;
+    label.name = name();
+    label.has_comment = user_comment_;
+    label.comment = comment();
+    labels.append(label);
+  }
+  for (PLocalObject obj : children()) {
+    if (auto chunk = obj.dynamicCast<ChunkObject>()) {
+      chunk->collectLabels(start, end, shift, labels);
+    }
+  }
+}
+
+void ChunkObject::expandDeferred() {
+  expandStored();
+  if (deferred_.empty()) {
+    return;
+  }
+  std::vector<dbif::PDeferredChunk> deferred;
+  deferred.swap(deferred_);
+  QMap<dbif::DeferredChunk *, PLocalObject> created;
+  QList<PLocalObject> objs;
+  for (auto &record : deferred) {
+    auto chunk = QSharedPointer<ChunkObject>::create(
+        blob_, sharedFromThis(), record->start, record->end, record->type,
+        record->name, QString());
+    chunk->setComment(record->comment);
+    chunk->items_ = record->items;
+    chunk->calcDeps();
+    chunk->deferred_ = record->children;
+    created[record.data()] = chunk;
+    objs.append(chunk);
+  }
+  for (size_t idx = 0; idx < items_.size(); idx++) {
+    if (items_.type(idx) != data::ChunkDataItem::SUBCHUNK ||
+        !items_.refCount(idx)) {
+      continue;
+    }
+    if (auto handle =
+            items_.ref(idx, 0).dynamicCast<dbif::DeferredChunkHandle>()) {
+      auto iter = created.find(handle->record().data());
+      if (iter != created.end()) {
+        items_.setRef(idx, 0, db()->handle(iter.value()));
+      }
+    }
+  }
+  addChildren(objs);
 }
 
 void ChunkObject::parse_reply(InfoGetter *getter) {
-  getter->sendInfo<dbif::ChunkDataReply>(parseReplyItems_);
+  getter->sendInfo<dbif::ChunkDataReply>(parseReplyItems());
 }
 
 void RootLocalObject::parsers_list_reply(InfoGetter *getter) {
@@ -329,7 +819,7 @@ void RootLocalObject::parsers_list_updated() {
 void ChunkObject::description_reply(InfoGetter *getter) {
   getter->sendInfo<dbif::ChunkDescriptionReply>(
     name(), comment(), db()->handle(blob_), db()->handle(parent_chunk_),
-    start_, end_, chunk_type_
+    start_, end_, chunkType()
   );
 }
 
@@ -338,6 +828,14 @@ void ChunkObject::remove_parse_watcher(InfoGetter *getter) {
 }
 
 void ChunkObject::getInfo(InfoGetter *getter, PInfoRequest req, bool once) {
+  if (req.dynamicCast<dbif::ChunkDataRequest>() ||
+      req.dynamicCast<dbif::ChildrenRequest>()) {
+    expandDeferred();
+    if (!stored_error_.isEmpty()) {
+      getter->sendError<dbif::ProjectFileError>(stored_error_);
+      return;
+    }
+  }
   if (auto datareq = req.dynamicCast<dbif::ChunkDataRequest>()) {
     parse_reply(getter);
     if (!once) {
@@ -356,12 +854,23 @@ void ChunkObject::runMethod(MethodRunner *runner, PMethodRequest req) {
   if (auto chreq = req.dynamicCast<dbif::SetChunkBoundsRequest>()) {
     start_ = chreq->start;
     end_ = chreq->end;
+    calcDeps();
     description_updated();
     runner->sendResult<dbif::NullReply>();
   } else if (auto preq = req.dynamicCast<dbif::SetChunkParseRequest>()) {
+    // Stored children would otherwise come back on top of the new parse.
+    expandStored();
     start_ = preq->start;
     end_ = preq->end;
-    items_ = preq->items;
+    items_.assign(preq->items);
+    deferred_.insert(deferred_.end(), preq->deferred.begin(),
+                     preq->deferred.end());
+    calcDeps();
+    // Somebody is already looking at this chunk, there's no point in
+    // waiting for the next request.
+    if (hasChildrenWatchers() || !parse_watchers_.isEmpty()) {
+      expandDeferred();
+    }
     description_updated();
     parse_updated();
     runner->sendResult<dbif::NullReply>();
@@ -369,6 +878,11 @@ void ChunkObject::runMethod(MethodRunner *runner, PMethodRequest req) {
     PLocalObject obj = SubBlobObject::create(this, blobreq->data, blobreq->name);
     runner->sendResult<dbif::CreatedReply>(db()->handle(obj));
   } else {
+    if (req.dynamicCast<dbif::SetNameRequest>()) {
+      user_name_ = true;
+    } else if (auto creq = req.dynamicCast<dbif::SetCommentRequest>()) {
+      user_comment_ = !creq->from_parser;
+    }
     LocalObject::runMethod(runner, req);
   }
 }
@@ -379,6 +893,11 @@ void ChunkObject::killed() {
     parent_chunk_->delChild(sharedFromThis());
   else
     blob_->delChild(sharedFromThis());
+  // Unexpanded children and items may refer back to this chunk or its
+  // ancestors, drop them so that the whole subtree can be freed.
+  deferred_.clear();
+  stored_ = StoredChunkBody();
+  items_ = dbif::ChunkItemStore();
 
   auto parse_watchers = parse_watchers_;
   for (auto getter: parse_watchers) {
@@ -0,0 +1,725 @@
+/*
+ * Copyright 2017 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include <algorithm>
+#include <cstring>
+
+#include <QDataStream>
+#include <QHash>
+#include <QIODevice>
+#include <QSaveFile>
+
+#include "db/handle.h"
+#include "db/object.h"
+#include "db/storage.h"
+#include "db/universe.h"
+#include "dbif/deferred.h"
+
+namespace veles {
+namespace db {
+
+/* Snapshot layout, everything in QDataStream encoding:
+
+   file:       magic, version, u32 count, count * file blob
+   file blob:  path, name, comment, data, chunk list
+   sub blob:   name, comment, data, chunk list
+   chunk list: u32 count, count * chunk
+   chunk:      name, comment, u8 flags, type, parser id, u64 start,
+               u64 end, u64 extent start, u64 extent end, u64 body size,
+               body
+   body:       u32 count, count * (u8 kind, chunk or sub blob),
+               u32 count, count * item
+
+   Item references are indices into the children list of the body they
+   are in.  Bodies are self-contained, so a chunk which hasn't been looked
+   into since loading can be written out by copying its body verbatim.  */
+
+namespace {
+
+const quint32 PROJECT_MAGIC = 0x56454c50;  // "VELP"
+const quint32 PROJECT_VERSION = 2;
+const QDataStream::Version STREAM_VERSION = QDataStream::Qt_5_0;
+// QDataStream takes raw data sizes as ints, bigger pieces are written in
+// parts of this size.
+const qint64 MAX_RAW_WRITE = 1 << 30;
+
+enum RecordKind : quint8 {
+  CHUNK_RECORD = 0,
+  SUB_BLOB_RECORD = 1,
+};
+
+enum ChunkFlags : quint8 {
+  USER_NAME = 1,
+  USER_COMMENT = 2,
+};
+
+struct Extent {
+  uint64_t start;
+  uint64_t end;
+
+  Extent() : start(0), end(0) {}
+  void add(uint64_t range_start, uint64_t range_end) {
+    if (range_end <= range_start) {
+      return;
+    }
+    if (end <= start) {
+      start = range_start;
+      end = range_end;
+    } else {
+      start = std::min(start, range_start);
+      end = std::max(end, range_end);
+    }
+  }
+  void add(const Extent &other) { add(other.start, other.end); }
+};
+
+bool itemHasRange(data::ChunkDataItem::ChunkDataItemType type) {
+  return type != data::ChunkDataItem::SUBBLOB &&
+      type != data::ChunkDataItem::COMPUTED;
+}
+
+bool itemHasValue(data::ChunkDataItem::ChunkDataItemType type) {
+  return type == data::ChunkDataItem::FIELD ||
+      type == data::ChunkDataItem::BITFIELD ||
+      type == data::ChunkDataItem::COMPUTED;
+}
+
+/** Read-only device over a part of a mapped project file.  Unlike
+    a QBuffer over a QByteArray view, it isn't limited to int sizes.  */
+class MappedDevice : public QIODevice {
+  const char *data_;
+  qint64 size_;
+
+ protected:
+  qint64 readData(char *data, qint64 max_size) override {
+    qint64 len = std::min(max_size, size_ - pos());
+    memcpy(data, data_ + pos(), size_t(len));
+    return len;
+  }
+  qint64 writeData(const char *, qint64) override { return -1; }
+
+ public:
+  MappedDevice(const uchar *data, qint64 size)
+      : data_(reinterpret_cast<const char *>(data)), size_(size) {
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+  }
+  qint64 size() const override { return size_; }
+  /** The data at the current position.  */
+  const char *current() const { return data_ + pos(); }
+};
+
+}  // namespace
+
+ProjectFile::ProjectFile(const QString &path)
+    : file_(path), data_(nullptr), size_(0) {}
+
+ProjectFile::~ProjectFile() {
+  if (data_) {
+    file_.unmap(const_cast<uchar *>(data_));
+  }
+}
+
+bool ProjectFile::open() {
+  if (!file_.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+  size_ = file_.size();
+  if (size_ <= 0) {
+    return false;
+  }
+  data_ = file_.map(0, size_);
+  return data_ != nullptr;
+}
+
+class ProjectWriter {
+  QDataStream out_;
+  QString error_;
+
+  void writeRaw(const void *data, uint64_t size);
+  void writeData(const data::BinData &data);
+  void writeData(const BlockData &data);
+  void writeItem(const data::ChunkDataItem &item,
+                 const QHash<const void *, qint32> &index);
+  void writeBlob(DataBlobObject *blob);
+  Extent writeChunk(ChunkObject *chunk);
+  Extent writeRecord(const dbif::DeferredChunk &record);
+  qint64 beginBody();
+  void endBody(qint64 pos, const Extent &extent);
+
+ public:
+  explicit ProjectWriter(QIODevice *device) : out_(device) {
+    out_.setVersion(STREAM_VERSION);
+  }
+  bool ok() const { return out_.status() == QDataStream::Ok; }
+  /** Set if the snapshot couldn't be written for a reason other than
+      an I/O error.  */
+  QString error() const { return error_; }
+  void writeRoot(LocalObject *root);
+};
+
+void ProjectWriter::writeRaw(const void *data, uint64_t size) {
+  auto bytes = static_cast<const char *>(data);
+  while (size) {
+    qint64 len = std::min<qint64>(size, MAX_RAW_WRITE);
+    out_.writeRawData(bytes, int(len));
+    bytes += len;
+    size -= len;
+  }
+}
+
+void ProjectWriter::writeData(const data::BinData &data) {
+  out_ << quint32(data.width()) << quint64(data.size());
+  writeRaw(data.rawData(), data.octets());
+}
+
+void ProjectWriter::writeData(const BlockData &data) {
+  out_ << quint32(data.width()) << quint64(data.size());
+  for (auto &block : data.blocks()) {
+    writeRaw(block->data(), block->octets());
+  }
+}
+
+void ProjectWriter::writeItem(const data::ChunkDataItem &item,
+                              const QHash<const void *, qint32> &index) {
+  out_ << quint8(item.type) << item.name;
+  if (itemHasRange(item.type)) {
+    out_ << quint64(item.start) << quint64(item.end);
+  }
+  if (item.type == data::ChunkDataItem::FIELD) {
+    out_ << quint8(item.repack.endian) << quint64(item.repack.from_width)
+         << quint64(item.repack.to_width) << quint64(item.repack.high_pad)
+         << quint64(item.repack.low_pad) << quint64(item.num_elements);
+  }
+  if (itemHasValue(item.type)) {
+    const data::FieldHighType &high_type = item.high_type;
+    out_ << quint8(high_type.mode);
+    switch (high_type.mode) {
+    case data::FieldHighType::FIXED:
+      out_ << qint32(high_type.shift) << quint8(high_type.sign_mode);
+      break;
+    case data::FieldHighType::FLOAT:
+      out_ << quint8(high_type.float_mode) << high_type.float_complex;
+      break;
+    case data::FieldHighType::STRING:
+      out_ << quint8(high_type.string_mode)
+           << quint8(high_type.string_encoding);
+      break;
+    case data::FieldHighType::POINTER:
+      out_ << qint32(high_type.shift) << high_type.type_name;
+      break;
+    case data::FieldHighType::ENUM:
+      out_ << high_type.type_name;
+      break;
+    default:
+      break;
+    }
+    writeData(item.raw_value);
+  }
+  std::vector<qint32> refs;
+  for (auto &ref : item.ref) {
+    const void *key = nullptr;
+    if (auto handle = ref.dynamicCast<LocalObjectHandle>()) {
+      key = handle->obj().data();
+    } else if (auto handle = ref.dynamicCast<dbif::DeferredChunkHandle>()) {
+      key = handle->record().data();
+    }
+    refs.push_back(index.value(key, -1));
+  }
+  out_ << quint32(refs.size());
+  for (auto ref : refs) {
+    out_ << ref;
+  }
+}
+
+qint64 ProjectWriter::beginBody() {
+  qint64 pos = out_.device()->pos();
+  out_ << quint64(0) << quint64(0) << quint64(0);
+  return pos;
+}
+
+void ProjectWriter::endBody(qint64 pos, const Extent &extent) {
+  QIODevice *device = out_.device();
+  qint64 end = device->pos();
+  qint64 body_start = pos + 3 * sizeof(quint64);
+  device->seek(pos);
+  out_ << quint64(extent.start) << quint64(extent.end)
+       << quint64(end - body_start);
+  device->seek(end);
+}
+
+Extent ProjectWriter::writeChunk(ChunkObject *chunk) {
+  quint8 flags = (chunk->user_name_ ? USER_NAME : 0) |
+      (chunk->user_comment_ ? USER_COMMENT : 0);
+  out_ << chunk->name() << chunk->comment() << flags << chunk->chunkType()
+       << chunk->parserId() << quint64(chunk->start()) << quint64(chunk->end());
+  if (!chunk->stored_error_.isEmpty()) {
+    error_ = chunk->stored_error_;
+    out_.setStatus(QDataStream::WriteFailed);
+    return Extent();
+  }
+  if (!chunk->stored_.isNull()) {
+    const StoredChunkBody &stored = chunk->stored_;
+    if (chunk->children().isEmpty() && chunk->deferred_.empty() &&
+        stored.shift == 0) {
+      out_ << quint64(stored.start) << quint64(stored.end)
+           << quint64(stored.size);
+      writeRaw(stored.file->data() + stored.offset, stored.size);
+      Extent extent;
+      extent.add(chunk->start(), chunk->end());
+      extent.add(stored.start, stored.end);
+      return extent;
+    }
+    // Something was added under the chunk in the meantime, or it got
+    // moved and positions in the body are off.
+    if (!chunk->expandStored()) {
+      error_ = chunk->stored_error_;
+      out_.setStatus(QDataStream::WriteFailed);
+      return Extent();
+    }
+  }
+
+  Extent extent;
+  for (auto &range : chunk->deps_) {
+    extent.add(range.first, range.second);
+  }
+  qint64 pos = beginBody();
+  QHash<const void *, qint32> index;
+  QList<PLocalObject> children;
+  for (PLocalObject obj : chunk->children()) {
+    if (obj.dynamicCast<ChunkObject>() || obj.dynamicCast<SubBlobObject>()) {
+      children.append(obj);
+    }
+  }
+  out_ << quint32(children.size() + chunk->deferred_.size());
+  for (PLocalObject obj : children) {
+    if (auto child = obj.dynamicCast<ChunkObject>()) {
+      out_ << quint8(CHUNK_RECORD);
+      extent.add(writeChunk(child.data()));
+    } else {
+      auto blob = obj.staticCast<SubBlobObject>();
+      out_ << quint8(SUB_BLOB_RECORD) << blob->name() << blob->comment();
+      writeBlob(blob.data());
+    }
+    qint32 num = index.size();
+    index[obj.data()] = num;
+  }
+  for (auto &record : chunk->deferred_) {
+    out_ << quint8(CHUNK_RECORD);
+    extent.add(writeRecord(*record));
+    qint32 num = index.size();
+    index[record.data()] = num;
+  }
+  const dbif::ChunkItemStore &items = chunk->itemStore();
+  out_ << quint32(items.size());
+  for (size_t idx = 0; idx < items.size(); idx++) {
+    writeItem(items.item(idx), index);
+  }
+  endBody(pos, extent);
+  return extent;
+}
+
+Extent ProjectWriter::writeRecord(const dbif::DeferredChunk &record) {
+  out_ << record.name << record.comment << quint8(0)
+       << record.type.toString() << QString() << quint64(record.start)
+       << quint64(record.end);
+  Extent extent;
+  extent.add(record.start, record.end);
+  const dbif::ChunkItemStore &items = record.items;
+  for (size_t idx = 0; idx < items.size(); idx++) {
+    if (items.type(idx) == data::ChunkDataItem::FIELD) {
+      extent.add(items.start(idx), items.end(idx));
+    }
+  }
+  qint64 pos = beginBody();
+  QHash<const void *, qint32> index;
+  out_ << quint32(record.children.size());
+  for (auto &child : record.children) {
+    out_ << quint8(CHUNK_RECORD);
+    extent.add(writeRecord(*child));
+    qint32 num = index.size();
+    index[child.data()] = num;
+  }
+  out_ << quint32(items.size());
+  for (size_t idx = 0; idx < items.size(); idx++) {
+    writeItem(items.item(idx), index);
+  }
+  endBody(pos, extent);
+  return extent;
+}
+
+void ProjectWriter::writeBlob(DataBlobObject *blob) {
+  writeData(blob->data());
+  QList<ChunkObject *> chunks;
+  for (PLocalObject obj : blob->children()) {
+    if (auto chunk = obj.dynamicCast<ChunkObject>()) {
+      chunks.append(chunk.data());
+    }
+  }
+  out_ << quint32(chunks.size());
+  for (auto chunk : chunks) {
+    writeChunk(chunk);
+  }
+}
+
+void ProjectWriter::writeRoot(LocalObject *root) {
+  QList<FileBlobObject *> blobs;
+  for (PLocalObject obj : root->children()) {
+    if (auto blob = obj.dynamicCast<FileBlobObject>()) {
+      blobs.append(blob.data());
+    }
+  }
+  out_ << PROJECT_MAGIC << PROJECT_VERSION << quint32(blobs.size());
+  for (auto blob : blobs) {
+    out_ << blob->path() << blob->name() << blob->comment();
+    writeBlob(blob);
+  }
+}
+
+class ProjectReader {
+  Universe *db_;
+  PProjectFile file_;
+  qint64 base_;
+  MappedDevice device_;
+  QDataStream in_;
+
+  qint64 remaining() const { return device_.size() - device_.pos(); }
+  void skip(uint64_t size) { device_.seek(device_.pos() + qint64(size)); }
+  void fail() { in_.setStatus(QDataStream::ReadCorruptData); }
+  bool readData(data::BinData *data);
+  bool readItem(data::ChunkDataItem *item, const QList<PLocalObject> &children,
+                int64_t shift);
+  QList<PLocalObject> readChunks(PLocalObject blob);
+  PLocalObject readChunk(PLocalObject blob, PLocalObject parent_chunk,
+                         int64_t shift);
+  PLocalObject readSubBlob(LocalObject *parent);
+
+ public:
+  ProjectReader(Universe *db, PProjectFile file, qint64 offset, qint64 size)
+      : db_(db), file_(file), base_(offset),
+        device_(file->data() + offset, size), in_(&device_) {
+    in_.setVersion(STREAM_VERSION);
+  }
+  bool ok() const { return in_.status() == QDataStream::Ok; }
+  bool readRoot(LocalObject *root, QList<PLocalObject> *blobs,
+                QString *error);
+  /** Reads the stored body of the chunk, adding shift to all positions
+      in its blob.  Leaves the chunk alone if the body is corrupted.  */
+  bool readBody(ChunkObject *chunk, int64_t shift);
+};
+
+bool ProjectReader::readData(data::BinData *data) {
+  quint32 width;
+  quint64 size;
+  in_ >> width >> size;
+  if (!ok() || width == 0 || size > uint64_t(remaining())) {
+    fail();
+    return false;
+  }
+  uint64_t octets = size * ((width + 7) / 8);
+  if (octets > uint64_t(remaining())) {
+    fail();
+    return false;
+  }
+  auto bytes = reinterpret_cast<const uint8_t *>(device_.current());
+  *data = data::BinData(width, size, bytes);
+  skip(octets);
+  return true;
+}
+
+bool ProjectReader::readItem(data::ChunkDataItem *item,
+                             const QList<PLocalObject> &children,
+                             int64_t shift) {
+  quint8 type;
+  in_ >> type >> item->name;
+  if (type > data::ChunkDataItem::PAD) {
+    fail();
+  }
+  if (!ok()) {
+    return false;
+  }
+  item->type = data::ChunkDataItem::ChunkDataItemType(type);
+  item->start = item->end = 0;
+  item->num_elements = 0;
+  if (itemHasRange(item->type)) {
+    quint64 start, end;
+    in_ >> start >> end;
+    item->start = start;
+    item->end = end;
+    if (dbif::ChunkItemStore::hasBlobRange(item->type)) {
+      item->start += shift;
+      item->end += shift;
+    }
+  }
+  if (item->type == data::ChunkDataItem::FIELD) {
+    quint8 endian;
+    quint64 from_width, to_width, high_pad, low_pad, num_elements;
+    in_ >> endian >> from_width >> to_width >> high_pad >> low_pad
+        >> num_elements;
+    item->repack = data::Repacker(data::Endian(endian), from_width, to_width,
+                                  high_pad, low_pad);
+    item->num_elements = num_elements;
+  }
+  if (itemHasValue(item->type)) {
+    data::FieldHighType &high_type = item->high_type;
+    high_type = data::FieldHighType::fixed(data::FieldHighType::UNSIGNED);
+    high_type.float_mode = data::FieldHighType::IEEE754_SINGLE;
+    high_type.float_complex = false;
+    high_type.string_mode = data::FieldHighType::STRING_RAW;
+    high_type.string_encoding = data::FieldHighType::ENC_RAW;
+    quint8 mode, sub_mode, encoding;
+    qint32 shift;
+    in_ >> mode;
+    high_type.mode = data::FieldHighType::FieldHighMode(mode);
+    switch (high_type.mode) {
+    case data::FieldHighType::FIXED:
+      in_ >> shift >> sub_mode;
+      high_type.shift = shift;
+      high_type.sign_mode = data::FieldHighType::FieldSignMode(sub_mode);
+      break;
+    case data::FieldHighType::FLOAT:
+      in_ >> sub_mode >> high_type.float_complex;
+      high_type.float_mode = data::FieldHighType::FieldFloatMode(sub_mode);
+      break;
+    case data::FieldHighType::STRING:
+      in_ >> sub_mode >> encoding;
+      high_type.string_mode = data::FieldHighType::FieldStringMode(sub_mode);
+      high_type.string_encoding =
+          data::FieldHighType::FieldStringEncoding(encoding);
+      break;
+    case data::FieldHighType::POINTER:
+      in_ >> shift >> high_type.type_name;
+      high_type.shift = shift;
+      break;
+    case data::FieldHighType::ENUM:
+      in_ >> high_type.type_name;
+      break;
+    default:
+      break;
+    }
+    if (!readData(&item->raw_value)) {
+      return false;
+    }
+  }
+  quint32 num_refs;
+  in_ >> num_refs;
+  for (quint32 i = 0; i < num_refs && ok(); i++) {
+    qint32 ref;
+    in_ >> ref;
+    if (ref >= 0 && ref < children.size()) {
+      item->ref.push_back(db_->handle(children[ref]));
+    }
+  }
+  if (!ok()) {
+    return false;
+  }
+  // Subchunk and subblob items are useless without their target.
+  return item->ref.size() > 0 ||
+      (item->type != data::ChunkDataItem::SUBCHUNK &&
+       item->type != data::ChunkDataItem::SUBBLOB);
+}
+
+PLocalObject ProjectReader::readChunk(PLocalObject blob,
+                                      PLocalObject parent_chunk,
+                                      int64_t shift) {
+  QString name, comment, type, parser_id;
+  quint8 flags;
+  quint64 start, end, extent_start, extent_end, size;
+  in_ >> name >> comment >> flags >> type >> parser_id >> start >> end
+      >> extent_start >> extent_end >> size;
+  if (!ok() || size > uint64_t(remaining())) {
+    fail();
+    return PLocalObject();
+  }
+  auto chunk = QSharedPointer<ChunkObject>::create(
+      blob, parent_chunk, start + shift, end + shift, type, name, parser_id);
+  chunk->setComment(comment);
+  chunk->user_name_ = (flags & USER_NAME) != 0;
+  chunk->user_comment_ = (flags & USER_COMMENT) != 0;
+  chunk->stored_.file = file_;
+  chunk->stored_.offset = base_ + device_.pos();
+  chunk->stored_.size = qint64(size);
+  chunk->stored_.start = extent_start + shift;
+  chunk->stored_.end = extent_end + shift;
+  chunk->stored_.shift = shift;
+  skip(size);
+  return chunk;
+}
+
+QList<PLocalObject> ProjectReader::readChunks(PLocalObject blob) {
+  QList<PLocalObject> chunks;
+  quint32 count;
+  in_ >> count;
+  for (quint32 i = 0; i < count && ok(); i++) {
+    if (auto chunk = readChunk(blob, PLocalObject(), 0)) {
+      chunks.append(chunk);
+    }
+  }
+  return chunks;
+}
+
+PLocalObject ProjectReader::readSubBlob(LocalObject *parent) {
+  QString name, comment;
+  data::BinData data;
+  in_ >> name >> comment;
+  if (!ok() || !readData(&data)) {
+    return PLocalObject();
+  }
+  auto blob = QSharedPointer<SubBlobObject>::create(parent, data, name);
+  blob->setComment(comment);
+  auto chunks = readChunks(blob);
+  if (!chunks.isEmpty()) {
+    blob->addChildren(chunks);
+  }
+  return blob;
+}
+
+bool ProjectReader::readBody(ChunkObject *chunk, int64_t shift) {
+  PLocalObject self = chunk->sharedFromThis();
+  QList<PLocalObject> children;
+  quint32 count;
+  in_ >> count;
+  for (quint32 i = 0; i < count && ok(); i++) {
+    quint8 kind;
+    in_ >> kind;
+    PLocalObject obj;
+    if (kind == CHUNK_RECORD) {
+      obj = readChunk(chunk->blob_, self, shift);
+    } else if (kind == SUB_BLOB_RECORD) {
+      obj = readSubBlob(chunk);
+    } else {
+      fail();
+    }
+    if (obj) {
+      children.append(obj);
+    }
+  }
+  std::vector<data::ChunkDataItem> items;
+  in_ >> count;
+  for (quint32 i = 0; i < count && ok(); i++) {
+    data::ChunkDataItem item;
+    if (readItem(&item, children, shift)) {
+      items.push_back(item);
+    }
+  }
+  if (!ok()) {
+    for (auto &obj : children) {
+      obj->kill();
+    }
+    return false;
+  }
+  chunk->items_.assign(items);
+  chunk->calcDeps();
+  if (!children.isEmpty()) {
+    chunk->addChildren(children);
+  }
+  return true;
+}
+
+bool ProjectReader::readRoot(LocalObject *root, QList<PLocalObject> *blobs,
+                             QString *error) {
+  quint32 magic, version, count;
+  in_ >> magic >> version;
+  if (!ok() || magic != PROJECT_MAGIC) {
+    *error = QObject::tr("Not a Veles project file.");
+    return false;
+  }
+  if (version != PROJECT_VERSION) {
+    *error = QObject::tr("Unsupported project file version %1.").arg(version);
+    return false;
+  }
+  in_ >> count;
+  // Blobs are only attached to the root once the whole file is read, so
+  // a corrupted project doesn't leave half of itself behind.
+  QList<PLocalObject> read;
+  for (quint32 i = 0; i < count && ok(); i++) {
+    QString path, name, comment;
+    data::BinData data;
+    in_ >> path >> name >> comment;
+    if (!ok() || !readData(&data)) {
+      break;
+    }
+    PLocalObject blob =
+        QSharedPointer<FileBlobObject>::create(root, data, path);
+    blob->setName(name);
+    blob->setComment(comment);
+    auto chunks = readChunks(blob);
+    if (!chunks.isEmpty()) {
+      blob->addChildren(chunks);
+    }
+    read.append(blob);
+  }
+  if (!ok()) {
+    for (auto &blob : read) {
+      blob->kill();
+    }
+    *error = QObject::tr("Project file is corrupted.");
+    return false;
+  }
+  if (!read.isEmpty()) {
+    root->addChildren(read);
+  }
+  blobs->append(read);
+  return true;
+}
+
+bool ChunkObject::expandStored() {
+  if (stored_.isNull()) {
+    return stored_error_.isEmpty();
+  }
+  StoredChunkBody stored;
+  std::swap(stored, stored_);
+  ProjectReader reader(db(), stored.file, stored.offset, stored.size);
+  if (!reader.readBody(this, stored.shift)) {
+    stored_error_ = QObject::tr("Chunk \"%1\" is corrupted in the project "
+                                "file.").arg(name());
+    return false;
+  }
+  return true;
+}
+
+bool saveProject(LocalObject *root, const QString &path, QString *error) {
+  QSaveFile file(path);
+  if (!file.open(QIODevice::WriteOnly)) {
+    *error = file.errorString();
+    return false;
+  }
+  ProjectWriter writer(&file);
+  writer.writeRoot(root);
+  if (!writer.error().isEmpty()) {
+    file.cancelWriting();
+    *error = writer.error();
+    return false;
+  }
+  if (!writer.ok() || !file.commit()) {
+    *error = file.errorString();
+    return false;
+  }
+  return true;
+}
+
+bool loadProject(LocalObject *root, const QString &path,
+                 QList<PLocalObject> *blobs, QString *error) {
+  auto file = PProjectFile::create(path);
+  if (!file->open()) {
+    *error = QObject::tr("Cannot map \"%1\".").arg(path);
+    return false;
+  }
+  ProjectReader reader(root->db(), file, 0, file->size());
+  return reader.readRoot(root, blobs, error);
+}
+
+}  // namespace db
+}  // namespace veles
@@ -15,8 +15,10 @@
  *
  */
 #include <QThread>
+#include <QTimer>
 
 #include "db/universe.h"
+#include "db/channel.h"
 #include "dbif/promise.h"
 #include "dbif/error.h"
 #include "db/handle.h"
@@ -61,6 +63,10 @@ dbif::ObjectHandle create_db() {
   return db->handle(root);
 }
 
+Universe::Universe(ParserWorker *parser)
+    : parser_(parser), channel_(new RequestChannel(this)),
+      flush_scheduled_(false) {}
+
 dbif::ObjectHandle Universe::handle(PLocalObject obj) {
   dbif::ObjectHandle objHandle;
   if (obj) {
@@ -71,11 +77,31 @@ dbif::ObjectHandle Universe::handle(PLocalObject obj) {
 
 Universe::~Universe() {
   root_->kill();
+  dirty_.clear();
+}
+
+void Universe::scheduleUpdate(PLocalObject obj) {
+  dirty_.insert(obj);
+  if (!flush_scheduled_) {
+    flush_scheduled_ = true;
+    QTimer::singleShot(UPDATE_INTERVAL_MS, this, SLOT(flushUpdates()));
+  }
+}
+
+void Universe::flushUpdates() {
+  flush_scheduled_ = false;
+  QSet<PLocalObject> dirty;
+  dirty.swap(dirty_);
+  for (auto obj : dirty) {
+    if (!obj->dead()) {
+      obj->flushUpdates();
+    }
+  }
 }
 
 void Universe::getInfo(PLocalObject obj, InfoGetter *getter, dbif::PInfoRequest req, bool once) {
   if (obj->dead()) {
-    emit getter->gotError(QSharedPointer<dbif::ObjectGoneError>::create());
+    getter->sendError<dbif::ObjectGoneError>();
   } else {
     obj->getInfo(getter, req, once);
   }
@@ -83,7 +109,7 @@ void Universe::getInfo(PLocalObject obj, InfoGetter *getter, dbif::PInfoRequest
 
 void Universe::runMethod(PLocalObject obj, MethodRunner *runner, dbif::PMethodRequest req) {
   if (obj->dead()) {
-    emit runner->gotError(QSharedPointer<dbif::ObjectGoneError>::create());
+    runner->sendError<dbif::ObjectGoneError>();
   } else {
     obj->runMethod(runner, req);
   }
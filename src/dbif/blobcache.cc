@@ -0,0 +1,245 @@
+/*
+ * Copyright 2017 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include <algorithm>
+#include <cassert>
+
+#include "dbif/blobcache.h"
+#include "dbif/error.h"
+#include "dbif/info.h"
+#include "dbif/promise.h"
+#include "dbif/universe.h"
+
+namespace veles {
+namespace dbif {
+
+BlobPageCache::BlobPageCache(ObjectHandle blob, uint64_t size, unsigned width,
+                             size_t budget, QObject *parent)
+    : QObject(parent), blob_(blob), size_(size), width_(width),
+      budget_(budget), use_clock_(0), cached_octets_(0) {}
+
+uint64_t BlobPageCache::pageCount() const {
+  return (size_ + PAGE_SIZE - 1) / PAGE_SIZE;
+}
+
+size_t BlobPageCache::pageOctets(uint64_t page) const {
+  uint64_t start = page * PAGE_SIZE;
+  uint64_t end = std::min(start + PAGE_SIZE, size_);
+  return (end - start) * ((width_ + 7) / 8);
+}
+
+const BlobPageCache::Page *BlobPageCache::loadedPage(uint64_t page) const {
+  auto iter = pages_.find(page);
+  if (iter == pages_.end() || !iter->second.loaded) {
+    return nullptr;
+  }
+  return &iter->second;
+}
+
+void BlobPageCache::request(uint64_t start, uint64_t end) {
+  end = std::min(end, size_);
+  if (start >= end) {
+    return;
+  }
+  // We don't know which way the view is going to scroll - keep a page
+  // behind and prefetch a few ahead.
+  uint64_t first = start / PAGE_SIZE;
+  uint64_t last = (end - 1) / PAGE_SIZE;
+  if (first > 0) {
+    first--;
+  }
+  last = std::min(last + PREFETCH_PAGES, pageCount() - 1);
+  use_clock_++;
+  for (uint64_t page = first; page <= last; page++) {
+    auto iter = pages_.find(page);
+    if (iter == pages_.end()) {
+      fetch(page);
+    } else {
+      iter->second.last_use = use_clock_;
+    }
+  }
+  evict(first, last);
+}
+
+bool BlobPageCache::isLoaded(uint64_t start, uint64_t end) const {
+  if (end > size_) {
+    return false;
+  }
+  for (uint64_t pos = start; pos < end;) {
+    uint64_t page_start = pos - pos % PAGE_SIZE;
+    uint64_t page_end = std::min(page_start + PAGE_SIZE, end);
+    const Page *page = loadedPage(pos / PAGE_SIZE);
+    if (page == nullptr || page->data.size() < page_end - page_start) {
+      return false;
+    }
+    pos = page_end;
+  }
+  return true;
+}
+
+bool BlobPageCache::element(uint64_t pos, uint64_t *value) const {
+  const Page *page = loadedPage(pos / PAGE_SIZE);
+  if (page == nullptr || pos % PAGE_SIZE >= page->data.size()) {
+    return false;
+  }
+  *value = page->data.element64(pos % PAGE_SIZE);
+  return true;
+}
+
+data::BinData BlobPageCache::data(uint64_t start, uint64_t end) const {
+  assert(isLoaded(start, end));
+  if (start == end) {
+    return data::BinData(width_, 0);
+  }
+  if (start / PAGE_SIZE == (end - 1) / PAGE_SIZE) {
+    // Shares the page's data, no copying.
+    return loadedPage(start / PAGE_SIZE)->data.data(start % PAGE_SIZE,
+                                                    (end - 1) % PAGE_SIZE + 1);
+  }
+  data::BinData res(width_, end - start);
+  for (uint64_t pos = start; pos < end;) {
+    uint64_t page_end = std::min((pos / PAGE_SIZE + 1) * PAGE_SIZE, end);
+    const Page *page = loadedPage(pos / PAGE_SIZE);
+    uint64_t offset = pos % PAGE_SIZE;
+    res.setData(pos - start, page_end - start,
+                page->data.data(offset, offset + page_end - pos));
+    pos = page_end;
+  }
+  return res;
+}
+
+void BlobPageCache::fetch(uint64_t page) {
+  uint64_t start = page * PAGE_SIZE;
+  uint64_t end = std::min(start + PAGE_SIZE, size_);
+  Page &entry = pages_[page];
+  entry.loaded = false;
+  entry.last_use = use_clock_;
+  entry.promise =
+      blob_->asyncSubInfo<BlobDataRequest>(this, start, end, true);
+  cached_octets_ += pageOctets(page);
+  connect(entry.promise, &InfoPromise::gotInfo,
+          this, [this, page](PInfoReply reply) { gotPage(page, reply); });
+  connect(entry.promise, &InfoPromise::gotError, this, [this, page]() {
+    // Forget the page, so that it's retried when it's needed again.
+    auto iter = pages_.find(page);
+    if (iter != pages_.end()) {
+      drop(iter);
+    }
+  });
+}
+
+void BlobPageCache::drop(PageMap::iterator iter) {
+  cached_octets_ -= pageOctets(iter->first);
+  // We may be inside one of the promise's signals.
+  iter->second.promise->deleteLater();
+  pages_.erase(iter);
+}
+
+void BlobPageCache::evict(uint64_t keep_first, uint64_t keep_last) {
+  while (cached_octets_ > budget_) {
+    auto victim = pages_.end();
+    for (auto iter = pages_.begin(); iter != pages_.end(); ++iter) {
+      if (iter->first >= keep_first && iter->first <= keep_last) {
+        continue;
+      }
+      if (victim == pages_.end() ||
+          iter->second.last_use < victim->second.last_use) {
+        victim = iter;
+      }
+    }
+    if (victim == pages_.end()) {
+      break;
+    }
+    drop(victim);
+  }
+}
+
+void BlobPageCache::gotPage(uint64_t page, PInfoReply reply) {
+  auto iter = pages_.find(page);
+  if (iter == pages_.end()) {
+    return;
+  }
+  Page &entry = iter->second;
+  uint64_t start = page * PAGE_SIZE;
+  if (auto delta = reply.dynamicCast<BlobDataDeltaReply>()) {
+    // Deltas only ever follow the initial full reply.
+    if (!entry.loaded) {
+      return;
+    }
+    uint64_t old_size = entry.data.size();
+    delta->apply(entry.data);
+    uint64_t end = delta->removed == delta->inserted.size()
+        ? delta->start + delta->removed
+        : std::max(old_size, delta->size);
+    emit pageChanged(start + delta->start, start + end);
+    return;
+  }
+  auto data_reply = reply.dynamicCast<BlobDataRequest::ReplyType>();
+  if (!data_reply) {
+    return;
+  }
+  bool was_loaded = entry.loaded;
+  uint64_t old_size = entry.data.size();
+  entry.data = data_reply->data;
+  entry.loaded = true;
+  if (was_loaded) {
+    emit pageChanged(start,
+                     start + std::max(old_size, entry.data.size()));
+  } else {
+    emit pageLoaded(start, start + entry.data.size());
+  }
+}
+
+BlobRangeReader::BlobRangeReader(ObjectHandle blob, uint64_t start,
+                                 uint64_t end, QObject *parent)
+    : QObject(parent), blob_(blob), start_(start), end_(end), pos_(start) {
+  // Give the caller a chance to connect the signals, even when there's
+  // nothing to read.
+  QMetaObject::invokeMethod(this, "readNext", Qt::QueuedConnection);
+}
+
+void BlobRangeReader::readNext() {
+  if (pos_ >= end_) {
+    emit finished();
+    deleteLater();
+    return;
+  }
+  uint64_t piece_end = std::min(pos_ + PIECE_SIZE, end_);
+  auto promise = blob_->asyncGetInfo<BlobDataRequest>(this, pos_, piece_end);
+  connect(promise, &InfoPromise::gotInfo, this, &BlobRangeReader::gotPiece);
+  connect(promise, &InfoPromise::gotError, this, &BlobRangeReader::gotError);
+}
+
+void BlobRangeReader::gotPiece(PInfoReply reply) {
+  auto data_reply = reply.dynamicCast<BlobDataRequest::ReplyType>();
+  if (!data_reply || data_reply->data.size() == 0) {
+    // The blob shrank under us.
+    gotError(QSharedPointer<BlobDataInvalidRangeError>::create());
+    return;
+  }
+  uint64_t pos = pos_;
+  pos_ += data_reply->data.size();
+  emit gotData(pos, data_reply->data);
+  readNext();
+}
+
+void BlobRangeReader::gotError(PError error) {
+  emit failed(error);
+  deleteLater();
+}
+
+}  // namespace dbif
+}  // namespace veles
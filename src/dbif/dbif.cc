@@ -14,6 +14,9 @@
  * limitations under the License.
  *
  */
+#include <QCoreApplication>
+
+#include "dbif/deferred.h"
 #include "dbif/info.h"
 #include "dbif/method.h"
 #include "dbif/error.h"
@@ -24,6 +27,110 @@ namespace dbif {
 
 void MethodRequest::key() {}
 
+namespace {
+
+template<typename Reply>
+class ReplyEvent : public QEvent {
+ public:
+  static QEvent::Type eventType() {
+    static int type = QEvent::registerEventType();
+    return static_cast<QEvent::Type>(type);
+  }
+  ReplyEvent(Reply reply, PError err)
+      : QEvent(eventType()), reply(reply), err(err) {}
+  Reply reply;
+  PError err;
+};
+
+typedef ReplyEvent<PInfoReply> InfoReplyEvent;
+typedef ReplyEvent<PMethodReply> MethodReplyEvent;
+
+}  // namespace
+
+void PromiseLink::post(QEvent *event) {
+  std::unique_lock<std::mutex> lc(mutex);
+  if (target) {
+    QCoreApplication::postEvent(target, event);
+  } else {
+    delete event;
+  }
+}
+
+void PromiseLink::reset() {
+  std::unique_lock<std::mutex> lc(mutex);
+  target = nullptr;
+}
+
+InfoPromise::InfoPromise() : link_(PPromiseLink::create(this)) {}
+
+InfoPromise::~InfoPromise() {
+  link_->reset();
+}
+
+void InfoPromise::deliver(const PPromiseLink &link, PInfoReply reply,
+                          PError err) {
+  link->post(new InfoReplyEvent(reply, err));
+}
+
+bool InfoPromise::event(QEvent *event) {
+  if (event->type() != InfoReplyEvent::eventType()) {
+    return QObject::event(event);
+  }
+  auto reply_event = static_cast<InfoReplyEvent *>(event);
+  if (reply_event->err) {
+    emit gotError(reply_event->err);
+  } else {
+    emit gotInfo(reply_event->reply);
+  }
+  deleteLater();
+  return true;
+}
+
+MethodResultPromise::MethodResultPromise()
+    : link_(PPromiseLink::create(this)) {}
+
+MethodResultPromise::~MethodResultPromise() {
+  link_->reset();
+}
+
+void MethodResultPromise::deliver(const PPromiseLink &link,
+                                  PMethodReply reply, PError err) {
+  link->post(new MethodReplyEvent(reply, err));
+}
+
+bool MethodResultPromise::event(QEvent *event) {
+  if (event->type() != MethodReplyEvent::eventType()) {
+    return QObject::event(event);
+  }
+  auto reply_event = static_cast<MethodReplyEvent *>(event);
+  if (reply_event->err) {
+    emit gotError(reply_event->err);
+  } else {
+    emit gotResult(reply_event->reply);
+  }
+  deleteLater();
+  return true;
+}
+
+InfoPromise *DeferredChunkHandle::getInfo(PInfoRequest req) {
+  InfoPromise *promise = new InfoPromise;
+  InfoPromise::deliver(promise->link(), PInfoReply(),
+                       QSharedPointer<ObjectInvalidRequestError>::create());
+  return promise;
+}
+
+InfoPromise *DeferredChunkHandle::subInfo(PInfoRequest req) {
+  return getInfo(req);
+}
+
+MethodResultPromise *DeferredChunkHandle::runMethod(PMethodRequest req) {
+  MethodResultPromise *promise = new MethodResultPromise;
+  MethodResultPromise::deliver(
+      promise->link(), PMethodReply(),
+      QSharedPointer<ObjectInvalidRequestError>::create());
+  return promise;
+}
+
 namespace {
 class Register {
  public:
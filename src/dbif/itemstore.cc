@@ -0,0 +1,154 @@
+/*
+ * Copyright 2017 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "dbif/itemstore.h"
+
+namespace veles {
+namespace dbif {
+
+namespace {
+
+// Formats are looked up by a backwards linear scan - chunks seldom have
+// more than a handful of distinct ones, and recent ones are the likeliest
+// to repeat.
+const size_t FORMAT_SCAN_LIMIT = 32;
+
+bool hasFormat(data::ChunkDataItem::ChunkDataItemType type) {
+  return type == data::ChunkDataItem::FIELD ||
+      type == data::ChunkDataItem::BITFIELD ||
+      type == data::ChunkDataItem::COMPUTED;
+}
+
+bool sameHighType(const data::FieldHighType &a,
+                  const data::FieldHighType &b) {
+  if (a.mode != b.mode) {
+    return false;
+  }
+  switch (a.mode) {
+  case data::FieldHighType::FIXED:
+    return a.shift == b.shift && a.sign_mode == b.sign_mode;
+  case data::FieldHighType::FLOAT:
+    return a.float_mode == b.float_mode &&
+        a.float_complex == b.float_complex;
+  case data::FieldHighType::STRING:
+    return a.string_mode == b.string_mode &&
+        a.string_encoding == b.string_encoding;
+  case data::FieldHighType::POINTER:
+    return a.shift == b.shift && a.type_name == b.type_name;
+  case data::FieldHighType::ENUM:
+    return a.type_name == b.type_name;
+  default:
+    return true;
+  }
+}
+
+bool sameRepacker(const data::Repacker &a, const data::Repacker &b) {
+  return a.endian == b.endian && a.from_width == b.from_width &&
+      a.to_width == b.to_width && a.high_pad == b.high_pad &&
+      a.low_pad == b.low_pad;
+}
+
+}  // namespace
+
+uint32_t ChunkItemStore::addFormat(const data::ChunkDataItem &item) {
+  size_t scanned = 0;
+  for (size_t idx = formats_.size(); idx > 0 && scanned < FORMAT_SCAN_LIMIT;
+       idx--, scanned++) {
+    const Format &format = formats_[idx - 1];
+    if (sameRepacker(format.repack, item.repack) &&
+        sameHighType(format.high_type, item.high_type)) {
+      return uint32_t(idx - 1);
+    }
+  }
+  formats_.push_back(Format{item.repack, item.high_type});
+  return uint32_t(formats_.size() - 1);
+}
+
+void ChunkItemStore::assign(const std::vector<data::ChunkDataItem> &items) {
+  entries_.clear();
+  formats_.clear();
+  values_.clear();
+  refs_.clear();
+  entries_.reserve(items.size());
+
+  size_t value_octets = 0;
+  size_t num_refs = 0;
+  for (auto &item : items) {
+    if (hasFormat(item.type)) {
+      value_octets += item.raw_value.octets();
+    }
+    num_refs += item.ref.size();
+  }
+  values_.reserve(value_octets);
+  refs_.reserve(num_refs);
+
+  for (auto &item : items) {
+    Entry entry;
+    entry.type = uint8_t(item.type);
+    entry.start = item.start;
+    entry.end = item.end;
+    entry.num_elements = item.num_elements;
+    entry.name = item.name;
+    entry.format = NO_FORMAT;
+    entry.value_offset = 0;
+    entry.value_width = 8;
+    entry.value_size = 0;
+    if (hasFormat(item.type)) {
+      entry.format = addFormat(item);
+      entry.value_offset = values_.size();
+      entry.value_width = item.raw_value.width();
+      entry.value_size = item.raw_value.size();
+      values_.insert(values_.end(), item.raw_value.rawData(),
+                     item.raw_value.rawData() + item.raw_value.octets());
+    }
+    entry.ref_first = uint32_t(refs_.size());
+    entry.ref_count = uint32_t(item.ref.size());
+    refs_.insert(refs_.end(), item.ref.begin(), item.ref.end());
+    entries_.push_back(entry);
+  }
+}
+
+data::ChunkDataItem ChunkItemStore::item(size_t idx) const {
+  const Entry &entry = entries_[idx];
+  data::ChunkDataItem res;
+  res.type = data::ChunkDataItem::ChunkDataItemType(entry.type);
+  res.start = entry.start;
+  res.end = entry.end;
+  res.num_elements = entry.num_elements;
+  res.name = entry.name.toString();
+  if (entry.format != NO_FORMAT) {
+    const Format &format = formats_[entry.format];
+    res.repack = format.repack;
+    res.high_type = format.high_type;
+    res.raw_value = data::BinData(entry.value_width, entry.value_size,
+                                  values_.data() + entry.value_offset);
+  }
+  res.ref.assign(refs_.begin() + entry.ref_first,
+                 refs_.begin() + entry.ref_first + entry.ref_count);
+  return res;
+}
+
+std::vector<data::ChunkDataItem> ChunkItemStore::items() const {
+  std::vector<data::ChunkDataItem> res;
+  res.reserve(entries_.size());
+  for (size_t idx = 0; idx < entries_.size(); idx++) {
+    res.push_back(item(idx));
+  }
+  return res;
+}
+
+}  // namespace dbif
+}  // namespace veles
@@ -68,141 +68,140 @@ int8_t kaitai::kstream::read_s1() {
   if (error_) {
     return 0;
   }
-  return parser_->getByte(current_name_);
+  return parser_->read<int8_t, veles::data::Endian::LITTLE>(current_name_);
 }
 
 int16_t kaitai::kstream::read_s2be() {
   if (error_) {
     return 0;
   }
-  return parser_->getBe16(current_name_, 1)[0];
+  return parser_->read<int16_t, veles::data::Endian::BIG>(current_name_);
 }
 
 int32_t kaitai::kstream::read_s4be() {
   if (error_) {
     return 0;
   }
-  return parser_->getBe32(current_name_);
+  return parser_->read<int32_t, veles::data::Endian::BIG>(current_name_);
 }
 
 int64_t kaitai::kstream::read_s8be() {
   if (error_) {
     return 0;
   }
-  return parser_->getBe64(current_name_);
+  return parser_->read<int64_t, veles::data::Endian::BIG>(current_name_);
 }
 
 int16_t kaitai::kstream::read_s2le() {
   if (error_) {
     return 0;
   }
-  return parser_->getLe16(current_name_, 1)[0];
+  return parser_->read<int16_t, veles::data::Endian::LITTLE>(current_name_);
 }
 
 int32_t kaitai::kstream::read_s4le() {
   if (error_) {
     return 0;
   }
-  return parser_->getLe32(current_name_);
+  return parser_->read<int32_t, veles::data::Endian::LITTLE>(current_name_);
 }
 
 int64_t kaitai::kstream::read_s8le() {
   if (error_) {
     return 0;
   }
-  return parser_->getLe64(current_name_);
+  return parser_->read<int64_t, veles::data::Endian::LITTLE>(current_name_);
 }
 
 uint8_t kaitai::kstream::read_u1() {
   if (error_) {
     return 0;
   }
-  return parser_->getByte(current_name_);
+  return parser_->read<uint8_t, veles::data::Endian::LITTLE>(current_name_);
 }
 
 uint16_t kaitai::kstream::read_u2be() {
   if (error_) {
     return 0;
   }
-  return parser_->getBe16(current_name_, 1)[0];
+  return parser_->read<uint16_t, veles::data::Endian::BIG>(current_name_);
 }
 
 uint32_t kaitai::kstream::read_u4be() {
   if (error_) {
     return 0;
   }
-  return parser_->getBe32(current_name_);
+  return parser_->read<uint32_t, veles::data::Endian::BIG>(current_name_);
 }
 
 uint64_t kaitai::kstream::read_u8be() {
   if (error_) {
     return 0;
   }
-  return parser_->getBe64(current_name_);
+  return parser_->read<uint64_t, veles::data::Endian::BIG>(current_name_);
 }
 
 uint16_t kaitai::kstream::read_u2le() {
   if (error_) {
     return 0;
   }
-  return parser_->getLe16(current_name_, 1)[0];
+  return parser_->read<uint16_t, veles::data::Endian::LITTLE>(current_name_);
 }
 
 uint32_t kaitai::kstream::read_u4le() {
   if (error_) {
     return 0;
   }
-  return parser_->getLe32(current_name_);
+  return parser_->read<uint32_t, veles::data::Endian::LITTLE>(current_name_);
 }
 
 uint64_t kaitai::kstream::read_u8le() {
   if (error_) {
     return 0;
   }
-  return parser_->getLe64(current_name_);
+  return parser_->read<uint64_t, veles::data::Endian::LITTLE>(current_name_);
 }
 
 float kaitai::kstream::read_f4be() {
   if (error_) {
     return 0.0;
   }
-  return parser_->getFloat32Be(current_name_);
+  return parser_->read<float, veles::data::Endian::BIG>(current_name_);
 }
 
 double kaitai::kstream::read_f8be() {
   if (error_) {
     return 0.0;
   }
-  return parser_->getFloat64Be(current_name_);
+  return parser_->read<double, veles::data::Endian::BIG>(current_name_);
 }
 
 float kaitai::kstream::read_f4le() {
   if (error_) {
     return 0.0;
   }
-  return parser_->getFloat32Le(current_name_);
+  return parser_->read<float, veles::data::Endian::LITTLE>(current_name_);
 }
 
 double kaitai::kstream::read_f8le() {
   if (error_) {
     return 0.0;
   }
-  return parser_->getFloat64Le(current_name_);
+  return parser_->read<double, veles::data::Endian::LITTLE>(current_name_);
 }
 
 std::string kaitai::kstream::read_str_eos(const char *enc) {
   if (error_) {
     return "";
   }
-  return bytes_to_string(parser_->getBytes(current_name_, parser_->bytesLeft()),
-                         enc);
+  return bytes_to_string(read_bytes_full_view(), enc);
 }
 
 std::string kaitai::kstream::read_str_byte_limit(size_t len, const char *enc) {
   if (error_) {
     return "";
   }
-  return bytes_to_string(parser_->getBytes(current_name_, len), enc);
+  return bytes_to_string(read_bytes_view(len), enc);
 }
 
 std::string kaitai::kstream::read_strz(const char *enc, char term, bool include,
@@ -229,8 +228,8 @@ std::vector<uint8_t> kaitai::kstream::read_bytes(size_t len) {
     parser_->skip(len);
     return std::vector<uint8_t>(len);
   }
-  auto result = parser_->getBytes(current_name_, len);
-  return result;
+  auto view = read_bytes_view(len);
+  return std::vector<uint8_t>(view.begin(), view.end());
 }
 
 std::vector<uint8_t> kaitai::kstream::read_bytes_full() {
@@ -246,22 +245,42 @@ std::vector<uint8_t> kaitai::kstream::ensure_fixed_contents(
   if (error_) {
     return {};
   }
-  auto result = read_bytes(expected.length());
-  std::string actual = std::string(result.begin(), result.end());
-  if (actual != expected) {
+  auto view = read_bytes_view(expected.length());
+  if (view.size != expected.length() ||
+      memcmp(view.data, expected.data(), view.size) != 0) {
     error_ = true;
   }
 
-  return result;
+  return std::vector<uint8_t>(view.begin(), view.end());
 }
 
-std::string kaitai::kstream::bytes_to_string(std::vector<uint8_t> bytes,
+kaitai::bytes_view kaitai::kstream::read_bytes_view(size_t len) {
+  if (error_) {
+    return bytes_view{nullptr, 0};
+  }
+  uint64_t size = len;
+  const uint8_t *data = parser_->getBytesView(current_name_, size);
+  return bytes_view{data, static_cast<size_t>(size)};
+}
+
+kaitai::bytes_view kaitai::kstream::read_bytes_full_view() {
+  if (error_) {
+    return bytes_view{nullptr, 0};
+  }
+  return read_bytes_view(parser_->bytesLeft());
+}
+
+std::string kaitai::kstream::bytes_to_string(const std::vector<uint8_t> &bytes,
+                                             const char *src_enc) {
+  return std::string(bytes.begin(), bytes.end());
+}
+
+std::string kaitai::kstream::bytes_to_string(bytes_view bytes,
                                              const char *src_enc) {
-  std::string res;
-  for (auto byte : bytes) {
-    res += byte;
+  if (!bytes.size) {
+    return std::string();
   }
-  return res;
+  return std::string(reinterpret_cast<const char *>(bytes.data), bytes.size);
 }
 
 void kaitai::kstream::pushName(const char *name) {
@@ -0,0 +1,305 @@
+/*
+ * Copyright 2017 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "kaitai/zip_parser.h"
+
+#include <algorithm>
+#include <climits>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <zlib.h>
+
+#include "dbif/info.h"
+#include "dbif/universe.h"
+#include "parser/utils.h"
+#include "util/concurrency/threadpool.h"
+
+namespace veles {
+namespace kaitai {
+
+namespace {
+
+// Sizes of fixed parts of ZIP records, not counting the "PK" magic and
+// section type which are parsed by pk_section_t.
+const uint64_t PK_SECTION_HEADER_SIZE = 4;
+const uint64_t LOCAL_FILE_HEADER_SIZE = 26;
+const uint64_t CENTRAL_DIR_ENTRY_SIZE = 42;
+const uint64_t END_OF_CENTRAL_DIR_SIZE = 18;
+
+// Members are inflated in batches of about this many bytes (input and
+// output together) - a single bigger member still makes a batch of its own.
+const uint64_t INFLATE_BATCH_BYTES = 64 * 1024 * 1024;
+
+struct ZipMember {
+  zip::zip_t::local_file_t *local_file;
+  uint16_t method;
+  uint64_t data_offset;
+  uint64_t compressed_size;
+  uint64_t uncompressed_size;
+  std::string name;
+  std::vector<uint8_t> input;
+  std::vector<uint8_t> output;
+  bool ok;
+};
+
+uint64_t sectionSize(zip::zip_t::pk_section_t *section) {
+  uint64_t size = PK_SECTION_HEADER_SIZE;
+  switch (section->section_type()) {
+  case 513: {
+    auto entry =
+        static_cast<zip::zip_t::central_dir_entry_t *>(section->body());
+    size += CENTRAL_DIR_ENTRY_SIZE + entry->file_name_len() +
+            entry->extra_len() + entry->comment_len();
+    break;
+  }
+  case 1027: {
+    auto local_file = static_cast<zip::zip_t::local_file_t *>(section->body());
+    auto header = local_file->header();
+    size += LOCAL_FILE_HEADER_SIZE + header->file_name_len() +
+            header->extra_len() + header->compressed_size();
+    break;
+  }
+  case 1541: {
+    auto eocd =
+        static_cast<zip::zip_t::end_of_central_dir_t *>(section->body());
+    size += END_OF_CENTRAL_DIR_SIZE + eocd->comment_len();
+    break;
+  }
+  default:
+    break;
+  }
+  return size;
+}
+
+bool inflateRaw(const std::vector<uint8_t> &in, uint64_t declared_size,
+                std::vector<uint8_t> &out) {
+  if (in.size() > UINT_MAX) {
+    return false;
+  }
+  // Deflate can't compress better than about 1:1032, don't trust bigger
+  // sizes coming from the archive.  The declared size is an upper bound
+  // too - a member inflating past it is broken (or a zip bomb).
+  uint64_t max_size = uint64_t(in.size()) * 1032 + 0x1000;
+  if (declared_size) {
+    max_size = std::min(max_size, declared_size);
+  }
+  z_stream strm;
+  strm.zalloc = Z_NULL;
+  strm.zfree = Z_NULL;
+  strm.opaque = Z_NULL;
+  strm.avail_in = static_cast<uInt>(in.size());
+  strm.next_in = const_cast<uint8_t *>(in.data());
+  // Negative window bits - ZIP members are raw deflate streams.
+  if (inflateInit2(&strm, -MAX_WBITS) != Z_OK) {
+    return false;
+  }
+  out.resize(std::min<uint64_t>(
+      declared_size ? declared_size : in.size() * 4 + 0x1000, max_size));
+  size_t written = 0;
+  while (true) {
+    if (written == out.size()) {
+      if (written >= max_size) {
+        // Still not at the end of the stream - check if there is any more
+        // output before failing, a stream may end exactly at the limit.
+        uint8_t extra;
+        strm.next_out = &extra;
+        strm.avail_out = 1;
+        auto ret = inflate(&strm, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END && strm.avail_out == 1) {
+          break;
+        }
+        inflateEnd(&strm);
+        return false;
+      }
+      out.resize(std::min<uint64_t>(out.size() * 2 + 0x1000, max_size));
+    }
+    strm.next_out = out.data() + written;
+    strm.avail_out = static_cast<uInt>(
+        std::min<size_t>(out.size() - written, UINT_MAX));
+    auto ret = inflate(&strm, Z_NO_FLUSH);
+    written = strm.next_out - out.data();
+    if (ret == Z_STREAM_END) {
+      break;
+    }
+    if (ret != Z_OK || (strm.avail_in == 0 && strm.avail_out != 0)) {
+      inflateEnd(&strm);
+      return false;
+    }
+  }
+  inflateEnd(&strm);
+  out.resize(written);
+  return true;
+}
+
+void decompressMember(ZipMember *member) {
+  if (member->method == zip::zip_t::COMPRESSION_NONE) {
+    member->output.swap(member->input);
+    member->ok = true;
+  } else {
+    member->ok = inflateRaw(member->input, member->uncompressed_size,
+                            member->output);
+    member->input.clear();
+  }
+}
+
+/** Memory needed to inflate a member - its input and (bounded) output.  */
+uint64_t memberBytes(const ZipMember &member) {
+  uint64_t max_output = member.compressed_size * 1032 + 0x1000;
+  return member.compressed_size +
+         (member.uncompressed_size
+              ? std::min(member.uncompressed_size, max_output)
+              : member.compressed_size * 4);
+}
+
+void inflateBatch(ZipMember *begin, ZipMember *end, dbif::ObjectHandle blob,
+                  uint64_t start) {
+  // Compressed data is already in memory when local header sizes are right,
+  // only the remaining members need to be fetched from the blob.
+  for (auto member = begin; member != end; ++member) {
+    auto body = member->local_file->body();
+    if (body.size() == member->compressed_size) {
+      member->input.swap(body);
+    } else {
+      auto data = blob->syncGetInfo<dbif::BlobDataRequest>(
+          start + member->data_offset,
+          start + member->data_offset + member->compressed_size)->data;
+      member->input.assign(data.rawData(), data.rawData() + data.octets());
+    }
+  }
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  size_t pending = end - begin;
+  for (auto member = begin; member != end; ++member) {
+    auto task = [member, &mutex, &cv, &pending]() {
+      decompressMember(member);
+      std::unique_lock<std::mutex> lc(mutex);
+      if (--pending == 0) {
+        cv.notify_one();
+      }
+    };
+    if (util::threadpool::runTask("parser", task) !=
+        util::threadpool::SchedulingResult::SCHEDULED) {
+      task();
+    }
+  }
+  {
+    std::unique_lock<std::mutex> lc(mutex);
+    cv.wait(lc, [&pending]() { return pending == 0; });
+  }
+
+  // Sub-blob creation has to go through the database, so it's done
+  // sequentially from the parser thread.
+  for (auto member = begin; member != end; ++member) {
+    if (member->ok) {
+      parser::makeSubBlob(
+          member->local_file->veles_obj, QString::fromStdString(member->name),
+          data::BinData(8, member->output.size(), member->output.data()));
+    }
+    std::vector<uint8_t>().swap(member->input);
+    std::vector<uint8_t>().swap(member->output);
+  }
+}
+
+}  // namespace
+
+void inflateZipMembers(zip::zip_t *zip, dbif::ObjectHandle blob,
+                       uint64_t start) {
+  std::map<uint64_t, zip::zip_t::local_file_t *> local_files;
+  std::vector<zip::zip_t::central_dir_entry_t *> central_dir;
+  uint64_t offset = 0;
+  for (auto section : *zip->sections()) {
+    if (section->section_type() == 1027) {
+      local_files[offset] =
+          static_cast<zip::zip_t::local_file_t *>(section->body());
+    } else if (section->section_type() == 513) {
+      central_dir.push_back(
+          static_cast<zip::zip_t::central_dir_entry_t *>(section->body()));
+    }
+    offset += sectionSize(section);
+  }
+
+  std::vector<ZipMember> members;
+  auto addMember = [&members](uint64_t local_offset,
+                              zip::zip_t::local_file_t *local_file,
+                              uint16_t method, uint64_t compressed_size,
+                              uint64_t uncompressed_size,
+                              const std::string &name) {
+    if (method != zip::zip_t::COMPRESSION_NONE &&
+        method != zip::zip_t::COMPRESSION_DEFLATED) {
+      return;
+    }
+    auto header = local_file->header();
+    ZipMember member;
+    member.local_file = local_file;
+    member.method = method;
+    member.data_offset = local_offset + PK_SECTION_HEADER_SIZE +
+        LOCAL_FILE_HEADER_SIZE + header->file_name_len() + header->extra_len();
+    member.compressed_size = compressed_size;
+    member.uncompressed_size = uncompressed_size;
+    member.name = name;
+    member.ok = false;
+    members.push_back(std::move(member));
+  };
+
+  if (!central_dir.empty()) {
+    // Central directory is authoritative - local headers may have zeroed
+    // sizes when a data descriptor follows the member data.
+    for (auto entry : central_dir) {
+      auto iter = local_files.find(uint32_t(entry->local_header_offset()));
+      if (iter == local_files.end()) {
+        continue;
+      }
+      addMember(iter->first, iter->second, entry->compression_method(),
+                entry->compressed_size(), entry->uncompressed_size(),
+                entry->file_name());
+    }
+  } else {
+    for (auto &local_file : local_files) {
+      auto header = local_file.second->header();
+      addMember(local_file.first, local_file.second, header->compression(),
+                header->compressed_size(), header->uncompressed_size(),
+                header->file_name());
+    }
+  }
+
+  if (members.empty()) {
+    return;
+  }
+
+  // Members are inflated and turned into sub-blobs a batch at a time, so
+  // that memory use is bounded by the batch and not the whole archive.
+  size_t batch_start = 0;
+  while (batch_start < members.size()) {
+    size_t batch_end = batch_start;
+    uint64_t batch_bytes = 0;
+    do {
+      batch_bytes += memberBytes(members[batch_end]);
+      batch_end++;
+    } while (batch_end < members.size() &&
+             batch_bytes + memberBytes(members[batch_end]) <=
+                 INFLATE_BATCH_BYTES);
+    inflateBatch(members.data() + batch_start, members.data() + batch_end, blob,
+                 start);
+    batch_start = batch_end;
+  }
+}
+
+}  // namespace kaitai
+}  // namespace veles
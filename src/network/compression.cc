@@ -0,0 +1,108 @@
+/*
+ * Copyright 2017 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include <zlib.h>
+
+#include <algorithm>
+
+#include "network/compression.h"
+#include "proto/exceptions.h"
+
+namespace veles {
+namespace messages {
+
+namespace {
+
+const char ZLIB_ALGORITHM[] = "zlib";
+
+/** The fastest level - the point is to save bandwidth on big replies, not
+    to make the sender CPU-bound.  */
+const int ZLIB_LEVEL = 1;
+
+}  // namespace
+
+std::vector<std::string> compressionAlgorithms() {
+  return {ZLIB_ALGORITHM};
+}
+
+bool compressionSupported(const std::string& algorithm) {
+  return algorithm == ZLIB_ALGORITHM;
+}
+
+bool compress(const std::string& algorithm, const char* data, size_t size,
+              std::vector<uint8_t>* out) {
+  if (size < COMPRESSION_THRESHOLD || !compressionSupported(algorithm)) {
+    return false;
+  }
+  std::vector<uint8_t> res(compressBound(size));
+  uLongf res_size = res.size();
+  if (compress2(res.data(), &res_size,
+                reinterpret_cast<const Bytef*>(data), size,
+                ZLIB_LEVEL) != Z_OK || res_size >= size) {
+    return false;
+  }
+  res.resize(res_size);
+  out->swap(res);
+  return true;
+}
+
+std::vector<uint8_t> decompress(const std::string& algorithm,
+                                const std::vector<uint8_t>& data,
+                                size_t max_size) {
+  if (!compressionSupported(algorithm)) {
+    throw proto::SchemaError("Unknown compression algorithm");
+  }
+  std::vector<uint8_t> res;
+  z_stream strm;
+  strm.zalloc = Z_NULL;
+  strm.zfree = Z_NULL;
+  strm.opaque = Z_NULL;
+  strm.avail_in = static_cast<uInt>(data.size());
+  strm.next_in = const_cast<Bytef*>(data.data());
+  if (inflateInit(&strm) != Z_OK) {
+    throw proto::SchemaError("Cannot initialize decompression");
+  }
+  // Messages worth compressing tend to compress well - start big.  One
+  // byte past max_size is enough to tell the data is too big.
+  res.resize(std::min(data.size() * 4, max_size + 1));
+  size_t done = 0;
+  while (true) {
+    strm.next_out = res.data() + done;
+    strm.avail_out = static_cast<uInt>(res.size() - done);
+    int ret = inflate(&strm, Z_NO_FLUSH);
+    done = res.size() - strm.avail_out;
+    if (done > max_size) {
+      inflateEnd(&strm);
+      throw proto::SchemaError("Decompressed data too big");
+    }
+    if (ret == Z_STREAM_END) {
+      break;
+    }
+    if (ret != Z_OK || (strm.avail_in == 0 && strm.avail_out != 0)) {
+      inflateEnd(&strm);
+      throw proto::SchemaError("Corrupted compressed data");
+    }
+    if (strm.avail_out == 0) {
+      res.resize(std::min(res.size() * 2, max_size + 1));
+    }
+  }
+  inflateEnd(&strm);
+  res.resize(done);
+  return res;
+}
+
+}  // namespace messages
+}  // namespace veles
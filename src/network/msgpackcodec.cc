@@ -0,0 +1,242 @@
+/*
+ * Copyright 2017 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "network/msgpackcodec.h"
+#include "models.h"
+#include "util/int_bytes.h"
+
+namespace veles {
+namespace messages {
+
+namespace {
+
+thread_local const std::shared_ptr<msgpack::zone> *current_zone = nullptr;
+
+/** Smaller BinData payloads are copied even inside a SharedZoneScope -
+    referencing them would keep a whole receive buffer alive for the sake
+    of a few bytes.  */
+const size_t SHARED_BINDATA_MIN_OCTETS = 4096;
+
+}  // namespace
+
+SharedZoneScope::SharedZoneScope(std::shared_ptr<msgpack::zone> zone)
+    : saved_(current_zone), zone_(std::move(zone)) {
+  current_zone = &zone_;
+}
+
+SharedZoneScope::~SharedZoneScope() {
+  current_zone = saved_;
+}
+
+void fromMsgpack(const msgpack::object& obj, bool& out) {
+  details_::checkType(obj, msgpack::type::BOOLEAN, "bool");
+  out = obj.via.boolean;
+}
+
+void fromMsgpack(const msgpack::object& obj, int64_t& out) {
+  if (obj.type == msgpack::type::NEGATIVE_INTEGER) {
+    out = obj.via.i64;
+  } else if (obj.type == msgpack::type::POSITIVE_INTEGER &&
+             obj.via.u64 <= INT64_MAX) {
+    out = static_cast<int64_t>(obj.via.u64);
+  } else {
+    throw proto::SchemaError("Wrong msgpack type when trying to get signed int");
+  }
+}
+
+void fromMsgpack(const msgpack::object& obj, uint64_t& out) {
+  // Negative integers are never valid here.
+  details_::checkType(obj, msgpack::type::POSITIVE_INTEGER, "unsigned int");
+  out = obj.via.u64;
+}
+
+void fromMsgpack(const msgpack::object& obj, double& out) {
+  if (obj.type != msgpack::type::FLOAT32 &&
+      obj.type != msgpack::type::FLOAT64) {
+    throw proto::SchemaError("Wrong msgpack type when trying to get double");
+  }
+  out = obj.via.f64;
+}
+
+void fromMsgpack(const msgpack::object& obj, std::shared_ptr<std::string>& out) {
+  details_::checkType(obj, msgpack::type::STR, "string");
+  out = std::make_shared<std::string>(obj.via.str.ptr, obj.via.str.size);
+}
+
+void fromMsgpack(const msgpack::object& obj, std::shared_ptr<std::vector<uint8_t>>& out) {
+  details_::checkType(obj, msgpack::type::BIN, "binary data");
+  auto data = reinterpret_cast<const uint8_t*>(obj.via.bin.ptr);
+  out = std::make_shared<std::vector<uint8_t>>(data, data + obj.via.bin.size);
+}
+
+void fromMsgpack(const msgpack::object& obj, std::shared_ptr<data::NodeID>& out) {
+  if (obj.type == msgpack::type::NIL) {
+    out = data::NodeID::getNilId();
+    return;
+  }
+  details_::checkType(obj, msgpack::type::EXT, "ext");
+  if (obj.via.ext.type() != proto::EXT_NODE_ID) {
+    throw proto::SchemaError("Wrong ext type for NodeID");
+  }
+  if (obj.via.ext.size != data::NodeID::WIDTH) {
+    throw proto::SchemaError("Wrong NodeID size");
+  }
+  out = std::make_shared<data::NodeID>(
+      reinterpret_cast<const uint8_t*>(obj.via.ext.data()));
+}
+
+void fromMsgpack(const msgpack::object& obj, std::shared_ptr<data::BinData>& out) {
+  details_::checkType(obj, msgpack::type::EXT, "ext");
+  if (obj.via.ext.type() != proto::EXT_BINDATA) {
+    throw proto::SchemaError("Wrong ext type for BinData");
+  }
+  if (obj.via.ext.size < 4) {
+    throw proto::SchemaError("Not enough data for BinData unpack");
+  }
+  auto data = reinterpret_cast<const uint8_t*>(obj.via.ext.data());
+  uint32_t width = util::bytesToIntLe<uint32_t>(data, 4);
+  if (width == 0) {
+    throw proto::SchemaError("Invalid BinData width");
+  }
+  size_t size = (obj.via.ext.size - 4) / data::BinData(width, 0).octetsPerElement();
+  if (current_zone && obj.via.ext.size - 4 >= SHARED_BINDATA_MIN_OCTETS) {
+    out = std::make_shared<data::BinData>(data::BinData::fromSharedData(
+        width, size, data + 4, *current_zone));
+  } else {
+    out = std::make_shared<data::BinData>(width, size, data + 4);
+  }
+}
+
+void fromMsgpack(const msgpack::object& obj, std::shared_ptr<proto::VelesException>& out) {
+  if (obj.type == msgpack::type::NIL) {
+    out = nullptr;
+    return;
+  }
+  details_::checkType(obj, msgpack::type::MAP, "map");
+  std::shared_ptr<std::string> type;
+  std::shared_ptr<std::string> message;
+  for (uint32_t i = 0; i < obj.via.map.size; i++) {
+    const msgpack::object_kv& kv = obj.via.map.ptr[i];
+    if (details_::strEquals(kv.key, "type")) {
+      fromMsgpack(kv.val, type);
+    } else if (details_::strEquals(kv.key, "message")) {
+      fromMsgpack(kv.val, message);
+    } else {
+      throw proto::SchemaError("unknown field in exception");
+    }
+  }
+  if (!type)
+    throw proto::SchemaError("exception type missing");
+  if (!message)
+    throw proto::SchemaError("exception message missing");
+  out = std::make_shared<proto::VelesException>(*type, *message);
+}
+
+void fromMsgpack(const msgpack::object& obj, std::shared_ptr<MsgpackObject>& out) {
+  out = std::make_shared<MsgpackObject>(obj);
+}
+
+void toMsgpack(MsgpackPacker& pk, bool val) {
+  if (val) {
+    pk.pack_true();
+  } else {
+    pk.pack_false();
+  }
+}
+
+void toMsgpack(MsgpackPacker& pk, int64_t val) {
+  pk.pack_int64(val);
+}
+
+void toMsgpack(MsgpackPacker& pk, uint64_t val) {
+  pk.pack_uint64(val);
+}
+
+void toMsgpack(MsgpackPacker& pk, double val) {
+  pk.pack_double(val);
+}
+
+void toMsgpack(MsgpackPacker& pk, const std::string& val) {
+  pk.pack_str(static_cast<uint32_t>(val.size()));
+  pk.pack_str_body(val.data(), static_cast<uint32_t>(val.size()));
+}
+
+void toMsgpack(MsgpackPacker& pk, const std::shared_ptr<std::string> val) {
+  if (!val) {
+    pk.pack_nil();
+    return;
+  }
+  toMsgpack(pk, *val);
+}
+
+void toMsgpack(MsgpackPacker& pk, const std::shared_ptr<std::vector<uint8_t>> val) {
+  if (!val) {
+    pk.pack_nil();
+    return;
+  }
+  pk.pack_bin(static_cast<uint32_t>(val->size()));
+  pk.pack_bin_body(reinterpret_cast<const char*>(val->data()),
+                   static_cast<uint32_t>(val->size()));
+}
+
+void toMsgpack(MsgpackPacker& pk, const std::shared_ptr<data::NodeID> val) {
+  if (!val || !*val) {
+    pk.pack_nil();
+    return;
+  }
+  pk.pack_ext(data::NodeID::WIDTH, static_cast<int8_t>(proto::EXT_NODE_ID));
+  pk.pack_ext_body(reinterpret_cast<const char*>(val->data()),
+                   data::NodeID::WIDTH);
+}
+
+void toMsgpack(MsgpackPacker& pk, const std::shared_ptr<data::BinData> val) {
+  if (!val) {
+    pk.pack_nil();
+    return;
+  }
+  // Go through a const reference - the non-const rawData() would detach
+  // a shared buffer just to read it.
+  const data::BinData& bindata = *val;
+  uint8_t width[4];
+  util::intToBytesLe(bindata.width(), 4, width);
+  pk.pack_ext(4 + bindata.octets(), static_cast<int8_t>(proto::EXT_BINDATA));
+  pk.pack_ext_body(reinterpret_cast<const char*>(width), 4);
+  pk.pack_ext_body(reinterpret_cast<const char*>(bindata.rawData()),
+                   static_cast<uint32_t>(bindata.octets()));
+}
+
+void toMsgpack(MsgpackPacker& pk, const std::shared_ptr<proto::VelesException> val) {
+  if (!val) {
+    pk.pack_nil();
+    return;
+  }
+  pk.pack_map(2);
+  details_::packStr(pk, "message");
+  toMsgpack(pk, val->msg);
+  details_::packStr(pk, "type");
+  toMsgpack(pk, val->code);
+}
+
+void toMsgpack(MsgpackPacker& pk, const std::shared_ptr<MsgpackObject> val) {
+  if (!val) {
+    pk.pack_nil();
+    return;
+  }
+  pk.pack(*val);
+}
+
+}  // namespace messages
+}  // namespace veles
@@ -0,0 +1,661 @@
+/*
+ * Copyright 2017 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Load generator for the client protocol.  Runs scripted workloads against
+// a server through NetworkClient and reports latency and throughput of
+// each of them:
+//
+//   bindata    - paged reads of a big blob (MsgGetBinData),
+//   tree       - a walk over a freshly built node tree (MsgGetList),
+//   create     - a storm of node creations (MsgCreate),
+//   subscribe  - fan-out of node changes to many subscriptions (MsgGet).
+//
+// The workloads create their own nodes under the root, so point it at
+// a throwaway database - or let it start a server with --server.
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QProcess>
+#include <QStringList>
+#include <QTextStream>
+#include <QTimer>
+
+#include "client/networkclient.h"
+#include "data/nodeid.h"
+#include "network/msgpackobject.h"
+#include "models.h"
+
+namespace veles {
+namespace bench {
+
+using client::NetworkClient;
+using client::msg_ptr;
+
+/*****************************************************************************/
+/* NetworkBenchmark */
+/*****************************************************************************/
+
+class NetworkBenchmark : public QObject {
+  Q_OBJECT
+
+ public:
+  struct Options {
+    int requests = 1000;
+    int window = 16;
+    uint64_t blob_size = 16 << 20;
+    uint64_t page_size = 64 << 10;
+    int tree_depth = 3;
+    int tree_fanout = 10;
+    int subscribers = 100;
+  };
+
+  NetworkBenchmark(NetworkClient* client, QStringList workloads,
+      Options options, QObject* parent = nullptr);
+
+ signals:
+  void finished(int exit_code);
+
+ public slots:
+  void connectionStatusChanged(NetworkClient::ConnectionStatus status);
+  void messageReceived(msg_ptr message);
+
+ private:
+  /** Called with every reply to a request and the time since it was sent,
+      in nanoseconds.  */
+  typedef std::function<void(msg_ptr, qint64)> ReplyHandler;
+  typedef std::shared_ptr<std::unordered_map<std::string,
+      std::shared_ptr<std::vector<uint8_t>>>> BinDataMap;
+
+  struct Request {
+    qint64 sent_ns;
+    ReplyHandler handler;
+  };
+
+  void send(uint64_t id, msg_ptr msg, ReplyHandler handler);
+  void createNode(std::shared_ptr<data::NodeID> id,
+      std::shared_ptr<data::NodeID> parent, BinDataMap bindata,
+      ReplyHandler handler);
+  void finish(int exit_code);
+  void fail(QString message);
+
+  void runNext();
+  void beginMeasurement();
+  void record(qint64 latency_ns);
+  void workloadDone();
+
+  void startBindata();
+  void sendBindataRead();
+  void startTree();
+  void buildTreeLevel(
+      std::vector<std::shared_ptr<data::NodeID>> parents, int depth);
+  void sendTreeList(std::shared_ptr<data::NodeID> id);
+  void startCreate();
+  void sendCreate();
+  void startSubscribe();
+  void nextSubscribeRound();
+  void checkSubscribeRound();
+
+  NetworkClient* client_;
+  QStringList workloads_;
+  Options options_;
+  QElapsedTimer clock_;
+  std::unordered_map<uint64_t, Request> requests_;
+  bool started_;
+  bool finished_;
+
+  // State of the current workload.
+  QString name_;
+  qint64 start_ns_;
+  std::vector<qint64> latencies_;
+  uint64_t payload_bytes_;
+  int issued_;
+  int completed_;
+  int outstanding_;
+  std::shared_ptr<data::NodeID> node_;
+  std::vector<uint64_t> sub_qids_;
+  bool subscribed_;
+  int round_;
+  qint64 round_start_ns_;
+  int round_updates_;
+  bool round_acked_;
+};
+
+NetworkBenchmark::NetworkBenchmark(NetworkClient* client,
+    QStringList workloads, Options options, QObject* parent)
+    : QObject(parent), client_(client), workloads_(workloads),
+    options_(options), started_(false), finished_(false), start_ns_(0),
+    payload_bytes_(0), issued_(0), completed_(0), outstanding_(0),
+    subscribed_(false), round_(0),
+    round_start_ns_(0), round_updates_(0), round_acked_(false) {
+  clock_.start();
+  connect(client_, &NetworkClient::connectionStatusChanged,
+      this, &NetworkBenchmark::connectionStatusChanged);
+  connect(client_, &NetworkClient::messageReceived,
+      this, &NetworkBenchmark::messageReceived);
+}
+
+void NetworkBenchmark::connectionStatusChanged(
+    NetworkClient::ConnectionStatus status) {
+  if (status == NetworkClient::ConnectionStatus::Connected && !started_) {
+    started_ = true;
+    QTextStream(stdout) << QString("%1 %2 %3 %4 %5 %6 %7")
+        .arg("workload", -10).arg("replies", 9).arg("time [s]", 9)
+        .arg("msgs/s", 10).arg("MB/s", 9).arg("p50 [us]", 10)
+        .arg("p99 [us]", 10) << endl;
+    runNext();
+  } else if (status == NetworkClient::ConnectionStatus::NotConnected
+      && !finished_) {
+    fail(started_ ? "connection lost" : "can't connect to the server");
+  }
+}
+
+void NetworkBenchmark::messageReceived(msg_ptr message) {
+  uint64_t id;
+  if (auto reply = std::dynamic_pointer_cast<proto::MsgGetReply>(message)) {
+    id = reply->qid;
+  } else if (auto reply =
+      std::dynamic_pointer_cast<proto::MsgGetListReply>(message)) {
+    id = reply->qid;
+  } else if (auto reply =
+      std::dynamic_pointer_cast<proto::MsgGetBinDataReply>(message)) {
+    id = reply->qid;
+  } else if (auto reply =
+      std::dynamic_pointer_cast<proto::MsgRequestAck>(message)) {
+    id = reply->rid;
+  } else if (auto reply =
+      std::dynamic_pointer_cast<proto::MsgRequestError>(message)) {
+    fail(QString("request error - %1").arg(
+        QString::fromStdString(reply->err->msg)));
+    return;
+  } else if (auto reply =
+      std::dynamic_pointer_cast<proto::MsgQueryError>(message)) {
+    fail(QString("query error - %1").arg(
+        QString::fromStdString(reply->err->msg)));
+    return;
+  } else {
+    return;
+  }
+
+  auto iter = requests_.find(id);
+  if (iter == requests_.end()) {
+    return;
+  }
+  // The handler may send more requests - don't keep the iterator around.
+  ReplyHandler handler = iter->second.handler;
+  handler(message, clock_.nsecsElapsed() - iter->second.sent_ns);
+}
+
+void NetworkBenchmark::send(uint64_t id, msg_ptr msg, ReplyHandler handler) {
+  Request request;
+  request.sent_ns = clock_.nsecsElapsed();
+  request.handler = handler;
+  requests_[id] = request;
+  client_->sendMessage(msg);
+}
+
+void NetworkBenchmark::createNode(std::shared_ptr<data::NodeID> id,
+    std::shared_ptr<data::NodeID> parent, BinDataMap bindata,
+    ReplyHandler handler) {
+  auto tags = std::make_shared<std::unordered_set<
+      std::shared_ptr<std::string>>>();
+  tags->insert(std::make_shared<std::string>("bench"));
+  auto attr = std::make_shared<std::unordered_map<
+      std::string, std::shared_ptr<messages::MsgpackObject>>>();
+  auto data = std::make_shared<std::unordered_map<
+      std::string, std::shared_ptr<messages::MsgpackObject>>>();
+  if (!bindata) {
+    bindata = std::make_shared<std::unordered_map<
+        std::string, std::shared_ptr<std::vector<uint8_t>>>>();
+  }
+  auto triggers = std::make_shared<std::unordered_set<
+      std::shared_ptr<std::string>>>();
+  const auto null_pos = std::pair<bool, int64_t>(false, 0);
+
+  uint64_t rid = client_->nextQid();
+  send(rid, std::make_shared<proto::MsgCreate>(rid, id, parent, null_pos,
+      null_pos, tags, attr, data, bindata, triggers),
+      [this, rid, handler](msg_ptr reply, qint64 latency_ns) {
+        requests_.erase(rid);
+        handler(reply, latency_ns);
+      });
+}
+
+void NetworkBenchmark::finish(int exit_code) {
+  finished_ = true;
+  requests_.clear();
+  workloads_.clear();
+  emit finished(exit_code);
+}
+
+void NetworkBenchmark::fail(QString message) {
+  if (finished_) {
+    return;
+  }
+  QTextStream(stderr) << "network_bench: " << message << endl;
+  finish(1);
+}
+
+void NetworkBenchmark::runNext() {
+  if (finished_) {
+    return;
+  }
+  requests_.clear();
+  if (workloads_.isEmpty()) {
+    finish(0);
+    return;
+  }
+
+  name_ = workloads_.takeFirst();
+  latencies_.clear();
+  payload_bytes_ = 0;
+  issued_ = 0;
+  completed_ = 0;
+  outstanding_ = 0;
+
+  if (name_ == "bindata") {
+    startBindata();
+  } else if (name_ == "tree") {
+    startTree();
+  } else if (name_ == "create") {
+    startCreate();
+  } else if (name_ == "subscribe") {
+    startSubscribe();
+  } else {
+    fail(QString("unknown workload \"%1\"").arg(name_));
+  }
+}
+
+void NetworkBenchmark::beginMeasurement() {
+  start_ns_ = clock_.nsecsElapsed();
+}
+
+void NetworkBenchmark::record(qint64 latency_ns) {
+  latencies_.push_back(latency_ns);
+}
+
+void NetworkBenchmark::workloadDone() {
+  double seconds = (clock_.nsecsElapsed() - start_ns_) / 1e9;
+  std::sort(latencies_.begin(), latencies_.end());
+  auto percentile = [this](double q) -> double {
+    if (latencies_.empty()) {
+      return 0;
+    }
+    size_t index = std::min(latencies_.size() - 1,
+        static_cast<size_t>(q * latencies_.size()));
+    return latencies_[index] / 1e3;
+  };
+
+  QString mb_per_second("-");
+  if (payload_bytes_ > 0) {
+    mb_per_second = QString::number(payload_bytes_ / seconds / (1 << 20),
+        'f', 1);
+  }
+  QTextStream(stdout) << QString("%1 %2 %3 %4 %5 %6 %7")
+      .arg(name_, -10)
+      .arg(static_cast<qulonglong>(latencies_.size()), 9)
+      .arg(seconds, 9, 'f', 3)
+      .arg(latencies_.size() / seconds, 10, 'f', 0).arg(mb_per_second, 9)
+      .arg(percentile(0.5), 10, 'f', 0).arg(percentile(0.99), 10, 'f', 0)
+      << endl;
+
+  // Let the last replies of the workload go before starting the next one.
+  QTimer::singleShot(0, this, &NetworkBenchmark::runNext);
+}
+
+/* bindata: a blob of blob_size bytes is read in page_size pages, with up
+   to window reads in flight.  */
+
+void NetworkBenchmark::startBindata() {
+  auto payload = std::make_shared<std::vector<uint8_t>>(options_.blob_size);
+  for (size_t i = 0; i < payload->size(); i++) {
+    (*payload)[i] = static_cast<uint8_t>(i * 7);
+  }
+  auto bindata = std::make_shared<std::unordered_map<
+      std::string, std::shared_ptr<std::vector<uint8_t>>>>();
+  (*bindata)["data"] = payload;
+
+  node_ = std::make_shared<data::NodeID>();
+  createNode(node_, data::NodeID::getRootNodeId(), bindata,
+      [this](msg_ptr, qint64) {
+        beginMeasurement();
+        for (int i = 0; i < options_.window; i++) {
+          sendBindataRead();
+        }
+      });
+}
+
+void NetworkBenchmark::sendBindataRead() {
+  if (issued_ >= options_.requests) {
+    return;
+  }
+  uint64_t pages = std::max<uint64_t>(
+      1, options_.blob_size / options_.page_size);
+  uint64_t start = (issued_ % pages) * options_.page_size;
+  uint64_t end = std::min(start + options_.page_size, options_.blob_size);
+  issued_++;
+
+  uint64_t qid = client_->nextQid();
+  send(qid, std::make_shared<proto::MsgGetBinData>(qid, node_,
+      std::make_shared<std::string>("data"), start,
+      std::pair<bool, uint64_t>(true, end), false),
+      [this, qid](msg_ptr message, qint64 latency_ns) {
+        requests_.erase(qid);
+        auto reply = std::dynamic_pointer_cast<proto::MsgGetBinDataReply>(
+            message);
+        record(latency_ns);
+        payload_bytes_ += reply->data->size();
+        if (++completed_ == options_.requests) {
+          workloadDone();
+        } else {
+          sendBindataRead();
+        }
+      });
+}
+
+/* tree: a tree of tree_fanout^tree_depth leaves is built level by level,
+   then walked from its top - each node is listed as soon as its parent's
+   list arrives.  */
+
+void NetworkBenchmark::startTree() {
+  node_ = std::make_shared<data::NodeID>();
+  createNode(node_, data::NodeID::getRootNodeId(), nullptr,
+      [this](msg_ptr, qint64) {
+        buildTreeLevel({node_}, 1);
+      });
+}
+
+void NetworkBenchmark::buildTreeLevel(
+    std::vector<std::shared_ptr<data::NodeID>> parents, int depth) {
+  if (depth > options_.tree_depth) {
+    beginMeasurement();
+    sendTreeList(node_);
+    return;
+  }
+
+  auto children = std::make_shared<
+      std::vector<std::shared_ptr<data::NodeID>>>();
+  for (const auto& parent : parents) {
+    for (int i = 0; i < options_.tree_fanout; i++) {
+      children->push_back(std::make_shared<data::NodeID>());
+      outstanding_++;
+      createNode(children->back(), parent, nullptr,
+          [this, children, depth](msg_ptr, qint64) {
+            if (--outstanding_ == 0) {
+              buildTreeLevel(*children, depth + 1);
+            }
+          });
+    }
+  }
+}
+
+void NetworkBenchmark::sendTreeList(std::shared_ptr<data::NodeID> id) {
+  const auto null_pos = std::pair<bool, int64_t>(false, 0);
+  uint64_t qid = client_->nextQid();
+  outstanding_++;
+  send(qid, std::make_shared<proto::MsgGetList>(qid, id,
+      std::make_shared<std::unordered_set<std::shared_ptr<std::string>>>(),
+      std::make_shared<proto::PosFilter>(
+          null_pos, null_pos, null_pos, null_pos),
+      false),
+      [this, qid](msg_ptr message, qint64 latency_ns) {
+        requests_.erase(qid);
+        auto reply = std::dynamic_pointer_cast<proto::MsgGetListReply>(
+            message);
+        record(latency_ns);
+        for (const auto& obj : *reply->objs) {
+          sendTreeList(obj->id);
+        }
+        if (--outstanding_ == 0) {
+          workloadDone();
+        }
+      });
+}
+
+/* create: requests nodes are created under a common parent, with up to
+   window creations in flight.  */
+
+void NetworkBenchmark::startCreate() {
+  node_ = std::make_shared<data::NodeID>();
+  createNode(node_, data::NodeID::getRootNodeId(), nullptr,
+      [this](msg_ptr, qint64) {
+        beginMeasurement();
+        for (int i = 0; i < options_.window; i++) {
+          sendCreate();
+        }
+      });
+}
+
+void NetworkBenchmark::sendCreate() {
+  if (issued_ >= options_.requests) {
+    return;
+  }
+  issued_++;
+  createNode(std::make_shared<data::NodeID>(), node_, nullptr,
+      [this](msg_ptr, qint64 latency_ns) {
+        record(latency_ns);
+        if (++completed_ == options_.requests) {
+          workloadDone();
+        } else {
+          sendCreate();
+        }
+      });
+}
+
+/* subscribe: subscribers subscriptions watch a single node, which is then
+   changed requests times.  Each round waits for all the updates, whose
+   latency is counted from sending the change.  */
+
+void NetworkBenchmark::startSubscribe() {
+  node_ = std::make_shared<data::NodeID>();
+  sub_qids_.clear();
+  subscribed_ = false;
+  round_ = 0;
+  createNode(node_, data::NodeID::getRootNodeId(), nullptr,
+      [this](msg_ptr, qint64) {
+        for (int i = 0; i < options_.subscribers; i++) {
+          uint64_t qid = client_->nextQid();
+          sub_qids_.push_back(qid);
+          send(qid, std::make_shared<proto::MsgGet>(qid, node_, true),
+              [this](msg_ptr, qint64) {
+                if (!subscribed_) {
+                  // Initial replies of the subscriptions.
+                  if (++completed_ == options_.subscribers) {
+                    subscribed_ = true;
+                    beginMeasurement();
+                    nextSubscribeRound();
+                  }
+                  return;
+                }
+                record(clock_.nsecsElapsed() - round_start_ns_);
+                round_updates_++;
+                checkSubscribeRound();
+              });
+        }
+      });
+}
+
+void NetworkBenchmark::nextSubscribeRound() {
+  if (round_ == options_.requests) {
+    for (uint64_t qid : sub_qids_) {
+      requests_.erase(qid);
+      client_->sendMessage(
+          std::make_shared<proto::MsgCancelSubscription>(qid));
+    }
+    workloadDone();
+    return;
+  }
+
+  round_updates_ = 0;
+  round_acked_ = false;
+  round_start_ns_ = clock_.nsecsElapsed();
+  uint64_t rid = client_->nextQid();
+  send(rid, std::make_shared<proto::MsgSetAttr>(rid, node_,
+      std::make_shared<std::string>("round"),
+      std::make_pair(true, std::make_shared<messages::MsgpackObject>(
+          static_cast<uint64_t>(round_)))),
+      [this, rid](msg_ptr, qint64) {
+        requests_.erase(rid);
+        round_acked_ = true;
+        checkSubscribeRound();
+      });
+}
+
+void NetworkBenchmark::checkSubscribeRound() {
+  if (round_acked_ && round_updates_ >= options_.subscribers) {
+    round_++;
+    nextSubscribeRound();
+  }
+}
+
+}  // namespace bench
+}  // namespace veles
+
+#include "network_bench.moc"
+
+int main(int argc, char** argv) {
+  QCoreApplication app(argc, argv);
+  qRegisterMetaType<veles::client::NetworkClient::ConnectionStatus>(
+      "veles::client::NetworkClient::ConnectionStatus");
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription(
+      "Measures latency and throughput of the client protocol.  Workloads: "
+      "bindata, tree, create, subscribe (all of them by default).");
+  parser.addHelpOption();
+  QCommandLineOption host_option("host", "Server host.", "host", "127.0.0.1");
+  QCommandLineOption port_option("port", "Server port.", "port", "3135");
+  QCommandLineOption key_option("key", "Hex-encoded authentication key.",
+      "key", "");
+  QCommandLineOption local_option("local-socket",
+      "Connect through this UNIX socket instead of TCP.", "path");
+  QCommandLineOption server_option("server",
+      "Start this server script (srv.py) with an in-memory database "
+      "and run against it.", "script");
+  QCommandLineOption batch_option("batch", "Batch outgoing messages.");
+  QCommandLineOption compress_option("compress", "Compress the traffic.");
+  QCommandLineOption requests_option("requests",
+      "Requests (or subscription rounds) per workload.", "n", "1000");
+  QCommandLineOption window_option("window",
+      "Requests in flight for bindata and create.", "n", "16");
+  QCommandLineOption blob_size_option("blob-size",
+      "Size of the blob read by bindata.", "bytes",
+      QString::number(16 << 20));
+  QCommandLineOption page_size_option("page-size",
+      "Size of a single bindata read.", "bytes", QString::number(64 << 10));
+  QCommandLineOption depth_option("tree-depth", "Depth of the tree.",
+      "n", "3");
+  QCommandLineOption fanout_option("tree-fanout",
+      "Children of each inner tree node.", "n", "10");
+  QCommandLineOption subscribers_option("subscribers",
+      "Subscriptions watching the node in subscribe.", "n", "100");
+  parser.addOptions({host_option, port_option, key_option, local_option,
+      server_option, batch_option, compress_option, requests_option,
+      window_option, blob_size_option, page_size_option, depth_option,
+      fanout_option, subscribers_option});
+  parser.addPositionalArgument("workloads", "Workloads to run.",
+      "[workload...]");
+  parser.process(app);
+
+  veles::bench::NetworkBenchmark::Options options;
+  options.requests = std::max(1, parser.value(requests_option).toInt());
+  options.window = std::max(1, parser.value(window_option).toInt());
+  options.blob_size = std::max<qulonglong>(
+      1, parser.value(blob_size_option).toULongLong());
+  options.page_size = std::max<qulonglong>(
+      1, parser.value(page_size_option).toULongLong());
+  options.tree_depth = std::max(1, parser.value(depth_option).toInt());
+  options.tree_fanout = std::max(1, parser.value(fanout_option).toInt());
+  options.subscribers = std::max(1, parser.value(subscribers_option).toInt());
+
+  QStringList workloads = parser.positionalArguments();
+  if (workloads.isEmpty()) {
+    workloads << "bindata" << "tree" << "create" << "subscribe";
+  }
+
+  auto client = new veles::client::NetworkClient(&app);
+  client->setBatchMessages(parser.isSet(batch_option));
+  client->setCompressMessages(parser.isSet(compress_option));
+  client->setLocalServerName(parser.value(local_option));
+  auto benchmark = new veles::bench::NetworkBenchmark(
+      client, workloads, options, &app);
+
+  QString host = parser.value(host_option);
+  int port = parser.value(port_option).toInt();
+  QString key = parser.value(key_option);
+  // A server started here goes away with the connection.
+  bool own_server = parser.isSet(server_option);
+  auto start_client = [=]() {
+    client->connect(host, port, "", "network_bench", "", "", "",
+        QByteArray::fromHex(key.toUtf8()), own_server);
+  };
+
+  QObject::connect(benchmark, &veles::bench::NetworkBenchmark::finished,
+      [&app, client](int exit_code) {
+        client->disconnect();
+        app.exit(exit_code);
+      });
+
+  QProcess* server = nullptr;
+  if (own_server) {
+    server = new QProcess(&app);
+    server->setProcessChannelMode(QProcess::MergedChannels);
+    QStringList arguments;
+    arguments << parser.value(server_option);
+    if (parser.isSet(local_option)) {
+      arguments << "--unix-socket" << parser.value(local_option);
+    }
+    arguments << QString("%1:%2").arg(host).arg(port) << key;
+    // The server logs "Ready." once it listens.
+    auto output = std::make_shared<QByteArray>();
+    QObject::connect(server, &QIODevice::readyRead,
+        [server, output, start_client]() {
+          bool was_ready = output->contains("Ready.");
+          output->append(server->readAll());
+          if (!was_ready && output->contains("Ready.")) {
+            start_client();
+          }
+        });
+    QObject::connect(server, static_cast<void(QProcess::*)
+        (int, QProcess::ExitStatus)>(&QProcess::finished),
+        [&app, output](int, QProcess::ExitStatus) {
+          if (!output->contains("Ready.")) {
+            QTextStream(stderr) << "network_bench: the server failed to "
+                "start:" << endl << *output;
+            app.exit(1);
+          }
+        });
+    server->start("python3", arguments);
+  } else {
+    start_client();
+  }
+
+  int result = app.exec();
+  if (server) {
+    server->terminate();
+    server->waitForFinished(2000);
+  }
+  return result;
+}
@@ -21,8 +21,31 @@
 namespace veles {
 namespace parser {
 
+namespace {
+
+thread_local const ParseOrigin *current_origin = nullptr;
+
+class OriginScope {
+  ParseOrigin origin_;
+  const ParseOrigin *saved_;
+
+ public:
+  OriginScope(const ParseOrigin &origin)
+      : origin_(origin), saved_(current_origin) {
+    current_origin = &origin_;
+  }
+  ~OriginScope() { current_origin = saved_; }
+};
+
+}  // namespace
+
+const ParseOrigin *currentParseOrigin() {
+  return current_origin;
+}
+
 bool Parser::verifyAndParse(dbif::ObjectHandle blob, uint64_t start,
                             dbif::ObjectHandle parent_chunk) {
+  OriginScope scope(ParseOrigin{_id, blob, start, parent_chunk});
   if (_magic.size() > 0) {
     for (auto magic : _magic) {
       auto data = blob->syncGetInfo<dbif::BlobDataRequest>(start, start + magic.size())->data;
@@ -122,6 +122,10 @@ QString ConnectionDialog::serverScript() {
   return ui_->server_executable_line_edit->text();
 }
 
+bool ConnectionDialog::compression() {
+  return ui_->compression_check_box->isChecked();
+}
+
 QString localhost("127.0.0.1");
 
 void ConnectionDialog::serverLocalhost() {
@@ -182,6 +186,8 @@ void ConnectionDialog::loadDefaultValues() {
       util::settings::connection::databaseNameDefault());
   ui_->server_executable_line_edit->setText(
       util::settings::connection::serverScriptDefault());
+  ui_->compression_check_box->setChecked(
+      util::settings::connection::compressionDefault());
 }
 
 void ConnectionDialog::loadProfiles() {
@@ -210,6 +216,8 @@ void ConnectionDialog::loadSettings() {
       util::settings::connection::databaseName());
   ui_->server_executable_line_edit->setText(
       util::settings::connection::serverScript());
+  ui_->compression_check_box->setChecked(
+      util::settings::connection::compression());
 }
 
 void ConnectionDialog::saveSettings() {
@@ -231,6 +239,8 @@ void ConnectionDialog::saveSettings() {
       ui_->database_line_edit->text());
   util::settings::connection::setServerScript(
       ui_->server_executable_line_edit->text());
+  util::settings::connection::setCompression(
+      ui_->compression_check_box->isChecked());
 
   loadProfiles();
 }
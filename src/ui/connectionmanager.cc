@@ -15,7 +15,11 @@
  *
  */
 #include <QAction>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
 #include <QFileDialog>
+#include <QTemporaryDir>
 #include <QTimer>
 
 #include "ui/logwidget.h"
@@ -108,6 +112,7 @@ void ConnectionManager::locallyCreatedServerFinished(int exit_code,
   kill_locally_created_server_action_->setEnabled(false);
   server_process_->deleteLater();
   server_process_ = nullptr;
+  local_socket_dir_.reset();
 }
 
 void ConnectionManager::connectionDialogAccepted() {
@@ -123,6 +128,11 @@ void ConnectionManager::connectionDialogAccepted() {
 }
 
 void ConnectionManager::startClient() {
+  // A server we started ourselves is known to understand batches.
+  network_client_->setBatchMessages(is_local_server_);
+  network_client_->setCompressMessages(connection_dialog_->compression());
+  network_client_->setLocalServerName(
+      is_local_server_ ? local_socket_path_ : QString());
   network_client_->connect(
       connection_dialog_->serverHost(),
       connection_dialog_->serverPort(),
@@ -170,8 +180,27 @@ void ConnectionManager::startLocalServer() {
   server_process_->setProcessEnvironment(env);
 
   QStringList arguments;
+  arguments << server_file_name;
+#ifndef Q_OS_WIN
+  // Besides TCP, let the server listen on a UNIX socket - the client uses it
+  // to skip the network stack.  The socket goes into a fresh directory only
+  // we can enter, so that other users can't replace it or connect to it.
+  local_socket_dir_.reset(new QTemporaryDir(
+      QDir::temp().filePath("veles-server-XXXXXX")));
+  if (local_socket_dir_->isValid() && QFile::setPermissions(
+      local_socket_dir_->path(),
+      QFile::ReadOwner | QFile::WriteOwner | QFile::ExeOwner)) {
+    local_socket_path_ = QDir(local_socket_dir_->path())
+        .filePath("server.sock");
+    arguments << "--unix-socket" << local_socket_path_;
+  } else {
+    local_socket_dir_.reset();
+    local_socket_path_.clear();
+  }
+#else
+  local_socket_path_.clear();
+#endif
   arguments
-      << server_file_name
       << QString("%1:%2").arg(connection_dialog_->serverHost())
       .arg(connection_dialog_->serverPort())
       << connection_dialog_->authenticationKey()
@@ -86,8 +86,8 @@ void CreateChunkDialog::accept() {
 
 void CreateChunkDialog::updateBinDataSize() {
   ui->beginSpinBox->setMaximum(
-      static_cast<int>(chunksModel_->binData().size()));
-  ui->endSpinBox->setMaximum(static_cast<int>(chunksModel_->binData().size()));
+      static_cast<int>(chunksModel_->binDataSize()));
+  ui->endSpinBox->setMaximum(static_cast<int>(chunksModel_->binDataSize()));
 }
 
 void CreateChunkDialog::setRange(uint64_t begin, uint64_t end) {
@@ -42,7 +42,8 @@ FileBlobItem::FileBlobItem(QString name, QString value, QString comment,
       comment_(comment),
       value_(value),
       start_(start),
-      end_(end) {}
+      end_(end),
+      childrenIndexValid_(false) {}
 
 void FileBlobItem::insertingChildrenHandle(FileBlobItem *item, bool before,
                                            int count) {
@@ -64,8 +65,12 @@ bool FileBlobItem::sortChildren() {
 }
 
 void FileBlobItem::dataUpdatedHandle(FileBlobItem *item) {
+  if (item->parent() == this) {
+    childrenIndexValid_ = false;
+  }
   emit dataUpdated(item);
   if (sortChildren()) {
+    childrenIndexValid_ = false;
     emit removingChildren(this, true);
     auto childrenCopy = children_;
     children_.clear();
@@ -84,6 +89,7 @@ void FileBlobItem::addChildren(const QList<FileBlobItem *> &children) {
 
   emit insertingChildren(this, true, children.size());
 
+  childrenIndexValid_ = false;
   for (auto &child : children) {
     children_.append(child);
     connect(child, SIGNAL(insertingChildren(FileBlobItem *, bool, int)), this,
@@ -108,6 +114,24 @@ int FileBlobItem::childIndex(FileBlobItem *child) {
   return children_.indexOf(child);
 }
 
+int FileBlobItem::childIndexAt(uint64_t pos) {
+  // Subclasses load their children lazily, let them know they're needed.
+  int count = childrenCount();
+  if (!childrenIndexValid_) {
+    childrenIndex_.clear();
+    for (int i = 0; i < count; i++) {
+      uint64_t start, end;
+      if (child(i)->range(&start, &end)) {
+        childrenIndex_.add(start, end, i);
+      }
+    }
+    childrenIndex_.build();
+    childrenIndexValid_ = true;
+  }
+  const int *res = childrenIndex_.find(pos);
+  return res ? *res : -1;
+}
+
 QString FileBlobItem::comment() { return comment_; }
 
 QString FileBlobItem::value() { return value_; }
@@ -144,6 +168,7 @@ void FileBlobItem::removeOldChildren() {
 
   qDeleteAll(children_);
   children_.clear();
+  childrenIndexValid_ = false;
 
   if (hasChilds) {
     emit removingChildren(this, false);
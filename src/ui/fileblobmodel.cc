@@ -14,6 +14,8 @@
  * limitations under the License.
  *
  */
+#include <algorithm>
+
 #include <QColor>
 #include <QFont>
 #include <QSize>
@@ -97,8 +99,9 @@ FileBlobModel::FileBlobModel(dbif::ObjectHandle fileBlob,
                              const QStringList& path, QObject* parent)
     : QAbstractItemModel(parent),
       fileBlob_(fileBlob),
-      bytesPromise_(nullptr),
+      pages_(nullptr),
       bytesCount_(0),
+      bytesWidth_(8),
       path_(path) {
   item_ = new RootFileBlobItem(fileBlob, this);
 
@@ -132,27 +135,54 @@ FileBlobModel::FileBlobModel(dbif::ObjectHandle fileBlob,
           SLOT(gotDescriptionResponse(veles::dbif::PInfoReply)));
 }
 
-void FileBlobModel::gotBytesResponse(veles::dbif::PInfoReply reply) {
-  if (auto bytesReply =
-          reply.dynamicCast<dbif::BlobDataRequest::ReplyType>()) {
-    binData_ = bytesReply->data;
-    emit newBinData();
-  }
+void FileBlobModel::gotPage(qint64 start, qint64 end) {
+  emit binDataLoaded(start, end);
+}
+
+void FileBlobModel::pageChanged(qint64 start, qint64 end) {
+  emit binDataLoaded(start, end);
 }
 
 void FileBlobModel::gotDescriptionResponse(veles::dbif::PInfoReply reply) {
   if (auto description = reply.dynamicCast<dbif::BlobDescriptionReply>()) {
-    if (bytesCount_ != description->size) {
+    unsigned width = static_cast<unsigned>(description->width);
+    if (pages_ == nullptr || bytesCount_ != description->size ||
+        bytesWidth_ != width) {
       bytesCount_ = description->size;
-      delete bytesPromise_;
-      bytesPromise_ =
-          fileBlob_->asyncSubInfo<dbif::BlobDataRequest>(this, 0, bytesCount_);
-      connect(bytesPromise_, SIGNAL(gotInfo(veles::dbif::PInfoReply)), this,
-              SLOT(gotBytesResponse(veles::dbif::PInfoReply)));
+      bytesWidth_ = width;
+      // Pages are fetched once something asks for them, so that even
+      // huge blobs show up right away.
+      delete pages_;
+      pages_ = new dbif::BlobPageCache(fileBlob_, bytesCount_, bytesWidth_,
+                                       dbif::BlobPageCache::DEFAULT_BUDGET,
+                                       this);
+      connect(pages_, &dbif::BlobPageCache::pageLoaded,
+              this, &FileBlobModel::gotPage);
+      connect(pages_, &dbif::BlobPageCache::pageChanged,
+              this, &FileBlobModel::pageChanged);
+      emit newBinData();
     }
   }
 }
 
+dbif::BlobRangeReader *FileBlobModel::readBinData(uint64_t start,
+                                                  uint64_t end,
+                                                  QObject *parent) {
+  end = std::min(end, bytesCount_);
+  return new dbif::BlobRangeReader(fileBlob_, start, std::max(start, end),
+                                   parent);
+}
+
+void FileBlobModel::fetchBinData(uint64_t start, uint64_t end) {
+  if (pages_ != nullptr) {
+    pages_->request(start, end);
+  }
+}
+
+bool FileBlobModel::binDataElement(uint64_t pos, uint64_t *value) const {
+  return pages_ != nullptr && pages_->element(pos, value);
+}
+
 QVariant FileBlobModel::headerData(int section, Qt::Orientation orientation,
                                    int role) const {
   if (orientation != Qt::Orientation::Horizontal) {
@@ -300,16 +330,11 @@ QModelIndex FileBlobModel::indexFromPos(uint64_t pos,
     return QModelIndex();
   }
 
-  for (int childIndex = 0; childIndex < loader->childrenCount(); childIndex++) {
-    auto loaderChild = loader->child(childIndex);
-    uint64_t begin, end;
-    loaderChild->range(&begin, &end);
-    if (pos >= begin && pos < end) {
-      return indexFromItem(loaderChild);
-    }
+  int childIndex = loader->childIndexAt(pos);
+  if (childIndex < 0) {
+    return QModelIndex();
   }
-
-  return QModelIndex();
+  return indexFromItem(loader->child(childIndex));
 }
 
 bool FileBlobModel::setData(const QModelIndex& index, const QVariant& value,
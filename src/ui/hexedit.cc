@@ -41,8 +41,8 @@ void HexEdit::recalculateValues() {
   charHeight_ = fontMetrics().height();
 
   verticalByteBorderMargin_ = charHeight_ / 5;
-  dataBytesCount_ = dataModel_->binData().size();
-  byteCharsCount_ = (dataModel_->binData().width() + 3) / 4;
+  dataBytesCount_ = dataModel_->binDataSize();
+  byteCharsCount_ = (dataModel_->binDataWidth() + 3) / 4;
 
   addressBytes_ = 4;
   if (dataBytesCount_ + startOffset_ >= 0x100000000LL) {
@@ -110,6 +110,8 @@ HexEdit::HexEdit(FileBlobModel *dataModel, QItemSelectionModel *selectionModel,
       this, &HexEdit::newBinData);
   connect(dataModel_, &FileBlobModel::dataChanged,
       this, &HexEdit::dataChanged);
+  connect(dataModel_, &FileBlobModel::binDataLoaded,
+      this, &HexEdit::dataChanged);
 
   if (chunkSelectionModel_) {
     connect(chunkSelectionModel_, &QItemSelectionModel::currentChanged,
@@ -326,8 +328,8 @@ HexEdit::WindowArea HexEdit::pointToWindowArea(QPoint pos) {
   return WindowArea::OUTSIDE;
 }
 
-qint64 HexEdit::byteValue(qint64 pos) {
-  return dataModel_->binData()[pos].element64();
+bool HexEdit::byteValue(qint64 pos, uint64_t *value) {
+  return dataModel_->binDataElement(pos, value);
 }
 
 qint64 HexEdit::selectionStart() {
@@ -347,7 +349,11 @@ qint64 HexEdit::selectionEnd() {
 qint64 HexEdit::selectionSize() { return qAbs(selection_size_); }
 
 QString HexEdit::hexRepresentationFromBytePos(qint64 pos) {
-  return QString::number(byteValue(pos), 16)
+  uint64_t x;
+  if (!byteValue(pos, &x)) {
+    return QString(static_cast<int>(byteCharsCount_), QChar('?'));
+  }
+  return QString::number(x, 16)
       .rightJustified(byteCharsCount_, '0');
 }
 
@@ -357,7 +363,10 @@ QString HexEdit::addressAsText(qint64 pos) {
 }
 
 QString HexEdit::asciiRepresentationFromBytePos(qint64 pos) {
-  auto x = byteValue(pos);
+  uint64_t x;
+  if (!byteValue(pos, &x)) {
+    return " ";
+  }
   if (x >= 0x20 && x < 0x7f) {
     return QChar::fromLatin1(x);
   }
@@ -365,7 +374,10 @@ QString HexEdit::asciiRepresentationFromBytePos(qint64 pos) {
 }
 
 QColor HexEdit::byteTextColorFromPos(qint64 pos) {
-  auto x = byteValue(pos);
+  uint64_t x;
+  if (!byteValue(pos, &x)) {
+    return viewport()->palette().color(QPalette::Shadow);
+  }
   // TODO: better support for non 8 bit bytes
   return util::settings::theme::byteColor(x & 0xff);
 }
@@ -499,6 +511,12 @@ void HexEdit::paintEvent(QPaintEvent *event) {
 
   painter.setPen(old_pen);
 
+  // Only the visible part of the blob is fetched - bytes which haven't
+  // arrived yet are drawn as placeholders until binDataLoaded().
+  dataModel_->fetchBinData(startRow_ * bytesPerRow_,
+                           qMin(startRow_ + rowsOnScreen_, rowsCount_) *
+                               bytesPerRow_);
+
   for (auto rowNum = startRow_;
        rowNum < qMin(startRow_ + rowsOnScreen_, rowsCount_); ++rowNum) {
     auto yPos = (rowNum - startRow_ + 1) * charHeight_;
@@ -808,12 +826,21 @@ void HexEdit::copyToClipboard(util::encoders::IEncoder* enc) {
       enc = hexEncoder_.data();
     }
   }
-  auto selectedData =
-      dataModel_->binData().data(selectionStart(), selectionEnd());
-  QClipboard *clipboard = QApplication::clipboard();
+  // The clipboard is filled once the whole selection arrives.
+  auto selectedData = QSharedPointer<QByteArray>::create();
+  auto reader = dataModel_->readBinData(selectionStart(), selectionEnd(),
+                                        this);
+  connect(reader, &dbif::BlobRangeReader::gotData, this,
+          [selectedData](qint64, const data::BinData &piece) {
+    selectedData->append(reinterpret_cast<const char *>(piece.rawData()),
+                         static_cast<int>(piece.octets()));
+  });
+  // The encoders live as long as we do.
   // TODO: convert encoders to use BinData
-  clipboard->setText(enc->encode(QByteArray(
-      (const char *)selectedData.rawData(), (int)selectedData.octets())));
+  connect(reader, &dbif::BlobRangeReader::finished, this,
+          [selectedData, enc]() {
+    QApplication::clipboard()->setText(enc->encode(*selectedData));
+  });
 }
 
 void HexEdit::setSelectedChunk(QModelIndex newSelectedChunk) {
@@ -944,18 +971,34 @@ void HexEdit::saveSelectionToFile(QString path) {
     size = dataBytesCount_ - byteOffset;
   }
 
-  auto dataToSave = dataModel_->binData().data(byteOffset, byteOffset + size);
-
-  QFile file(path);
-  if (!file.open(QIODevice::WriteOnly)) {
+  auto file = new QFile(path, this);
+  if (!file->open(QIODevice::WriteOnly)) {
     QMessageBox::information(this, tr("Unable to open file"),
-                             file.errorString());
+                             file->errorString());
+    delete file;
     return;
   }
 
-  QDataStream stream(&file);
-  stream.writeRawData((const char *)dataToSave.rawData(),
-                      static_cast<int>(dataToSave.octets()));
+  // Written piece by piece as the data arrives.
+  auto reader = dataModel_->readBinData(byteOffset, byteOffset + size, file);
+  auto fail = [this, file, reader](const QString &message) {
+    reader->disconnect(file);
+    file->deleteLater();
+    QMessageBox::information(this, tr("Unable to save file"), message);
+  };
+  connect(reader, &dbif::BlobRangeReader::gotData, file,
+          [file, fail](qint64, const data::BinData &piece) {
+    qint64 octets = static_cast<qint64>(piece.octets());
+    if (file->write(reinterpret_cast<const char *>(piece.rawData()),
+                    octets) != octets) {
+      fail(file->errorString());
+    }
+  });
+  connect(reader, &dbif::BlobRangeReader::failed, file,
+          [fail](dbif::PError) {
+    fail(tr("Cannot read the data to save."));
+  });
+  connect(reader, &dbif::BlobRangeReader::finished, file, &QObject::deleteLater);
 }
 
 void HexEdit::setParserIds(QStringList ids) {
@@ -28,6 +28,7 @@
 #include <QVBoxLayout>
 #include <QWidgetAction>
 
+#include "dbif/blobcache.h"
 #include "dbif/info.h"
 #include "dbif/types.h"
 #include "dbif/universe.h"
@@ -151,7 +152,7 @@ void HexEditWidget::createActions() {
         util::getColoredIcon(":/images/trigram_icon.png", icon_color),
         Qt::WidgetWithChildrenShortcut);
   visualization_act_->setToolTip(tr("Visualization"));
-  visualization_act_->setEnabled(data_model_->binData().size() > 0);
+  visualization_act_->setEnabled(data_model_->binDataSize() > 0);
   connect(visualization_act_, SIGNAL(triggered()), this,
           SLOT(showVisualization()));
 
@@ -277,22 +278,46 @@ void HexEditWidget::setupDataModelHandlers() {
 bool HexEditWidget::saveFile(const QString &file_name) {
   QString tmp_file_name = file_name + ".~tmp";
 
-  QFile file(tmp_file_name);
-  file.open(QIODevice::WriteOnly);
-  bool ok = file.write(QByteArray((const char *)data_model_->binData().rawData(),
-                                  static_cast<int>(data_model_->binData().size()))) != -1;
-  if (QFile::exists(file_name)) ok = QFile::remove(file_name);
-  if (ok) {
-    ok = file.copy(file_name);
-    if (ok) ok = QFile::remove(tmp_file_name);
-  }
-  file.close();
-
-  if (!ok) {
+  auto file = new QFile(tmp_file_name, this);
+  if (!file->open(QIODevice::WriteOnly)) {
+    delete file;
     QMessageBox::warning(this, tr("HexEdit"),
                          tr("Cannot write file %1.").arg(file_name));
     return false;
   }
+
+  // The blob is written out piece by piece as it arrives, and the file is
+  // only put in place once all of it is there.
+  auto reader = data_model_->readBinData(0, data_model_->binDataSize(), file);
+  auto fail = [this, file, reader, file_name]() {
+    reader->disconnect(file);
+    file->remove();
+    file->deleteLater();
+    QMessageBox::warning(this, tr("HexEdit"),
+                         tr("Cannot write file %1.").arg(file_name));
+  };
+  connect(reader, &dbif::BlobRangeReader::gotData, file,
+          [file, fail](qint64, const data::BinData &piece) {
+    qint64 octets = static_cast<qint64>(piece.octets());
+    if (file->write(reinterpret_cast<const char *>(piece.rawData()),
+                    octets) != octets) {
+      fail();
+    }
+  });
+  connect(reader, &dbif::BlobRangeReader::failed, file,
+          [fail](dbif::PError) { fail(); });
+  connect(reader, &dbif::BlobRangeReader::finished, file,
+          [file, fail, file_name]() {
+    file->close();
+    bool ok = true;
+    if (QFile::exists(file_name)) ok = QFile::remove(file_name);
+    if (ok) ok = file->rename(file_name);
+    if (!ok) {
+      fail();
+      return;
+    }
+    file->deleteLater();
+  });
   return true;
 }
 
@@ -326,8 +351,17 @@ bool HexEditWidget::saveAs() {
 void HexEditWidget::showVisualization() {
   auto *panel = new visualization::VisualizationPanel(main_window_,
       data_model_);
-  panel->setData(QByteArray((const char *)data_model_->binData().rawData(),
-    static_cast<int>(data_model_->binData().size())));
+  // The panel shows up empty and gets its data once all of it arrives.
+  auto contents = QSharedPointer<QByteArray>::create();
+  auto reader = data_model_->readBinData(0, data_model_->binDataSize(), panel);
+  connect(reader, &dbif::BlobRangeReader::gotData, panel,
+          [contents](qint64, const data::BinData &piece) {
+    contents->append(reinterpret_cast<const char *>(piece.rawData()),
+                     static_cast<int>(piece.octets()));
+  });
+  connect(reader, &dbif::BlobRangeReader::finished, panel, [panel, contents]() {
+    panel->setData(*contents);
+  });
   panel->setWindowTitle(cur_file_path_);
   panel->setAttribute(Qt::WA_DeleteOnClose);
 
@@ -351,7 +385,7 @@ void HexEditWidget::showHexEditor() {
 }
 
 void HexEditWidget::newBinData() {
-  visualization_act_->setEnabled(data_model_->binData().size() > 0);
+  visualization_act_->setEnabled(data_model_->binDataSize() > 0);
 }
 
 void HexEditWidget::enableFindNext(bool enable) {
@@ -14,6 +14,9 @@
  * limitations under the License.
  *
  */
+#include <algorithm>
+#include <thread>
+
 #include <QApplication>
 #include <QSurfaceFormat>
 #include <QTranslator>
@@ -54,6 +57,8 @@ int main(int argc, char *argv[]) {
   app.installTranslator(&translator);
 
   veles::util::threadpool::createTopic("visualization", 3);
+  veles::util::threadpool::createTopic(
+      "parser", std::max(2u, std::thread::hardware_concurrency()));
 
   qRegisterMetaType<veles::visualization::VisualizationWidget::AdditionalResampleDataPtr>("AdditionalResampleDataPtr");
   qRegisterMetaType<veles::client::NetworkClient::ConnectionStatus>(
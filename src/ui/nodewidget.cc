@@ -27,6 +27,7 @@
 #include <QTreeView>
 #include <QVBoxLayout>
 
+#include "dbif/blobcache.h"
 #include "dbif/info.h"
 #include "dbif/types.h"
 #include "dbif/universe.h"
@@ -82,7 +83,7 @@ NodeWidget::NodeWidget(MainWindowWithDetachableDockWidgets *main_window,
   minimap_dock_->setWindowTitle("Minimap");
   minimap_ = new visualization::MinimapPanel(this);
 
-  if(data_model_->binData().size() > 0) {
+  if(data_model_->binDataSize() > 0) {
     loadBinDataToMinimap();
   } else {
     sampler_data_ = QByteArray("");
@@ -120,13 +121,24 @@ NodeWidget::~NodeWidget() {
 }
 
 void NodeWidget::loadBinDataToMinimap() {
-  delete sampler_;
-
-  sampler_data_ = QByteArray((const char *)data_model_->binData().rawData(),
-          static_cast<int>(data_model_->binData().octets()));
-  sampler_ = new util::UniformSampler(sampler_data_);
-  sampler_->setSampleSize(4096 * 1024);
-  minimap_->setSampler(sampler_);
+  // Only the latest data is of interest.
+  delete minimap_reader_;
+  auto contents = QSharedPointer<QByteArray>::create();
+  minimap_reader_ = data_model_->readBinData(0, data_model_->binDataSize(),
+                                             this);
+  connect(minimap_reader_, &dbif::BlobRangeReader::gotData, this,
+          [contents](qint64, const data::BinData &piece) {
+    contents->append(reinterpret_cast<const char *>(piece.rawData()),
+                     static_cast<int>(piece.octets()));
+  });
+  connect(minimap_reader_, &dbif::BlobRangeReader::finished, this,
+          [this, contents]() {
+    delete sampler_;
+    sampler_data_ = *contents;
+    sampler_ = new util::UniformSampler(sampler_data_);
+    sampler_->setSampleSize(4096 * 1024);
+    minimap_->setSampler(sampler_);
+  });
 }
 
 }  // namespace ui
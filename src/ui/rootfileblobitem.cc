@@ -16,6 +16,7 @@
  */
 #include <QtAlgorithms>
 
+#include "dbif/info.h"
 #include "dbif/universe.h"
 #include "ui/rootfileblobitem.h"
 #include "ui/subchunkfileblobitem.h"
@@ -26,15 +27,22 @@ namespace ui {
 RootFileBlobItem::RootFileBlobItem(dbif::ObjectHandle obj, QObject *parent)
     : FileBlobItem("", "", "", 0, 0, parent) {
   dataObj_ = obj;
-  auto childrenPromise = dataObj_->asyncSubInfo<dbif::ChildrenRequest>(this);
+  auto childrenPromise =
+      dataObj_->asyncSubInfo<dbif::ChildrenRequest>(this, true);
   connect(childrenPromise, SIGNAL(gotInfo(veles::dbif::PInfoReply)), this,
           SLOT(gotChildrenResponse(veles::dbif::PInfoReply)));
 }
 
 void RootFileBlobItem::gotChildrenResponse(veles::dbif::PInfoReply reply) {
-  FileBlobItem::removeOldChildren();
-  auto objects =
-      reply.dynamicCast<dbif::ChildrenRequest::ReplyType>()->objects;
+  std::vector<dbif::ObjectHandle> objects;
+  if (auto added = reply.dynamicCast<dbif::ChildrenAddedReply>()) {
+    // Parsers add chunks one by one, there's no need to rebuild the items
+    // of all the previous ones every time.
+    objects = added->objects;
+  } else {
+    FileBlobItem::removeOldChildren();
+    objects = reply.dynamicCast<dbif::ChildrenRequest::ReplyType>()->objects;
+  }
 
   QList<FileBlobItem *> newChildren;
 
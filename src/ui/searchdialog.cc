@@ -17,6 +17,10 @@
 #include "include/ui/searchdialog.h"
 #include "ui_searchdialog.h"
 
+#include <algorithm>
+
+#include "dbif/blobcache.h"
+
 namespace veles {
 namespace ui {
 
@@ -24,7 +28,11 @@ SearchDialog::SearchDialog(HexEdit *hexEdit, QWidget *parent)
     : QDialog(parent),
       ui(new Ui::SearchDialog),
       _lastFoundPos(-1),
-      _lastFoundSize(0) {
+      _lastFoundSize(0),
+      search_backwards_(false),
+      search_start_(0),
+      search_end_(0),
+      search_window_filled_(0) {
   ui->setupUi(this);
   _hexEdit = hexEdit;
   message_box_not_found_ = new QMessageBox(this);
@@ -41,74 +49,135 @@ SearchDialog::SearchDialog(HexEdit *hexEdit, QWidget *parent)
   message_box_not_valid_hex_string_->setDefaultButton(QMessageBox::Close);
 }
 
-SearchDialog::~SearchDialog() { delete ui; }
+SearchDialog::~SearchDialog() {
+  cancelSearch();
+  delete ui;
+}
 
-qint64 SearchDialog::indexOf(const data::BinData &pattern, qint64 startPos) {
-  // TODO: implement this as BinData method or as separate util
-  const data::BinData &data = _hexEdit->dataModel()->binData();
-  if (startPos == -1) {
-    startPos = 0;
-  }
-  qint64 index = startPos;
-  while (index + pattern.size() <= data.size()) {
-    size_t numberOfMatches = 0;
-    while (numberOfMatches < pattern.size() &&
-           numberOfMatches + index < data.size() &&
-           pattern.element64(numberOfMatches) ==
-               data.element64(index + numberOfMatches)) {
-
-      ++numberOfMatches;
-    }
+namespace {
 
-    if (numberOfMatches == pattern.size()) {
-      return index;
+/** Returns the first (or the last, if backwards is set) position in
+    [from, to) at which pattern occurs in data, or -1.  */
+qint64 findInWindow(const data::BinData &data, const data::BinData &pattern,
+                    uint64_t from, uint64_t to, bool backwards) {
+  auto matches = [&data, &pattern](uint64_t index) {
+    if (index + pattern.size() > data.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < pattern.size(); i++) {
+      if (pattern.element64(i) != data.element64(index + i)) {
+        return false;
+      }
+    }
+    return true;
+  };
+  if (backwards) {
+    for (uint64_t index = to; index > from; index--) {
+      if (matches(index - 1)) {
+        return index - 1;
+      }
+    }
+  } else {
+    for (uint64_t index = from; index < to; index++) {
+      if (matches(index)) {
+        return index;
+      }
     }
-
-    index++;
   }
-
   return -1;
 }
 
-qint64 SearchDialog::lastIndexOf(const data::BinData &pattern,
-                                 qint64 startPos) {
-  // TODO: implement this as BinData method or as separate util
-  const data::BinData &data = _hexEdit->dataModel()->binData();
-  if (startPos == -1) {
-    startPos = data.size();
+}  // namespace
+
+void SearchDialog::startSearch(const data::BinData &pattern, uint64_t start,
+                               uint64_t end, bool backwards,
+                               std::function<void(qint64)> done) {
+  cancelSearch();
+  search_pattern_ = pattern;
+  search_backwards_ = backwards;
+  search_start_ = start;
+  search_end_ = std::min(end, _hexEdit->dataModel()->binDataSize());
+  search_done_ = done;
+  searchStep();
+}
+
+void SearchDialog::searchStep() {
+  if (search_start_ >= search_end_) {
+    finishSearch(-1);
+    return;
   }
-  qint64 index = startPos - 1;
-  while (index > 0) {
-    size_t numberOfMatches = 0;
-    while (numberOfMatches < pattern.size() &&
-           numberOfMatches + index < data.size() &&
-           pattern.element64(numberOfMatches) ==
-               data.element64(index + numberOfMatches)) {
-      ++numberOfMatches;
+  // Candidate positions are checked a window at a time, starting from the
+  // side the search goes from.
+  uint64_t window =
+      std::min(dbif::BlobRangeReader::PIECE_SIZE, search_end_ - search_start_);
+  uint64_t from = search_backwards_ ? search_end_ - window : search_start_;
+  uint64_t to = from + window;
+  // A match starting in the window can reach past its end.
+  uint64_t read_end = to + search_pattern_.size() - 1;
+  search_window_ = data::BinData(_hexEdit->dataModel()->binDataWidth(),
+                                 read_end - from);
+  search_window_filled_ = 0;
+  search_reader_ = _hexEdit->dataModel()->readBinData(from, read_end, this);
+  connect(search_reader_, &dbif::BlobRangeReader::gotData, this,
+          [this, from](qint64 pos, const data::BinData &piece) {
+    uint64_t offset = pos - from;
+    search_window_.setData(offset, offset + piece.size(), piece);
+    search_window_filled_ = offset + piece.size();
+  });
+  connect(search_reader_, &dbif::BlobRangeReader::finished, this,
+          [this, from, to]() {
+    qint64 idx = findInWindow(search_window_.data(0, search_window_filled_),
+                              search_pattern_, 0, to - from,
+                              search_backwards_);
+    if (idx >= 0) {
+      finishSearch(from + idx);
+      return;
     }
-
-    if (numberOfMatches == pattern.size()) {
-      return index;
+    if (search_backwards_) {
+      search_end_ = from;
+    } else {
+      search_start_ = to;
     }
+    searchStep();
+  });
+  connect(search_reader_, &dbif::BlobRangeReader::failed, this,
+          [this](dbif::PError) { finishSearch(-1); });
+}
 
-    index--;
+void SearchDialog::finishSearch(qint64 idx) {
+  search_window_ = data::BinData();
+  auto done = search_done_;
+  search_done_ = nullptr;
+  if (done) {
+    done(idx);
   }
+}
 
-  return -1;
+void SearchDialog::cancelSearch() {
+  if (search_reader_) {
+    search_reader_->disconnect(this);
+    search_reader_->deleteLater();
+  }
+  search_window_ = data::BinData();
+  search_done_ = nullptr;
 }
 
 void SearchDialog::replace(qint64 pos, qint64 len, const data::BinData &data) {
   // TODO: implement this
 }
 
-qint64 SearchDialog::findNext() {
+void SearchDialog::findNext() {
+  findNext(nullptr);
+}
+
+void SearchDialog::findNext(std::function<void(qint64)> done) {
   emit enableFindNext(false);
 
   _findBa =
       getContent(ui->cbFindFormat->currentIndex(), ui->cbFind->currentText());
 
   if (_findBa.size() == 0) {
-    return -1;
+    return;
   }
 
   bool backwards = ui->cbBackwards->isChecked();
@@ -119,13 +188,24 @@ qint64 SearchDialog::findNext() {
     startSearchPos += _lastFoundSize;
   }
 
-  qint64 idx = -1;
-  if (backwards) {
-    idx = lastIndexOf(_findBa, startSearchPos);
-  } else {
-    idx = indexOf(_findBa, startSearchPos);
+  uint64_t size = _hexEdit->dataModel()->binDataSize();
+  uint64_t start = 0;
+  uint64_t end = size;
+  if (backwards && startSearchPos != -1) {
+    end = startSearchPos;
+  } else if (!backwards && startSearchPos != -1) {
+    start = startSearchPos;
   }
 
+  startSearch(_findBa, start, end, backwards, [this, done](qint64 idx) {
+    foundAt(idx);
+    if (done) {
+      done(idx);
+    }
+  });
+}
+
+void SearchDialog::foundAt(qint64 idx) {
   if (idx >= 0) {
     _hexEdit->setSelection(idx, _findBa.size(), true);
     _lastFoundPos = idx;
@@ -137,8 +217,6 @@ qint64 SearchDialog::findNext() {
     _hexEdit->setSelection(0, 0, false);
     message_box_not_found_->show();
   }
-
-  return idx;
 }
 
 void SearchDialog::showEvent(QShowEvent* event) {
@@ -150,50 +228,66 @@ void SearchDialog::on_pbFind_clicked() { findNext(); }
 void SearchDialog::on_pbReplace_clicked() {
   _findBa =
       getContent(ui->cbFindFormat->currentIndex(), ui->cbFind->currentText());
+  if (_findBa.size() == 0) {
+    return;
+  }
 
-
-  if (indexOf(_findBa, _lastFoundPos) == _lastFoundPos) {
-    auto replaceData = getContent(ui->cbReplaceFormat->currentIndex(),
-                                      ui->cbReplace->currentText());
-    replaceOccurrence(_lastFoundPos, replaceData);
+  if (_lastFoundPos < 0) {
+    findNext();
+    return;
   }
 
-  findNext();
+  // Only replace the last match if it's still there.
+  startSearch(_findBa, _lastFoundPos, _lastFoundPos + 1, false,
+              [this](qint64 idx) {
+    if (idx >= 0) {
+      auto replaceData = getContent(ui->cbReplaceFormat->currentIndex(),
+                                    ui->cbReplace->currentText());
+      replaceOccurrence(_lastFoundPos, replaceData);
+    }
+    findNext();
+  });
 }
 
 void SearchDialog::on_pbReplaceAll_clicked() {
   _lastFoundPos = -1;
-  int replaceCounter = 0;
-  int idx = 0;
-  int goOn = QMessageBox::Yes;
-  while ((idx >= 0) && (goOn == QMessageBox::Yes)) {
-    idx = findNext();
+  replaceAllFrom(0);
+}
+
+void SearchDialog::replaceAllFrom(int replaceCounter) {
+  // Matches are found one at a time, each search picking up after the
+  // previous one.
+  findNext([this, replaceCounter](qint64 idx) {
+    int counter = replaceCounter;
     if (idx >= 0) {
       data::BinData replaceBa = getContent(ui->cbReplaceFormat->currentIndex(),
-                                        ui->cbReplace->currentText());
+                                           ui->cbReplace->currentText());
       int result = replaceOccurrence(idx, replaceBa);
 
-      if (result == QMessageBox::Yes) replaceCounter += 1;
+      if (result == QMessageBox::Yes) counter += 1;
 
-      if (result == QMessageBox::Cancel) goOn = result;
+      if (result != QMessageBox::Cancel) {
+        replaceAllFrom(counter);
+        return;
+      }
     }
-  }
 
-  if (replaceCounter > 0)
-    QMessageBox::information(
-        this, tr("HexEdit"),
-        QString(tr("%1 occurrences replaced.")).arg(replaceCounter));
+    if (counter > 0)
+      QMessageBox::information(
+          this, tr("HexEdit"),
+          QString(tr("%1 occurrences replaced.")).arg(counter));
+  });
 }
 
 bool SearchDialog::isHexStr(QString hexStr) {
-  auto hexCharsPerByte = _hexEdit->dataModel()->binData().width() / 4;
+  auto hexCharsPerByte = _hexEdit->dataModel()->binDataWidth() / 4;
   QRegExp hexMatcher(QString("^(([0-9A-F]{%1})|\\s)*$").arg(hexCharsPerByte), Qt::CaseInsensitive);
   return hexMatcher.exactMatch(hexStr);
 }
 
 data::BinData SearchDialog::getContent(int comboIndex, const QString &input) {
   std::vector<uint64_t> findBa;
-  int hexCharsPerByte = _hexEdit->dataModel()->binData().width() / 4;
+  int hexCharsPerByte = _hexEdit->dataModel()->binDataWidth() / 4;
   switch (comboIndex) {
     case 0:  // hex
       if (!isHexStr(input)) {
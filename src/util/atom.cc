@@ -0,0 +1,114 @@
+/*
+ * Copyright 2017 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include <atomic>
+
+#include <QReadLocker>
+#include <QReadWriteLock>
+#include <QWriteLocker>
+
+#include "util/atom.h"
+
+namespace veles {
+namespace util {
+
+namespace {
+
+/** Strings are kept in pages which never move once allocated, so that
+    toString() can read them without taking the lock.  Page n holds
+    FIRST_PAGE_SIZE << n strings - 22 pages cover all 32-bit ids.  */
+const unsigned FIRST_PAGE_BITS = 10;
+const uint64_t FIRST_PAGE_SIZE = 1 << FIRST_PAGE_BITS;
+const unsigned NUM_PAGES = 32 - FIRST_PAGE_BITS;
+
+class AtomTable {
+  QReadWriteLock lock_;
+  QHash<QString, uint32_t> ids_;
+  uint32_t next_id_;
+  std::atomic<QString *> pages_[NUM_PAGES];
+
+  static void locate(uint32_t id, unsigned *page, uint64_t *offset) {
+    uint64_t pos = id + FIRST_PAGE_SIZE;
+    unsigned bits = FIRST_PAGE_BITS;
+    while (pos >> (bits + 1)) {
+      bits++;
+    }
+    *page = bits - FIRST_PAGE_BITS;
+    *offset = pos - (uint64_t(1) << bits);
+  }
+
+ public:
+  AtomTable() : next_id_(1) {
+    for (auto &page : pages_) {
+      page.store(nullptr, std::memory_order_relaxed);
+    }
+    // Id 0 is the (null) empty string, never looked up through ids_.
+    pages_[0].store(new QString[FIRST_PAGE_SIZE], std::memory_order_release);
+  }
+
+  uint32_t intern(const QString &str) {
+    {
+      QReadLocker lock(&lock_);
+      auto iter = ids_.constFind(str);
+      if (iter != ids_.constEnd()) {
+        return iter.value();
+      }
+    }
+    QWriteLocker lock(&lock_);
+    auto iter = ids_.constFind(str);
+    if (iter != ids_.constEnd()) {
+      return iter.value();
+    }
+    Q_ASSERT(next_id_ < 0xffffffff - FIRST_PAGE_SIZE);
+    uint32_t id = next_id_++;
+    unsigned page;
+    uint64_t offset;
+    locate(id, &page, &offset);
+    QString *strings = pages_[page].load(std::memory_order_relaxed);
+    if (strings == nullptr) {
+      strings = new QString[FIRST_PAGE_SIZE << page];
+      pages_[page].store(strings, std::memory_order_release);
+    }
+    strings[offset] = str;
+    ids_.insert(str, id);
+    return id;
+  }
+
+  QString string(uint32_t id) const {
+    unsigned page;
+    uint64_t offset;
+    locate(id, &page, &offset);
+    // Whoever handed us the id got it after the string was stored.
+    return pages_[page].load(std::memory_order_acquire)[offset];
+  }
+};
+
+AtomTable *table() {
+  // Never destroyed - atoms may be used during static destruction.
+  static AtomTable *table = new AtomTable;
+  return table;
+}
+
+}  // namespace
+
+Atom::Atom(const QString &str) : id_(str.isEmpty() ? 0 : table()->intern(str)) {}
+
+QString Atom::toString() const {
+  return table()->string(id_);
+}
+
+}  // namespace util
+}  // namespace veles
@@ -28,6 +28,7 @@ namespace settings {
 namespace connection {
 
 bool default_run_server = true;
+bool default_compression = false;
 QString localhost("127.0.0.1");
 QString default_database_file("veles.vdb");
 int default_server_port = 3135;
@@ -235,6 +236,19 @@ void setServerScript(QString server_script) {
   setProfileSettings("connection.server_script", server_script);
 }
 
+bool compressionDefault() {
+  return default_compression;
+}
+
+bool compression() {
+  return profileSettings("connection.compression",
+      compressionDefault()).toBool();
+}
+
+void setCompression(bool compression) {
+  setProfileSettings("connection.compression", compression);
+}
+
 }  // namespace connection
 }  // namespace settings
 }  // namespace util
@@ -0,0 +1,178 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include <memory>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QObject>
+#include <QSharedPointer>
+
+#include "gtest/gtest.h"
+
+#include "client/dbif.h"
+#include "client/networkclient.h"
+#include "data/nodeid.h"
+#include "dbif/info.h"
+#include "dbif/promise.h"
+#include "models.h"
+
+namespace veles {
+namespace client {
+
+namespace {
+
+/** Same as NCWrapper::NODE_CACHE_SIZE.  */
+const size_t CACHE_SIZE = 4096;
+
+/** Records sent messages instead of talking to a server.  */
+class FakeNetworkClient : public NetworkClient {
+ public:
+  void sendMessage(msg_ptr msg) override {
+    sent.push_back(msg);
+  }
+
+  std::vector<msg_ptr> sent;
+};
+
+class NCWrapperTest : public ::testing::Test {
+ protected:
+  FakeNetworkClient nc;
+  NCWrapper wrapper;
+
+  NCWrapperTest() : wrapper(&nc) {
+    nc.setConnectionStatus(NetworkClient::ConnectionStatus::Connected);
+  }
+
+  /** Requests the description of a node, counting the replies.  */
+  void getDescription(const data::NodeID& id, int* replies) {
+    auto promise = wrapper.getInfo(
+        QSharedPointer<dbif::DescriptionRequest>::create(), id);
+    QObject::connect(promise, &dbif::InfoPromise::gotInfo,
+        [replies](dbif::PInfoReply) { (*replies)++; });
+  }
+
+  /** Returns the qid of the last MsgGet sent for the node, or 0.  */
+  uint64_t getQid(const data::NodeID& id) {
+    for (auto iter = nc.sent.rbegin(); iter != nc.sent.rend(); ++iter) {
+      auto msg = std::dynamic_pointer_cast<proto::MsgGet>(*iter);
+      if (msg && *msg->id == id) {
+        return msg->qid;
+      }
+    }
+    return 0;
+  }
+
+  void replyGet(uint64_t qid, const data::NodeID& id) {
+    auto node = std::make_shared<proto::Node>(
+        std::make_shared<data::NodeID>(id),
+        data::NodeID::getRootNodeId(),
+        std::make_pair(false, INT64_C(0)),
+        std::make_pair(false, INT64_C(0)),
+        std::make_shared<std::unordered_set<std::shared_ptr<std::string>>>(),
+        std::make_shared<std::unordered_map<std::string,
+            std::shared_ptr<messages::MsgpackObject>>>(),
+        std::make_shared<std::unordered_set<std::shared_ptr<std::string>>>(),
+        std::make_shared<std::unordered_map<std::string, uint64_t>>(),
+        std::make_shared<std::unordered_map<std::string,
+            proto::TriggerState>>());
+    emit nc.messageReceived(std::make_shared<proto::MsgGetReply>(qid, node));
+  }
+
+  std::vector<uint64_t> cancelledQids() {
+    std::vector<uint64_t> res;
+    for (const auto& msg : nc.sent) {
+      auto cancel =
+          std::dynamic_pointer_cast<proto::MsgCancelSubscription>(msg);
+      if (cancel) {
+        res.push_back(cancel->qid);
+      }
+    }
+    return res;
+  }
+};
+
+}  // namespace
+
+TEST_F(NCWrapperTest, AnswersRepeatedRequestsFromCache) {
+  data::NodeID id;
+  int first = 0;
+  getDescription(id, &first);
+  ASSERT_EQ(nc.sent.size(), 1u);
+  uint64_t qid = getQid(id);
+  ASSERT_NE(qid, 0u);
+  replyGet(qid, id);
+  EXPECT_EQ(first, 1);
+
+  int second = 0;
+  getDescription(id, &second);
+  EXPECT_EQ(nc.sent.size(), 1u);
+  // The reply is sent once the caller had a chance to connect.
+  EXPECT_EQ(second, 0);
+  QCoreApplication::processEvents();
+  EXPECT_EQ(second, 1);
+
+  // One-shot requests don't see later updates.
+  replyGet(qid, id);
+  QCoreApplication::processEvents();
+  EXPECT_EQ(first, 1);
+  EXPECT_EQ(second, 1);
+}
+
+TEST_F(NCWrapperTest, KeepsCachedEntriesUntilAnswered) {
+  data::NodeID id;
+  int first = 0;
+  getDescription(id, &first);
+  uint64_t qid = getQid(id);
+  replyGet(qid, id);
+
+  int cached = 0;
+  getDescription(id, &cached);
+  // Enough new nodes to evict the entry if nothing was waiting for it.
+  int others = 0;
+  for (size_t i = 0; i < CACHE_SIZE + 1; i++) {
+    getDescription(data::NodeID(), &others);
+  }
+  EXPECT_TRUE(cancelledQids().empty());
+
+  QCoreApplication::processEvents();
+  EXPECT_EQ(cached, 1);
+  EXPECT_EQ(others, 0);
+}
+
+TEST_F(NCWrapperTest, CancelsSubscriptionsOfEvictedEntries) {
+  std::vector<data::NodeID> ids(CACHE_SIZE + 1);
+  std::vector<uint64_t> qids;
+  int replies = 0;
+  for (const auto& id : ids) {
+    getDescription(id, &replies);
+    qids.push_back(getQid(id));
+    replyGet(qids.back(), id);
+  }
+  EXPECT_EQ(replies, static_cast<int>(ids.size()));
+  EXPECT_TRUE(cancelledQids().empty());
+
+  // The least recently used entry goes once the cache is over the limit.
+  getDescription(data::NodeID(), &replies);
+  EXPECT_EQ(cancelledQids(), std::vector<uint64_t>{qids[0]});
+
+  // An evicted node is fetched again.
+  getDescription(ids[0], &replies);
+  EXPECT_NE(getQid(ids[0]), qids[0]);
+}
+
+}  // namespace client
+}  // namespace veles
@@ -17,6 +17,8 @@
 #include "gtest/gtest.h"
 #include "data/bindata.h"
 #include <algorithm>
+#include <memory>
+#include <vector>
 
 namespace veles {
 namespace data {
@@ -478,5 +480,36 @@ TEST(BinData, Equal) {
   EXPECT_FALSE(BinData::fromRawData(8, {1}) == BinData::fromRawData(7, {1}));
 }
 
+TEST(BinData, Shared) {
+  auto buf = std::make_shared<std::vector<uint8_t>>(
+      std::initializer_list<uint8_t>{0x12, 0x34, 0x56, 0x78, 0x9a});
+  BinData a = BinData::fromSharedData(8, 4, buf->data() + 1, buf);
+  EXPECT_TRUE(a.isShared());
+  EXPECT_EQ(a.size(), 4u);
+  EXPECT_EQ(a.element64(0), 0x34u);
+  const BinData &ca = a;
+  EXPECT_EQ(ca.rawData(), buf->data() + 1);
+  BinData b = a;
+  EXPECT_TRUE(b.isShared());
+  EXPECT_EQ(static_cast<const BinData &>(b).rawData(), buf->data() + 1);
+  BinData c = a.data(1, 3);
+  EXPECT_TRUE(c.isShared());
+  EXPECT_EQ(static_cast<const BinData &>(c).rawData(), buf->data() + 2);
+  // Single elements end up inline.
+  BinData d = a[2];
+  EXPECT_FALSE(d.isShared());
+  EXPECT_EQ(d.element64(), 0x78u);
+  // Writes detach.
+  b.setElement64(0, 0xff);
+  EXPECT_FALSE(b.isShared());
+  EXPECT_EQ(b.element64(0), 0xffu);
+  EXPECT_EQ(a.element64(0), 0x34u);
+  EXPECT_EQ((*buf)[1], 0x34);
+  EXPECT_EQ(buf.use_count(), 3);
+  a = b;
+  EXPECT_FALSE(a.isShared());
+  EXPECT_TRUE(c == BinData(8, {0x56, 0x78}));
+}
+
 }
 }
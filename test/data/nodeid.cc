@@ -15,6 +15,8 @@
  *
  */
 
+#include <unordered_set>
+
 #include "data/nodeid.h"
 
 #include "gtest/gtest.h"
@@ -68,5 +70,29 @@ TEST(NodeID, TestBoolConv) {
     EXPECT_TRUE(*NodeID::getRootNodeId());
 }
 
+TEST(NodeID, Ordering) {
+  NodeID low("000000000000000000000001");
+  NodeID high("100000000000000000000000");
+  EXPECT_LT(*NodeID::getNilId(), low);
+  EXPECT_LT(low, high);
+  EXPECT_LT(high, *NodeID::getRootNodeId());
+  EXPECT_FALSE(low < low);
+}
+
+TEST(NodeID, Hash) {
+  NodeID id;
+  NodeID copy(id.data());
+  EXPECT_EQ(std::hash<NodeID>()(id), std::hash<NodeID>()(copy));
+  EXPECT_EQ(qHash(id), qHash(copy));
+
+  std::unordered_set<NodeID> ids;
+  for (int i = 0; i < 1000; i++) {
+    ids.insert(NodeID());
+  }
+  EXPECT_EQ(ids.size(), 1000u);
+  ids.insert(copy);
+  EXPECT_EQ(ids.count(id), 1u);
+}
+
 }  // namespace data
 }  // namespace veles
@@ -0,0 +1,221 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include <algorithm>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QThread>
+
+#include "gtest/gtest.h"
+
+#include "data/bindata.h"
+#include "db/db.h"
+#include "dbif/info.h"
+#include "dbif/method.h"
+#include "dbif/promise.h"
+#include "dbif/universe.h"
+
+namespace veles {
+namespace db {
+
+namespace {
+
+data::BinData iota(size_t size, uint64_t first = 0) {
+  data::BinData res(8, size);
+  for (size_t i = 0; i < size; i++) {
+    res.setElement64(i, (first + i) & 0xff);
+  }
+  return res;
+}
+
+/** Follows a blob range the way a delta-aware view would.  */
+class DataFollower {
+  dbif::InfoPromise *promise_;
+  std::vector<dbif::PInfoReply> replies_;
+  size_t seen_;
+
+ public:
+  data::BinData data;
+  int deltas;
+
+  DataFollower(dbif::ObjectHandle blob, uint64_t start, uint64_t end)
+      : seen_(0), deltas(0) {
+    promise_ = blob->asyncSubInfo<dbif::BlobDataRequest>(
+        nullptr, start, end, true);
+    QObject::connect(promise_, &dbif::InfoPromise::gotInfo,
+                     [this] (dbif::PInfoReply reply) {
+      replies_.push_back(reply);
+    });
+    wait(1);
+  }
+  ~DataFollower() { delete promise_; }
+
+  /** Processes events until the given number of new replies came.  */
+  void wait(size_t count) {
+    while (replies_.size() < seen_ + count) {
+      QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+    }
+    for (; seen_ < replies_.size(); seen_++) {
+      auto reply = replies_[seen_];
+      if (auto delta = reply.dynamicCast<dbif::BlobDataDeltaReply>()) {
+        delta->apply(data);
+        deltas++;
+      } else {
+        data = reply.dynamicCast<dbif::BlobDataReply>()->data;
+      }
+    }
+  }
+};
+
+void processEventsFor(int ms) {
+  QElapsedTimer timer;
+  timer.start();
+  while (timer.elapsed() < ms) {
+    QCoreApplication::processEvents();
+    QThread::msleep(1);
+  }
+}
+
+}  // namespace
+
+TEST(DataBlobObject, SendsEachChildOnce) {
+  auto root = create_db();
+  auto blob = root->syncRunMethod<dbif::RootCreateFileBlobFromDataRequest>(
+      iota(100), "test.bin")->object;
+  auto addChunk = [&] (uint64_t start) {
+    blob->syncRunMethod<dbif::ChunkCreateRequest>(
+        "c", "t", dbif::ObjectHandle(), start, start + 1);
+  };
+  // Subscribe while the first chunk hasn't been announced to anybody yet.
+  addChunk(0);
+  auto promise = blob->asyncSubInfo<dbif::ChildrenRequest>(nullptr, true);
+  std::vector<dbif::ObjectHandle> children;
+  int full = 0;
+  QObject::connect(promise, &dbif::InfoPromise::gotInfo,
+                   [&] (dbif::PInfoReply reply) {
+    if (auto added = reply.dynamicCast<dbif::ChildrenAddedReply>()) {
+      children.insert(children.end(), added->objects.begin(),
+                      added->objects.end());
+    } else {
+      full++;
+      children = reply.dynamicCast<dbif::ChildrenReply>()->objects;
+    }
+  });
+  auto starts = [&] () {
+    std::vector<uint64_t> res;
+    for (auto &child : children) {
+      res.push_back(child->syncGetInfo<dbif::DescriptionRequest>()
+          .dynamicCast<dbif::ChunkDescriptionReply>()->start);
+    }
+    std::sort(res.begin(), res.end());
+    return res;
+  };
+  processEventsFor(100);
+  EXPECT_EQ(full, 1);
+  EXPECT_EQ(starts(), std::vector<uint64_t>({0}));
+
+  addChunk(10);
+  addChunk(20);
+  processEventsFor(100);
+  EXPECT_EQ(full, 1);
+  EXPECT_EQ(starts(), std::vector<uint64_t>({0, 10, 20}));
+  delete promise;
+}
+
+TEST(DataBlobObject, SendsDeltasForResizingEdits) {
+  auto root = create_db();
+  auto blob = root->syncRunMethod<dbif::RootCreateFileBlobFromDataRequest>(
+      iota(200), "test.bin")->object;
+  DataFollower view(blob, 50, 150);
+  auto check = [&] () {
+    view.wait(1);
+    EXPECT_EQ(view.data,
+              blob->syncGetInfo<dbif::BlobDataRequest>(50, 150)->data);
+  };
+
+  // In place, inside the view.
+  blob->syncRunMethod<dbif::ChangeDataRequest>(60, 62, iota(2, 100));
+  check();
+  // Insertion before the view shifts it.
+  blob->syncRunMethod<dbif::ChangeDataRequest>(10, 10, iota(5, 100));
+  check();
+  // Insertion inside.
+  blob->syncRunMethod<dbif::ChangeDataRequest>(70, 70, iota(3, 100));
+  check();
+  // Removal across the start of the view changes all of it.
+  blob->syncRunMethod<dbif::ChangeDataRequest>(40, 60, data::BinData(8, 0));
+  check();
+  EXPECT_EQ(view.deltas, 3);
+  // Removal inside, bytes come in from past the end of the view.
+  blob->syncRunMethod<dbif::ChangeDataRequest>(100, 110, data::BinData(8, 0));
+  check();
+  EXPECT_EQ(view.deltas, 4);
+
+  // Shrink the blob so that it ends within the view.
+  blob->syncRunMethod<dbif::ChangeDataRequest>(
+      90, 178, data::BinData(8, 0));
+  check();
+  EXPECT_EQ(view.data.size(), 50u);
+  blob->syncRunMethod<dbif::ChangeDataRequest>(90, 90, iota(4, 100));
+  check();
+  EXPECT_EQ(view.data.size(), 54u);
+  EXPECT_EQ(view.deltas, 6);
+}
+
+TEST(DataBlobObject, SubscribesAfterEarlierMethods) {
+  auto root = create_db();
+  auto blob = root->syncRunMethod<dbif::RootCreateFileBlobFromDataRequest>(
+      iota(16), "test.bin")->object;
+  for (uint64_t i = 0; i < 20; i++) {
+    // Not waited for - the subscription still has to see its result.  The
+    // promise deletes itself once answered.
+    blob->asyncRunMethod<dbif::ChangeDataRequest>(
+        nullptr, 0, 1, iota(1, 100 + i));
+    auto promise = blob->asyncSubInfo<dbif::BlobDataRequest>(
+        nullptr, 0, 1, true);
+    data::BinData first;
+    QObject::connect(promise, &dbif::InfoPromise::gotInfo,
+                     [&first] (dbif::PInfoReply reply) {
+      if (first.size() == 0) {
+        first = reply.dynamicCast<dbif::BlobDataReply>()->data;
+      }
+    });
+    while (first.size() == 0) {
+      QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+    }
+    EXPECT_EQ(first, iota(1, 100 + i));
+    delete promise;
+  }
+}
+
+TEST(DataBlobObject, ReadsOwnWrites) {
+  auto root = create_db();
+  auto blob = root->syncRunMethod<dbif::RootCreateFileBlobFromDataRequest>(
+      iota(16), "test.bin")->object;
+  for (uint64_t i = 0; i < 20; i++) {
+    // The promise deletes itself once answered.
+    blob->asyncRunMethod<dbif::ChangeDataRequest>(
+        nullptr, 4, 6, iota(2, 100 + i));
+    EXPECT_EQ(blob->syncGetInfo<dbif::BlobDataRequest>(4, 6)->data,
+              iota(2, 100 + i));
+  }
+}
+
+}  // namespace db
+}  // namespace veles
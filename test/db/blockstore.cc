@@ -0,0 +1,152 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include <cstdint>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "db/blockstore.h"
+
+namespace veles {
+namespace db {
+
+namespace {
+
+// Big enough to be cut into a few dozen blocks.
+const size_t DATA_SIZE = 0x60000;
+
+std::vector<uint8_t> randomBytes(size_t size, uint32_t seed) {
+  std::vector<uint8_t> res(size);
+  for (auto &byte : res) {
+    seed = seed * 1103515245 + 12345;
+    byte = uint8_t(seed >> 16);
+  }
+  return res;
+}
+
+data::BinData toBin(const std::vector<uint8_t> &bytes) {
+  return data::BinData(8, bytes.size(), bytes.data());
+}
+
+void expectData(const BlockData &data, const std::vector<uint8_t> &bytes) {
+  ASSERT_EQ(data.size(), bytes.size());
+  EXPECT_EQ(data.data(0, data.size()), toBin(bytes));
+  uint64_t octets = 0;
+  for (auto &block : data.blocks()) {
+    octets += block->octets();
+  }
+  EXPECT_EQ(octets, bytes.size());
+}
+
+// Applies the same edit to the reference bytes and to the block data.
+void edit(BlockData &data, std::vector<uint8_t> &bytes, size_t start,
+          size_t end, const std::vector<uint8_t> &replacement) {
+  bytes.erase(bytes.begin() + start, bytes.begin() + end);
+  bytes.insert(bytes.begin() + start, replacement.begin(),
+               replacement.end());
+  data.setData(start, end, toBin(replacement));
+}
+
+}  // namespace
+
+TEST(BlockData, SplitsIntoBlocks) {
+  auto bytes = randomBytes(DATA_SIZE, 1);
+  BlockData data(toBin(bytes));
+  EXPECT_GT(data.blocks().size(), 4u);
+  expectData(data, bytes);
+  std::vector<uint8_t> part(bytes.begin() + 0x1234, bytes.begin() + 0x23456);
+  EXPECT_EQ(data.data(0x1234, 0x23456), toBin(part));
+}
+
+TEST(BlockData, ClampsRanges) {
+  auto bytes = randomBytes(0x100, 2);
+  BlockData data(toBin(bytes));
+  EXPECT_EQ(data.data(0x20, 0x10).size(), 0u);
+  EXPECT_EQ(data.data(0x200, 0x300).size(), 0u);
+  std::vector<uint8_t> tail(bytes.begin() + 0xf0, bytes.end());
+  EXPECT_EQ(data.data(0xf0, 0x200), toBin(tail));
+}
+
+TEST(BlockData, OverwritesAcrossBlocks) {
+  auto bytes = randomBytes(DATA_SIZE, 3);
+  BlockData data(toBin(bytes));
+  ASSERT_GT(data.blocks().size(), 3u);
+  // Straddle the boundary between the second and third block.
+  size_t boundary = data.blocks()[0]->octets() + data.blocks()[1]->octets();
+  edit(data, bytes, boundary - 100, boundary + 100, randomBytes(200, 4));
+  expectData(data, bytes);
+  // Cover several blocks at once.
+  edit(data, bytes, 0x100, 0x30000, randomBytes(0x2ff00, 5));
+  expectData(data, bytes);
+}
+
+TEST(BlockData, InsertsAndDeletes) {
+  auto bytes = randomBytes(DATA_SIZE, 6);
+  BlockData data(toBin(bytes));
+  edit(data, bytes, 0x8000, 0x8000, randomBytes(0x5000, 7));
+  expectData(data, bytes);
+  edit(data, bytes, 0, 0, randomBytes(3, 8));
+  expectData(data, bytes);
+  edit(data, bytes, bytes.size(), bytes.size(), randomBytes(0x100, 9));
+  expectData(data, bytes);
+  edit(data, bytes, 0x1000, 0x21000, {});
+  expectData(data, bytes);
+  edit(data, bytes, 0, bytes.size(), {});
+  expectData(data, bytes);
+  EXPECT_TRUE(data.blocks().empty());
+  edit(data, bytes, 0, 0, randomBytes(0x4000, 10));
+  expectData(data, bytes);
+}
+
+TEST(BlockData, KeepsBlocksAwayFromEdits) {
+  auto bytes = randomBytes(DATA_SIZE, 11);
+  BlockData data(toBin(bytes));
+  auto blocks = data.blocks();
+  ASSERT_GT(blocks.size(), 4u);
+  size_t middle = DATA_SIZE / 2;
+  edit(data, bytes, middle, middle + 10, randomBytes(30, 12));
+  expectData(data, bytes);
+  EXPECT_EQ(data.blocks().front(), blocks.front());
+  EXPECT_EQ(data.blocks().back(), blocks.back());
+
+  // Undoing the edit re-cuts the neighbourhood exactly as before, so all
+  // blocks are shared with the original again.
+  std::vector<uint8_t> orig = randomBytes(DATA_SIZE, 11);
+  edit(data, bytes, middle, middle + 30,
+       std::vector<uint8_t>(orig.begin() + middle,
+                            orig.begin() + middle + 10));
+  expectData(data, orig);
+  EXPECT_EQ(data.blocks(), blocks);
+}
+
+TEST(BlockData, KeepsWideElementsWhole) {
+  std::vector<uint8_t> bytes = randomBytes(0x10000, 13);
+  BlockData data(data::BinData(16, bytes.size() / 2, bytes.data()));
+  for (auto &block : data.blocks()) {
+    EXPECT_EQ(block->octets() % 2, 0u);
+  }
+  auto replacement = randomBytes(0x10, 14);
+  data.setData(0x1001, 0x1003, data::BinData(16, 8, replacement.data()));
+  bytes.erase(bytes.begin() + 0x2002, bytes.begin() + 0x2006);
+  bytes.insert(bytes.begin() + 0x2002, replacement.begin(), replacement.end());
+  EXPECT_EQ(data.size(), bytes.size() / 2);
+  EXPECT_EQ(data.data(0, data.size()),
+            data::BinData(16, bytes.size() / 2, bytes.data()));
+}
+
+}  // namespace db
+}  // namespace veles
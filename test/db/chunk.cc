@@ -0,0 +1,263 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "gtest/gtest.h"
+
+#include "data/field.h"
+#include "db/db.h"
+#include "db/handle.h"
+#include "dbif/deferred.h"
+#include "dbif/info.h"
+#include "dbif/method.h"
+#include "dbif/universe.h"
+#include "parser/utils.h"
+
+namespace veles {
+namespace db {
+
+namespace {
+
+dbif::ObjectHandle createBlob(dbif::ObjectHandle root, size_t size) {
+  data::BinData data(8, size);
+  for (size_t i = 0; i < size; i++) {
+    data.setElement64(i, i & 0xff);
+  }
+  return root->syncRunMethod<dbif::RootCreateFileBlobFromDataRequest>(
+      data, "test.bin")->object;
+}
+
+data::ChunkDataItem field(uint64_t start, uint64_t end, const QString &name) {
+  return data::ChunkDataItem::field(start, end, name, data::Repacker(),
+                                    end - start, data::FieldHighType(),
+                                    data::BinData(8, end - start));
+}
+
+std::vector<data::ChunkDataItem> parseItems(dbif::ObjectHandle chunk) {
+  return chunk->syncGetInfo<dbif::ChunkDataRequest>()->items;
+}
+
+QSharedPointer<dbif::ChunkDescriptionReply> describe(
+    dbif::ObjectHandle chunk) {
+  return chunk->syncGetInfo<dbif::DescriptionRequest>()
+      .dynamicCast<dbif::ChunkDescriptionReply>();
+}
+
+void changeData(dbif::ObjectHandle blob, uint64_t start, uint64_t end,
+                size_t size) {
+  blob->syncRunMethod<dbif::ChangeDataRequest>(start, end,
+                                               data::BinData(8, size));
+}
+
+// Parse requests are run one by one on the parser thread, so once this
+// one is answered, re-parses scheduled by earlier edits are done too.
+// The request to the database thread afterwards lets their results in.
+void waitForParser(dbif::ObjectHandle blob) {
+  blob->syncRunMethod<dbif::BlobParseRequest>("no-such-parser");
+  blob->syncGetInfo<dbif::DescriptionRequest>();
+}
+
+}  // namespace
+
+TEST(ChunkObject, ExpandsNestedDeferredChunks) {
+  auto root = create_db();
+  auto blob = createBlob(root, 16);
+  auto outer = blob->syncRunMethod<dbif::ChunkCreateRequest>(
+      "outer", "outer_t", dbif::ObjectHandle(), 0, 16)->object;
+
+  auto mid = dbif::PDeferredChunk::create(0, "mid_t", "mid");
+  auto leaf = dbif::PDeferredChunk::create(0, "leaf_t", "leaf");
+  leaf->end = 4;
+  leaf->items.assign({field(0, 4, "leaf_f")});
+  mid->end = 8;
+  mid->items.assign({
+    data::ChunkDataItem::subchunk(
+        0, 4, "leaf", dbif::ObjectHandle(new dbif::DeferredChunkHandle(leaf))),
+    field(4, 8, "mid_f"),
+  });
+  mid->children.push_back(leaf);
+  outer->syncRunMethod<dbif::SetChunkParseRequest>(
+      0, 16, std::vector<data::ChunkDataItem>{
+        data::ChunkDataItem::subchunk(
+            0, 8, "mid",
+            dbif::ObjectHandle(new dbif::DeferredChunkHandle(mid))),
+        field(8, 16, "outer_f"),
+      }, std::vector<dbif::PDeferredChunk>{mid});
+
+  auto outer_items = parseItems(outer);
+  ASSERT_EQ(outer_items.size(), 2u);
+  EXPECT_EQ(outer_items[0].type, data::ChunkDataItem::SUBCHUNK);
+  EXPECT_EQ(outer_items[1].name, "outer_f");
+  auto mid_obj = outer_items[0].ref[0];
+  EXPECT_TRUE(mid_obj.dynamicCast<dbif::DeferredChunkHandle>().isNull());
+
+  auto mid_items = parseItems(mid_obj);
+  ASSERT_EQ(mid_items.size(), 2u);
+  EXPECT_EQ(mid_items[0].type, data::ChunkDataItem::SUBCHUNK);
+  EXPECT_EQ(mid_items[0].name, "leaf");
+  EXPECT_EQ(mid_items[1].name, "mid_f");
+  EXPECT_EQ(mid_items[1].start, 4u);
+  EXPECT_EQ(mid_items[1].end, 8u);
+
+  // The leaf has no deferred children of its own, so nothing touches its
+  // parse after creation.
+  auto leaf_items = parseItems(mid_items[0].ref[0]);
+  ASSERT_EQ(leaf_items.size(), 1u);
+  EXPECT_EQ(leaf_items[0].type, data::ChunkDataItem::FIELD);
+  EXPECT_EQ(leaf_items[0].name, "leaf_f");
+  EXPECT_EQ(leaf_items[0].end, 4u);
+
+  auto desc = mid_items[0].ref[0]->syncGetInfo<dbif::DescriptionRequest>()
+      .dynamicCast<dbif::ChunkDescriptionReply>();
+  ASSERT_FALSE(desc.isNull());
+  EXPECT_EQ(desc->name, "leaf");
+  EXPECT_EQ(desc->chunk_type, "leaf_t");
+}
+
+TEST(ChunkObject, FreesDeletedChunksWithDeferredChildren) {
+  auto root = create_db();
+  auto blob = createBlob(root, 16);
+  auto outer = blob->syncRunMethod<dbif::ChunkCreateRequest>(
+      "outer", "outer_t", dbif::ObjectHandle(), 0, 16)->object;
+
+  // Set up the way a parser does it - the record points back to the chunk
+  // it gets stored in.
+  auto inner = dbif::PDeferredChunk::create(0, "inner_t", "inner");
+  inner->end = 8;
+  inner->anchor = outer;
+  inner->items.assign({field(0, 8, "inner_f")});
+  outer->syncRunMethod<dbif::SetChunkParseRequest>(
+      0, 16, std::vector<data::ChunkDataItem>{
+        data::ChunkDataItem::subchunk(
+            0, 8, "inner",
+            dbif::ObjectHandle(new dbif::DeferredChunkHandle(inner))),
+      }, std::vector<dbif::PDeferredChunk>{inner});
+
+  QWeakPointer<LocalObject> outer_obj =
+      outer.dynamicCast<LocalObjectHandle>()->obj();
+  QWeakPointer<LocalObject> blob_obj =
+      blob.dynamicCast<LocalObjectHandle>()->obj();
+  blob->syncRunMethod<dbif::DeleteRequest>();
+  outer.reset();
+  blob.reset();
+  inner.reset();
+  // Let the database thread finish with the deleted objects.
+  root->syncGetInfo<dbif::ChildrenRequest>();
+
+  EXPECT_TRUE(outer_obj.isNull());
+  EXPECT_TRUE(blob_obj.isNull());
+}
+
+TEST(ChunkObject, MovesChunksPastResizingEdits) {
+  auto root = create_db();
+  auto blob = createBlob(root, 100);
+  // No such parser, the chunks would be gone for good if re-parsed.
+  auto first = blob->syncRunMethod<dbif::ChunkCreateRequest>(
+      "first", "t", dbif::ObjectHandle(), 10, 20, "none")->object;
+  auto second = blob->syncRunMethod<dbif::ChunkCreateRequest>(
+      "second", "t", dbif::ObjectHandle(), 50, 60, "none")->object;
+  second->syncRunMethod<dbif::SetChunkParseRequest>(
+      50, 60, std::vector<data::ChunkDataItem>{field(52, 54, "f")});
+
+  // Right at the start of the second chunk - it just moves.
+  changeData(blob, 50, 50, 5);
+  EXPECT_EQ(describe(first)->start, 10u);
+  EXPECT_EQ(describe(first)->end, 20u);
+  EXPECT_EQ(describe(second)->start, 55u);
+  EXPECT_EQ(describe(second)->end, 65u);
+  auto items = parseItems(second);
+  ASSERT_EQ(items.size(), 1u);
+  EXPECT_EQ(items[0].start, 57u);
+  EXPECT_EQ(items[0].end, 59u);
+
+  // Right at the end of the first chunk - doesn't belong to it.
+  changeData(blob, 20, 20, 3);
+  EXPECT_EQ(describe(first)->end, 20u);
+  EXPECT_EQ(describe(second)->start, 58u);
+
+  changeData(blob, 30, 40, 0);
+  EXPECT_EQ(describe(first)->start, 10u);
+  EXPECT_EQ(describe(second)->start, 48u);
+  EXPECT_EQ(describe(second)->end, 58u);
+  EXPECT_EQ(parseItems(second)[0].start, 50u);
+}
+
+TEST(ChunkObject, ReparsesOnlyChangedRuns) {
+  auto root = create_db();
+  auto blob = createBlob(root, 100);
+  auto first = blob->syncRunMethod<dbif::ChunkCreateRequest>(
+      "first", "t", dbif::ObjectHandle(), 10, 20, "none")->object;
+  auto second = blob->syncRunMethod<dbif::ChunkCreateRequest>(
+      "second", "t", dbif::ObjectHandle(), 50, 60, "none")->object;
+  auto user = blob->syncRunMethod<dbif::ChunkCreateRequest>(
+      "user", "t", dbif::ObjectHandle(), 0, 100)->object;
+
+  // Overwrite without a size change.
+  changeData(blob, 12, 13, 1);
+  EXPECT_THROW(describe(first), dbif::PError);
+  EXPECT_EQ(describe(second)->start, 50u);
+
+  // Insertion inside the second chunk.
+  changeData(blob, 55, 55, 2);
+  EXPECT_THROW(describe(second), dbif::PError);
+
+  // Chunks not made by a parser stay and cover the new data.
+  auto desc = describe(user);
+  EXPECT_EQ(desc->start, 0u);
+  EXPECT_EQ(desc->end, 102u);
+}
+
+TEST(ChunkObject, KeepsUserLabelsAcrossReparse) {
+  const uint8_t png[] = {
+    0x89, 'P', 'N', 'G', 0x0d, 0x0a, 0x1a, 0x0a,
+    0, 0, 0, 4, 't', 'E', 'X', 't', 'a', 'b', 'c', 'd', 0, 0, 0, 0,
+    0, 0, 0, 0, 'I', 'E', 'N', 'D', 0, 0, 0, 0,
+  };
+  auto root = create_db();
+  auto blob = root->syncRunMethod<dbif::RootCreateFileBlobFromDataRequest>(
+      data::BinData(8, sizeof(png), png), "test.png")->object;
+  blob->syncRunMethod<dbif::BlobParseRequest>("png");
+  auto file = blob->syncGetInfo<dbif::ChildrenRequest>()->objects.at(0);
+  auto text = parser::findSubChunk(file, "chunks[0]");
+  auto end = parser::findSubChunk(file, "chunks[1]");
+  ASSERT_FALSE(text.isNull());
+  ASSERT_FALSE(end.isNull());
+  text->syncRunMethod<dbif::SetCommentRequest>("mine");
+  end->syncRunMethod<dbif::SetNameRequest>("renamed");
+
+  changeData(blob, 16, 17, 1);
+  waitForParser(blob);
+  EXPECT_THROW(describe(text), dbif::PError);
+
+  file = blob->syncGetInfo<dbif::ChildrenRequest>()->objects.at(0);
+  auto new_text = parser::findSubChunk(file, "chunks[0]");
+  ASSERT_FALSE(new_text.isNull());
+  EXPECT_EQ(describe(new_text)->comment, "mine");
+  // Found by position and type, the name is the user's.
+  std::vector<dbif::ObjectHandle> renamed;
+  for (auto &item : parseItems(file)) {
+    if (item.type == data::ChunkDataItem::SUBCHUNK &&
+        describe(item.ref[0])->name == "renamed") {
+      renamed.push_back(item.ref[0]);
+    }
+  }
+  ASSERT_EQ(renamed.size(), 1u);
+  EXPECT_EQ(describe(renamed[0])->start, 24u);
+  EXPECT_TRUE(describe(parser::findSubChunk(file, "header"))->comment
+      .isEmpty());
+}
+
+}  // namespace db
+}  // namespace veles
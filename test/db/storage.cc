@@ -0,0 +1,220 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include <QFile>
+#include <QTemporaryDir>
+
+#include "gtest/gtest.h"
+
+#include "data/field.h"
+#include "db/db.h"
+#include "dbif/deferred.h"
+#include "dbif/error.h"
+#include "dbif/info.h"
+#include "dbif/method.h"
+#include "dbif/universe.h"
+#include "parser/utils.h"
+
+namespace veles {
+namespace db {
+
+namespace {
+
+data::BinData testData(size_t size) {
+  data::BinData data(8, size);
+  for (size_t i = 0; i < size; i++) {
+    data.setElement64(i, (i * 7) & 0xff);
+  }
+  return data;
+}
+
+data::ChunkDataItem field(uint64_t start, uint64_t end, const QString &name) {
+  return data::ChunkDataItem::field(start, end, name, data::Repacker(),
+                                    end - start, data::FieldHighType(),
+                                    data::BinData(8, end - start));
+}
+
+QSharedPointer<dbif::ChunkDescriptionReply> describe(
+    dbif::ObjectHandle chunk) {
+  return chunk->syncGetInfo<dbif::DescriptionRequest>()
+      .dynamicCast<dbif::ChunkDescriptionReply>();
+}
+
+// A blob with one chunk whose parse has a deferred subchunk and a field.
+void makeProject(dbif::ObjectHandle root) {
+  auto blob = root->syncRunMethod<dbif::RootCreateFileBlobFromDataRequest>(
+      testData(64), "test.bin")->object;
+  blob->syncRunMethod<dbif::SetCommentRequest>("blob comment");
+  auto outer = blob->syncRunMethod<dbif::ChunkCreateRequest>(
+      "outer", "outer_t", dbif::ObjectHandle(), 0, 32)->object;
+  outer->syncRunMethod<dbif::SetCommentRequest>("mine");
+  auto inner = dbif::PDeferredChunk::create(8, "inner_t", "inner");
+  inner->end = 16;
+  inner->items.assign({field(8, 16, "inner_f")});
+  outer->syncRunMethod<dbif::SetChunkParseRequest>(
+      0, 32, std::vector<data::ChunkDataItem>{
+        data::ChunkDataItem::subchunk(
+            8, 16, "inner",
+            dbif::ObjectHandle(new dbif::DeferredChunkHandle(inner))),
+        field(16, 20, "outer_f"),
+      }, std::vector<dbif::PDeferredChunk>{inner});
+}
+
+std::vector<dbif::ObjectHandle> loadProject(dbif::ObjectHandle root,
+                                            const QString &path) {
+  return root->syncRunMethod<dbif::RootLoadProjectRequest>(path)->blobs;
+}
+
+void expectProject(dbif::ObjectHandle root,
+                   const std::vector<dbif::ObjectHandle> &blobs) {
+  ASSERT_EQ(blobs.size(), 1u);
+  EXPECT_EQ(root->syncGetInfo<dbif::ChildrenRequest>()->objects.size(), 1u);
+  auto blob = blobs[0];
+  auto blob_desc = blob->syncGetInfo<dbif::DescriptionRequest>()
+      .dynamicCast<dbif::FileBlobDescriptionReply>();
+  ASSERT_FALSE(blob_desc.isNull());
+  EXPECT_EQ(blob_desc->path, "test.bin");
+  EXPECT_EQ(blob_desc->comment, "blob comment");
+  EXPECT_EQ(blob_desc->size, 64u);
+  EXPECT_EQ(blob->syncGetInfo<dbif::BlobDataRequest>(0, 64)->data,
+            testData(64));
+
+  auto chunks = blob->syncGetInfo<dbif::ChildrenRequest>()->objects;
+  ASSERT_EQ(chunks.size(), 1u);
+  auto desc = describe(chunks[0]);
+  EXPECT_EQ(desc->name, "outer");
+  EXPECT_EQ(desc->comment, "mine");
+  EXPECT_EQ(desc->chunk_type, "outer_t");
+  EXPECT_EQ(desc->start, 0u);
+  EXPECT_EQ(desc->end, 32u);
+
+  auto items = chunks[0]->syncGetInfo<dbif::ChunkDataRequest>()->items;
+  ASSERT_EQ(items.size(), 2u);
+  EXPECT_EQ(items[0].type, data::ChunkDataItem::SUBCHUNK);
+  EXPECT_EQ(items[0].name, "inner");
+  EXPECT_EQ(items[1].type, data::ChunkDataItem::FIELD);
+  EXPECT_EQ(items[1].name, "outer_f");
+  EXPECT_EQ(items[1].start, 16u);
+  EXPECT_EQ(items[1].end, 20u);
+
+  auto inner = parser::findSubChunk(chunks[0], "inner");
+  ASSERT_FALSE(inner.isNull());
+  EXPECT_EQ(describe(inner)->chunk_type, "inner_t");
+  EXPECT_EQ(describe(inner)->start, 8u);
+  auto inner_items = inner->syncGetInfo<dbif::ChunkDataRequest>()->items;
+  ASSERT_EQ(inner_items.size(), 1u);
+  EXPECT_EQ(inner_items[0].name, "inner_f");
+  EXPECT_EQ(inner_items[0].end, 16u);
+}
+
+}  // namespace
+
+TEST(ProjectStorage, SavesAndLoads) {
+  QTemporaryDir dir;
+  ASSERT_TRUE(dir.isValid());
+  QString path = dir.filePath("first.velp");
+  auto orig = create_db();
+  makeProject(orig);
+  orig->syncRunMethod<dbif::RootSaveProjectRequest>(path);
+  auto root = create_db();
+  expectProject(root, loadProject(root, path));
+}
+
+TEST(ProjectStorage, SavesLoadedProject) {
+  QTemporaryDir dir;
+  ASSERT_TRUE(dir.isValid());
+  QString first = dir.filePath("first.velp");
+  QString second = dir.filePath("second.velp");
+  auto orig = create_db();
+  makeProject(orig);
+  orig->syncRunMethod<dbif::RootSaveProjectRequest>(first);
+
+  // Chunk bodies of a loaded project are written back without being read.
+  auto loaded = create_db();
+  loadProject(loaded, first);
+  loaded->syncRunMethod<dbif::RootSaveProjectRequest>(second);
+  auto root = create_db();
+  expectProject(root, loadProject(root, second));
+}
+
+TEST(ProjectStorage, RejectsTruncatedFiles) {
+  QTemporaryDir dir;
+  ASSERT_TRUE(dir.isValid());
+  QString path = dir.filePath("full.velp");
+  auto orig = create_db();
+  makeProject(orig);
+  orig->syncRunMethod<dbif::RootSaveProjectRequest>(path);
+  QFile full(path);
+  ASSERT_TRUE(full.open(QIODevice::ReadOnly));
+  QByteArray bytes = full.readAll();
+  ASSERT_GT(bytes.size(), 100);
+
+  for (int size : {12, 40, bytes.size() / 2, bytes.size() - 1}) {
+    QString truncated = dir.filePath(QString("truncated%1.velp").arg(size));
+    QFile out(truncated);
+    ASSERT_TRUE(out.open(QIODevice::WriteOnly));
+    out.write(bytes.left(size));
+    out.close();
+
+    auto root = create_db();
+    EXPECT_THROW(loadProject(root, truncated), dbif::PError) << size;
+    // Nothing read before the corruption was spotted stays around.
+    EXPECT_TRUE(root->syncGetInfo<dbif::ChildrenRequest>()->objects.empty())
+        << size;
+  }
+}
+
+TEST(ProjectStorage, ReportsCorruptedChunkBodies) {
+  QTemporaryDir dir;
+  ASSERT_TRUE(dir.isValid());
+  QString path = dir.filePath("corrupted.velp");
+  auto orig = create_db();
+  makeProject(orig);
+  orig->syncRunMethod<dbif::RootSaveProjectRequest>(path);
+  QFile file(path);
+  ASSERT_TRUE(file.open(QIODevice::ReadWrite));
+  QByteArray bytes = file.readAll();
+  // Item type in front of the name of the outer chunk's field - the name
+  // is a u32 byte count followed by UTF-16.
+  QString name("outer_f");
+  QByteArray encoded;
+  for (QChar c : name) {
+    encoded.append(char(0)).append(c.toLatin1());
+  }
+  int pos = bytes.indexOf(encoded);
+  ASSERT_GT(pos, 5);
+  bytes[pos - 5] = char(0xff);
+  ASSERT_TRUE(file.seek(0));
+  ASSERT_EQ(file.write(bytes), bytes.size());
+  file.close();
+
+  // Bodies are only read once looked into.
+  auto root = create_db();
+  auto blobs = loadProject(root, path);
+  ASSERT_EQ(blobs.size(), 1u);
+  auto chunks = blobs[0]->syncGetInfo<dbif::ChildrenRequest>()->objects;
+  ASSERT_EQ(chunks.size(), 1u);
+  EXPECT_THROW(chunks[0]->syncGetInfo<dbif::ChunkDataRequest>(),
+               dbif::PError);
+  EXPECT_THROW(chunks[0]->syncGetInfo<dbif::ChildrenRequest>(),
+               dbif::PError);
+  EXPECT_THROW(root->syncRunMethod<dbif::RootSaveProjectRequest>(
+                   dir.filePath("again.velp")),
+               dbif::PError);
+}
+
+}  // namespace db
+}  // namespace veles
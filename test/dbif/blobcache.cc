@@ -0,0 +1,247 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QThread>
+
+#include "gtest/gtest.h"
+
+#include "data/bindata.h"
+#include "db/db.h"
+#include "dbif/blobcache.h"
+#include "dbif/info.h"
+#include "dbif/method.h"
+#include "dbif/universe.h"
+
+namespace veles {
+namespace dbif {
+
+namespace {
+
+const uint64_t PAGE = BlobPageCache::PAGE_SIZE;
+const uint64_t NUM_PAGES = 10;
+
+data::BinData pattern(size_t size, uint64_t seed = 0) {
+  data::BinData res(8, size);
+  for (size_t i = 0; i < size; i++) {
+    res.setElement64(i, (i * 13 + i / 256 + seed) & 0xff);
+  }
+  return res;
+}
+
+bool processEventsUntil(std::function<bool()> done) {
+  QElapsedTimer timer;
+  timer.start();
+  while (!done()) {
+    if (timer.elapsed() > 5000) {
+      return false;
+    }
+    QCoreApplication::processEvents();
+    QThread::msleep(1);
+  }
+  return true;
+}
+
+/** A blob of NUM_PAGES pages and a cache of it, recording its signals.  */
+class BlobPageCacheTest : public ::testing::Test {
+ protected:
+  ObjectHandle root;
+  ObjectHandle blob;
+  data::BinData contents;
+  std::vector<std::pair<qint64, qint64>> loaded;
+  std::vector<std::pair<qint64, qint64>> changed;
+
+  void SetUp() override {
+    root = db::create_db();
+    contents = pattern(NUM_PAGES * PAGE);
+    blob = root->syncRunMethod<RootCreateFileBlobFromDataRequest>(
+        contents, "test.bin")->object;
+  }
+
+  BlobPageCache *createCache(uint64_t budget_pages) {
+    auto cache = new BlobPageCache(blob, contents.size(), 8,
+                                   budget_pages * PAGE);
+    QObject::connect(cache, &BlobPageCache::pageLoaded,
+                     [this] (qint64 start, qint64 end) {
+      loaded.emplace_back(start, end);
+    });
+    QObject::connect(cache, &BlobPageCache::pageChanged,
+                     [this] (qint64 start, qint64 end) {
+      changed.emplace_back(start, end);
+    });
+    return cache;
+  }
+
+  void waitForLoads(size_t count) {
+    ASSERT_TRUE(processEventsUntil([this, count] {
+      return loaded.size() >= count;
+    }));
+  }
+
+  bool pageLoaded(BlobPageCache *cache, uint64_t page) const {
+    return cache->isLoaded(page * PAGE, (page + 1) * PAGE);
+  }
+};
+
+}  // namespace
+
+TEST_F(BlobPageCacheTest, FetchesRequestedAndPrefetchedPages) {
+  std::unique_ptr<BlobPageCache> cache(createCache(NUM_PAGES));
+  cache->request(PAGE + 10, PAGE + 20);
+  // One page behind, the requested one and PREFETCH_PAGES ahead.
+  waitForLoads(2 + BlobPageCache::PREFETCH_PAGES);
+  for (uint64_t page = 0; page < NUM_PAGES; page++) {
+    EXPECT_EQ(pageLoaded(cache.get(), page),
+              page <= 1 + BlobPageCache::PREFETCH_PAGES) << page;
+  }
+  EXPECT_EQ(cache->data(PAGE - 5, 3 * PAGE + 5),
+            contents.data(PAGE - 5, 3 * PAGE + 5));
+  uint64_t value;
+  ASSERT_TRUE(cache->element(2 * PAGE + 7, &value));
+  EXPECT_EQ(value, contents.element64(2 * PAGE + 7));
+  EXPECT_FALSE(cache->element(9 * PAGE, &value));
+  EXPECT_TRUE(changed.empty());
+}
+
+TEST_F(BlobPageCacheTest, EvictsLeastRecentlyUsedPages) {
+  std::unique_ptr<BlobPageCache> cache(createCache(7));
+  cache->request(0, 1);
+  waitForLoads(5);
+  // Pages 4 - 9 now, 0 - 3 were last used before, and 3 of them have to
+  // go to fit in the budget.
+  cache->request(5 * PAGE, 5 * PAGE + 1);
+  waitForLoads(10);
+  EXPECT_FALSE(pageLoaded(cache.get(), 0));
+  EXPECT_FALSE(pageLoaded(cache.get(), 1));
+  EXPECT_FALSE(pageLoaded(cache.get(), 2));
+  EXPECT_TRUE(pageLoaded(cache.get(), 3));
+  for (uint64_t page = 4; page < NUM_PAGES; page++) {
+    EXPECT_TRUE(pageLoaded(cache.get(), page)) << page;
+  }
+
+  // Pages 2 - 7 are in use, 2 is fetched again and 8 is the least
+  // recently used one of the rest.
+  cache->request(3 * PAGE, 3 * PAGE + 1);
+  waitForLoads(11);
+  EXPECT_FALSE(pageLoaded(cache.get(), 1));
+  for (uint64_t page = 2; page <= 7; page++) {
+    EXPECT_TRUE(pageLoaded(cache.get(), page)) << page;
+  }
+  EXPECT_FALSE(pageLoaded(cache.get(), 8));
+  EXPECT_TRUE(pageLoaded(cache.get(), 9));
+}
+
+TEST_F(BlobPageCacheTest, KeepsRequestedPagesOverBudget) {
+  // The pages being asked for are never evicted.
+  std::unique_ptr<BlobPageCache> cache(createCache(1));
+  cache->request(3 * PAGE, 3 * PAGE + 1);
+  waitForLoads(2 + BlobPageCache::PREFETCH_PAGES);
+  for (uint64_t page = 2; page <= 3 + BlobPageCache::PREFETCH_PAGES;
+       page++) {
+    EXPECT_TRUE(pageLoaded(cache.get(), page)) << page;
+  }
+  cache->request(0, 1);
+  waitForLoads(4 + BlobPageCache::PREFETCH_PAGES);
+  EXPECT_TRUE(pageLoaded(cache.get(), 0));
+  EXPECT_FALSE(pageLoaded(cache.get(), 3 + BlobPageCache::PREFETCH_PAGES));
+}
+
+TEST_F(BlobPageCacheTest, AppliesDeltasToCachedPages) {
+  std::unique_ptr<BlobPageCache> cache(createCache(NUM_PAGES));
+  cache->request(0, 1);
+  waitForLoads(5);
+  auto patch = pattern(100, 77);
+  blob->syncRunMethod<ChangeDataRequest>(PAGE + 1000, PAGE + 1100, patch);
+  ASSERT_TRUE(processEventsUntil([this] { return !changed.empty(); }));
+  // Only the edited part is reported, and the page wasn't fetched again.
+  ASSERT_EQ(changed.size(), 1u);
+  EXPECT_EQ(changed[0].first, qint64(PAGE + 1000));
+  EXPECT_EQ(changed[0].second, qint64(PAGE + 1100));
+  EXPECT_EQ(loaded.size(), 5u);
+  contents.setData(PAGE + 1000, PAGE + 1100, patch);
+  EXPECT_EQ(cache->data(0, 2 * PAGE), contents.data(0, 2 * PAGE));
+}
+
+namespace {
+
+/** Signals of a BlobRangeReader, as received.  */
+struct ReadResult {
+  std::vector<std::pair<qint64, data::BinData>> pieces;
+  bool finished = false;
+  bool failed = false;
+
+  explicit ReadResult(BlobRangeReader *reader) {
+    QObject::connect(reader, &BlobRangeReader::gotData,
+                     [this] (qint64 pos, const data::BinData &data) {
+      pieces.emplace_back(pos, data);
+    });
+    QObject::connect(reader, &BlobRangeReader::finished,
+                     [this] { finished = true; });
+    QObject::connect(reader, &BlobRangeReader::failed,
+                     [this] (PError) { failed = true; });
+  }
+
+  bool wait() {
+    return processEventsUntil([this] { return finished || failed; });
+  }
+};
+
+}  // namespace
+
+TEST_F(BlobPageCacheTest, ReadsRangesInPieces) {
+  const uint64_t PIECE = BlobRangeReader::PIECE_SIZE;
+  auto big = pattern(2 * PIECE + 100, 5);
+  auto big_blob = root->syncRunMethod<RootCreateFileBlobFromDataRequest>(
+      big, "big.bin")->object;
+  uint64_t start = 7;
+  uint64_t end = big.size() - 3;
+  ReadResult result(new BlobRangeReader(big_blob, start, end));
+  ASSERT_TRUE(result.wait());
+  EXPECT_TRUE(result.finished);
+  ASSERT_EQ(result.pieces.size(), 3u);
+  uint64_t pos = start;
+  for (auto &piece : result.pieces) {
+    EXPECT_EQ(piece.first, qint64(pos));
+    EXPECT_LE(piece.second.size(), PIECE);
+    EXPECT_EQ(piece.second, big.data(pos, pos + piece.second.size()));
+    pos += piece.second.size();
+  }
+  EXPECT_EQ(pos, end);
+}
+
+TEST_F(BlobPageCacheTest, FinishesEmptyReads) {
+  ReadResult result(new BlobRangeReader(blob, 5, 5));
+  ASSERT_TRUE(result.wait());
+  EXPECT_TRUE(result.finished);
+  EXPECT_TRUE(result.pieces.empty());
+}
+
+TEST_F(BlobPageCacheTest, FailsReadsPastTheEnd) {
+  ReadResult result(new BlobRangeReader(blob, PAGE, contents.size() + 10));
+  ASSERT_TRUE(result.wait());
+  EXPECT_TRUE(result.failed);
+  ASSERT_EQ(result.pieces.size(), 1u);
+  EXPECT_EQ(result.pieces[0].second, contents.data(PAGE, contents.size()));
+}
+
+}  // namespace dbif
+}  // namespace veles
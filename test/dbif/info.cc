@@ -0,0 +1,73 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "gtest/gtest.h"
+
+#include "data/bindata.h"
+#include "dbif/info.h"
+
+namespace veles {
+namespace dbif {
+
+namespace {
+
+data::BinData iota(size_t size, uint64_t first = 0) {
+  data::BinData res(8, size);
+  for (size_t i = 0; i < size; i++) {
+    res.setElement64(i, (first + i) & 0xff);
+  }
+  return res;
+}
+
+data::BinData apply(const data::BinData &old_data, uint64_t start,
+                    uint64_t removed, const data::BinData &inserted,
+                    uint64_t size) {
+  data::BinData res = old_data;
+  BlobDataDeltaReply(start, removed, inserted, size).apply(res);
+  return res;
+}
+
+}  // namespace
+
+TEST(BlobDataDeltaReply, Overwrite) {
+  auto res = apply(iota(10), 3, 2, iota(2, 100), 10);
+  EXPECT_EQ(res, iota(3) + iota(2, 100) + iota(5, 5));
+}
+
+TEST(BlobDataDeltaReply, Insert) {
+  auto res = apply(iota(10), 4, 0, iota(3, 100), 10);
+  EXPECT_EQ(res, iota(4) + iota(3, 100) + iota(3, 4));
+  // The view is past the end of the blob, so it grows.
+  res = apply(iota(10), 4, 0, iota(3, 100), 13);
+  EXPECT_EQ(res, iota(4) + iota(3, 100) + iota(6, 4));
+}
+
+TEST(BlobDataDeltaReply, Remove) {
+  // Data scrolled in from past the view comes with the inserted part.
+  auto res = apply(iota(10), 2, 8, iota(8, 5), 10);
+  EXPECT_EQ(res, iota(2) + iota(8, 5));
+  // Blob ends within the view.
+  res = apply(iota(10), 2, 3, data::BinData(8, 0), 7);
+  EXPECT_EQ(res, iota(2) + iota(5, 5));
+}
+
+TEST(BlobDataDeltaReply, ReplaceWithLonger) {
+  auto res = apply(iota(10), 0, 2, iota(4, 100), 10);
+  EXPECT_EQ(res, iota(4, 100) + iota(6, 2));
+}
+
+}  // namespace dbif
+}  // namespace veles
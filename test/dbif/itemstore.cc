@@ -0,0 +1,154 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "gtest/gtest.h"
+
+#include "data/field.h"
+#include "dbif/deferred.h"
+#include "dbif/itemstore.h"
+
+namespace veles {
+namespace dbif {
+
+namespace {
+
+data::ChunkDataItem item(data::ChunkDataItem::ChunkDataItemType type,
+                         uint64_t start, uint64_t end, const QString &name) {
+  data::ChunkDataItem res;
+  res.type = type;
+  res.start = start;
+  res.end = end;
+  res.name = name;
+  res.num_elements = 0;
+  return res;
+}
+
+void expectSame(const data::ChunkDataItem &a, const data::ChunkDataItem &b) {
+  EXPECT_EQ(a.type, b.type);
+  EXPECT_EQ(a.start, b.start);
+  EXPECT_EQ(a.end, b.end);
+  EXPECT_EQ(a.name, b.name);
+  EXPECT_EQ(a.ref, b.ref);
+  if (a.type == data::ChunkDataItem::FIELD ||
+      a.type == data::ChunkDataItem::BITFIELD ||
+      a.type == data::ChunkDataItem::COMPUTED) {
+    EXPECT_EQ(a.raw_value, b.raw_value);
+    EXPECT_EQ(a.high_type.mode, b.high_type.mode);
+    EXPECT_EQ(a.high_type.shift, b.high_type.shift);
+    EXPECT_EQ(a.high_type.type_name, b.high_type.type_name);
+  }
+  if (a.type == data::ChunkDataItem::FIELD) {
+    EXPECT_EQ(a.num_elements, b.num_elements);
+    EXPECT_EQ(a.repack.endian, b.repack.endian);
+    EXPECT_EQ(a.repack.from_width, b.repack.from_width);
+    EXPECT_EQ(a.repack.to_width, b.repack.to_width);
+  }
+}
+
+std::vector<data::ChunkDataItem> sampleItems() {
+  ObjectHandle sub(new DeferredChunkHandle(
+      PDeferredChunk::create(0, "sub_t", "sub")));
+  ObjectHandle target(new DeferredChunkHandle(
+      PDeferredChunk::create(0, "target_t", "target")));
+  auto pointer = data::FieldHighType::fixed(data::FieldHighType::UNSIGNED, 2);
+  pointer.mode = data::FieldHighType::POINTER;
+  pointer.type_name = "target_t";
+  auto flags = item(data::ChunkDataItem::BITFIELD, 3, 5, "flags");
+  flags.high_type = data::FieldHighType::fixed(data::FieldHighType::UNSIGNED);
+  flags.raw_value = data::BinData(2, {2});
+  auto size = item(data::ChunkDataItem::COMPUTED, 0, 0, "size");
+  size.high_type =
+      data::FieldHighType::floating(data::FieldHighType::IEEE754_DOUBLE);
+  size.raw_value = data::BinData(64, {0x4045000000000000});
+  return {
+    data::ChunkDataItem::subchunk(0, 4, "sub", sub),
+    data::ChunkDataItem::field(
+        4, 8, "magic", data::Repacker(data::Endian::LITTLE, 8, 16), 2,
+        data::FieldHighType::fixed(data::FieldHighType::SIGNED, -3),
+        data::BinData(16, {0x1234, 0xfedc})),
+    flags,
+    data::ChunkDataItem::field(
+        8, 16, "next", data::Repacker(data::Endian::BIG, 8, 64), 1, pointer,
+        data::BinData(64, {0x10}), {target}),
+    item(data::ChunkDataItem::PAD, 16, 20, ""),
+    size,
+    data::ChunkDataItem::field(
+        20, 24, "name", data::Repacker(), 4,
+        data::FieldHighType::string(
+            data::FieldHighType::STRING_ZERO_PADDED,
+            data::FieldHighType::ENC_UTF8),
+        data::BinData(8, {'a', 'b', 0, 0})),
+    data::ChunkDataItem::subblob("blob", sub),
+  };
+}
+
+}  // namespace
+
+TEST(ChunkItemStore, RoundTripsItems) {
+  auto items = sampleItems();
+  ChunkItemStore store;
+  store.assign(items);
+  ASSERT_EQ(store.size(), items.size());
+  for (size_t idx = 0; idx < items.size(); idx++) {
+    SCOPED_TRACE(idx);
+    EXPECT_EQ(store.type(idx), items[idx].type);
+    EXPECT_EQ(store.start(idx), items[idx].start);
+    EXPECT_EQ(store.end(idx), items[idx].end);
+    EXPECT_EQ(store.refCount(idx), items[idx].ref.size());
+    expectSame(store.item(idx), items[idx]);
+  }
+  auto all = store.items();
+  ASSERT_EQ(all.size(), items.size());
+  for (size_t idx = 0; idx < items.size(); idx++) {
+    SCOPED_TRACE(idx);
+    expectSame(all[idx], items[idx]);
+  }
+}
+
+TEST(ChunkItemStore, ReassignReplacesItems) {
+  ChunkItemStore store;
+  store.assign(sampleItems());
+  auto items = std::vector<data::ChunkDataItem>{
+    data::ChunkDataItem::field(
+        0, 1, "only", data::Repacker(), 1,
+        data::FieldHighType::fixed(data::FieldHighType::UNSIGNED),
+        data::BinData(8, {7})),
+  };
+  store.assign(items);
+  ASSERT_EQ(store.size(), 1u);
+  expectSame(store.item(0), items[0]);
+  store.assign({});
+  EXPECT_TRUE(store.empty());
+}
+
+TEST(ChunkItemStore, MovesItems) {
+  auto items = sampleItems();
+  ChunkItemStore store;
+  store.assign(items);
+  store.setRange(1, 104, 108);
+  auto moved = store.item(1);
+  EXPECT_EQ(moved.start, 104u);
+  EXPECT_EQ(moved.end, 108u);
+  EXPECT_EQ(moved.raw_value, items[1].raw_value);
+  ObjectHandle other(new DeferredChunkHandle(
+      PDeferredChunk::create(0, "other_t", "other")));
+  store.setRef(3, 0, other);
+  EXPECT_EQ(store.ref(3, 0), other);
+  EXPECT_EQ(store.item(3).ref, std::vector<ObjectHandle>{other});
+}
+
+}  // namespace dbif
+}  // namespace veles
@@ -0,0 +1,186 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "db/db.h"
+#include "dbif/info.h"
+#include "dbif/method.h"
+#include "dbif/universe.h"
+#include "kaitai/zip_parser.h"
+
+using namespace testing;
+
+namespace veles {
+namespace kaitai {
+
+namespace {
+
+struct Member {
+  std::string name;
+  uint16_t method;
+  std::vector<uint8_t> data;
+  // Uncompressed size written to the headers.
+  uint32_t declared_size;
+};
+
+void putLe(std::vector<uint8_t> &out, uint64_t val, int size) {
+  for (int i = 0; i < size; i++) {
+    out.push_back(static_cast<uint8_t>(val >> (i * 8)));
+  }
+}
+
+std::vector<uint8_t> deflateRaw(const std::vector<uint8_t> &data) {
+  z_stream strm;
+  memset(&strm, 0, sizeof(strm));
+  deflateInit2(&strm, Z_BEST_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8,
+               Z_DEFAULT_STRATEGY);
+  std::vector<uint8_t> out(deflateBound(&strm, data.size()));
+  strm.next_in = const_cast<uint8_t *>(data.data());
+  strm.avail_in = static_cast<uInt>(data.size());
+  strm.next_out = out.data();
+  strm.avail_out = static_cast<uInt>(out.size());
+  deflate(&strm, Z_FINISH);
+  out.resize(strm.total_out);
+  deflateEnd(&strm);
+  return out;
+}
+
+std::vector<uint8_t> makeZip(const std::vector<Member> &members) {
+  std::vector<uint8_t> zip;
+  std::vector<uint8_t> central_dir;
+  for (auto &member : members) {
+    std::vector<uint8_t> body = member.method == 8 ? deflateRaw(member.data)
+                                                   : member.data;
+    uint32_t crc = static_cast<uint32_t>(
+        crc32(0, member.data.data(), static_cast<uInt>(member.data.size())));
+    uint64_t offset = zip.size();
+
+    putLe(zip, 0x04034b50, 4);
+    putLe(zip, 20, 2);
+    putLe(zip, 0, 2);
+    putLe(zip, member.method, 2);
+    putLe(zip, 0, 4);
+    putLe(zip, crc, 4);
+    putLe(zip, body.size(), 4);
+    putLe(zip, member.declared_size, 4);
+    putLe(zip, member.name.size(), 2);
+    putLe(zip, 0, 2);
+    zip.insert(zip.end(), member.name.begin(), member.name.end());
+    zip.insert(zip.end(), body.begin(), body.end());
+
+    putLe(central_dir, 0x02014b50, 4);
+    putLe(central_dir, 20, 2);
+    putLe(central_dir, 20, 2);
+    putLe(central_dir, 0, 2);
+    putLe(central_dir, member.method, 2);
+    putLe(central_dir, 0, 4);
+    putLe(central_dir, crc, 4);
+    putLe(central_dir, body.size(), 4);
+    putLe(central_dir, member.declared_size, 4);
+    putLe(central_dir, member.name.size(), 2);
+    putLe(central_dir, 0, 2);
+    putLe(central_dir, 0, 2);
+    putLe(central_dir, 0, 2);
+    putLe(central_dir, 0, 2);
+    putLe(central_dir, 0, 4);
+    putLe(central_dir, offset, 4);
+    central_dir.insert(central_dir.end(), member.name.begin(),
+                       member.name.end());
+  }
+  uint64_t central_dir_offset = zip.size();
+  zip.insert(zip.end(), central_dir.begin(), central_dir.end());
+  putLe(zip, 0x06054b50, 4);
+  putLe(zip, 0, 2);
+  putLe(zip, 0, 2);
+  putLe(zip, members.size(), 2);
+  putLe(zip, members.size(), 2);
+  putLe(zip, central_dir.size(), 4);
+  putLe(zip, central_dir_offset, 4);
+  putLe(zip, 0, 2);
+  return zip;
+}
+
+void collectSubBlobs(dbif::ObjectHandle obj,
+                     std::map<QString, std::vector<uint8_t>> &res) {
+  if (obj->type() == dbif::SUB_BLOB) {
+    auto desc = obj->syncGetInfo<dbif::DescriptionRequest>()
+        .dynamicCast<dbif::BlobDescriptionReply>();
+    auto data = obj->syncGetInfo<dbif::BlobDataRequest>(0, desc->size)->data;
+    res[desc->name] = std::vector<uint8_t>(
+        data.rawData(), data.rawData() + data.octets());
+  }
+  for (auto child : obj->syncGetInfo<dbif::ChildrenRequest>()->objects) {
+    collectSubBlobs(child, res);
+  }
+}
+
+std::map<QString, std::vector<uint8_t>> parseZip(
+    const std::vector<Member> &members) {
+  auto zip = makeZip(members);
+  auto root = db::create_db();
+  auto blob = root->syncRunMethod<dbif::RootCreateFileBlobFromDataRequest>(
+      data::BinData(8, zip.size(), zip.data()), "test.zip")->object;
+  ZipParser().parse(blob);
+  std::map<QString, std::vector<uint8_t>> res;
+  collectSubBlobs(blob, res);
+  return res;
+}
+
+std::vector<uint8_t> testData(size_t size) {
+  std::vector<uint8_t> res(size);
+  for (size_t i = 0; i < size; i++) {
+    res[i] = static_cast<uint8_t>((i * i) >> 7);
+  }
+  return res;
+}
+
+}  // namespace
+
+TEST(ZipParser, InflatesMembers) {
+  auto stored = testData(100);
+  auto deflated = testData(100000);
+  auto res = parseZip({
+      {"stored.bin", 0, stored, static_cast<uint32_t>(stored.size())},
+      {"deflated.bin", 8, deflated, static_cast<uint32_t>(deflated.size())},
+  });
+  EXPECT_EQ(res.size(), 2u);
+  EXPECT_THAT(res["stored.bin"], ContainerEq(stored));
+  EXPECT_THAT(res["deflated.bin"], ContainerEq(deflated));
+}
+
+TEST(ZipParser, RejectsMembersBiggerThanDeclared) {
+  // A few hundred bytes inflating to a megabyte, while claiming a kilobyte.
+  std::vector<uint8_t> bomb(1 << 20);
+  auto ok = testData(1000);
+  auto res = parseZip({
+      {"bomb.bin", 8, bomb, 1024},
+      {"ok.bin", 8, ok, static_cast<uint32_t>(ok.size())},
+  });
+  EXPECT_EQ(res.size(), 1u);
+  EXPECT_THAT(res["ok.bin"], ContainerEq(ok));
+}
+
+}  // namespace kaitai
+}  // namespace veles
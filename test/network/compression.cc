@@ -0,0 +1,102 @@
+/*
+ * Copyright 2017 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "network/compression.h"
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "proto/exceptions.h"
+
+using namespace testing;
+
+namespace veles {
+namespace messages {
+
+TEST(Compression, Algorithms) {
+  auto algorithms = compressionAlgorithms();
+  ASSERT_FALSE(algorithms.empty());
+  for (const auto& algorithm : algorithms) {
+    EXPECT_TRUE(compressionSupported(algorithm));
+  }
+  EXPECT_FALSE(compressionSupported("no-such-algorithm"));
+}
+
+TEST(Compression, RoundTrip) {
+  std::string data;
+  for (int i = 0; i < 10000; i++) {
+    data += "message " + std::to_string(i % 100) + ";";
+  }
+  std::vector<uint8_t> compressed;
+  ASSERT_TRUE(compress("zlib", data.data(), data.size(), &compressed));
+  EXPECT_LT(compressed.size(), data.size());
+  auto res = decompress("zlib", compressed);
+  EXPECT_EQ(std::string(res.begin(), res.end()), data);
+}
+
+TEST(Compression, Skipped) {
+  std::vector<uint8_t> out = {1, 2, 3};
+  std::string small(COMPRESSION_THRESHOLD - 1, 'a');
+  EXPECT_FALSE(compress("zlib", small.data(), small.size(), &out));
+  EXPECT_EQ(out, std::vector<uint8_t>({1, 2, 3}));
+
+  std::mt19937 gen(0);
+  std::string random;
+  for (int i = 0; i < 4096; i++) {
+    random += static_cast<char>(gen());
+  }
+  EXPECT_FALSE(compress("zlib", random.data(), random.size(), &out));
+  EXPECT_EQ(out, std::vector<uint8_t>({1, 2, 3}));
+
+  std::string big(COMPRESSION_THRESHOLD, 'a');
+  EXPECT_FALSE(compress("no-such-algorithm", big.data(), big.size(), &out));
+  EXPECT_TRUE(compress("zlib", big.data(), big.size(), &out));
+}
+
+TEST(Compression, Corrupted) {
+  std::string data(5000, 'x');
+  std::vector<uint8_t> compressed;
+  ASSERT_TRUE(compress("zlib", data.data(), data.size(), &compressed));
+  EXPECT_THROW(decompress("no-such-algorithm", compressed),
+               proto::SchemaError);
+  std::vector<uint8_t> truncated(compressed.begin(),
+                                 compressed.begin() + compressed.size() / 2);
+  EXPECT_THROW(decompress("zlib", truncated), proto::SchemaError);
+  EXPECT_THROW(decompress("zlib", std::vector<uint8_t>({1, 2, 3, 4})),
+               proto::SchemaError);
+  EXPECT_THROW(decompress("zlib", std::vector<uint8_t>()),
+               proto::SchemaError);
+}
+
+TEST(Compression, SizeLimit) {
+  std::string data(1 << 20, 'x');
+  std::vector<uint8_t> compressed;
+  ASSERT_TRUE(compress("zlib", data.data(), data.size(), &compressed));
+  ASSERT_LT(compressed.size(), data.size() / 200);
+  EXPECT_EQ(decompress("zlib", compressed, data.size()).size(), data.size());
+  EXPECT_THROW(decompress("zlib", compressed, data.size() - 1),
+               proto::SchemaError);
+  EXPECT_THROW(decompress("zlib", compressed, 1000), proto::SchemaError);
+  EXPECT_THROW(decompress("zlib", compressed, 0), proto::SchemaError);
+}
+
+}  // namespace messages
+}  // namespace veles
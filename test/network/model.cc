@@ -449,5 +449,88 @@ TEST(TestModel, TestPolyModel) {
   EXPECT_THAT(*ptr2->b, ContainerEq(std::vector<uint8_t>(5,30)));
 }
 
+template <class T>
+void expectSameEncoding(std::shared_ptr<T> obj) {
+  msgpack::sbuffer direct;
+  msgpack::packer<msgpack::sbuffer> direct_packer(direct);
+  MsgpackWrapper::dumpObject(direct_packer, obj);
+  msgpack::sbuffer tree;
+  msgpack::packer<msgpack::sbuffer> tree_packer(tree);
+  tree_packer.pack(obj->serializeToMsgpackObject());
+  ASSERT_EQ(direct.size(), tree.size());
+  EXPECT_EQ(memcmp(direct.data(), tree.data(), tree.size()), 0);
+}
+
+TEST(TestModel, TestDirectCodec) {
+  auto sub = std::make_shared<SubType2>(
+      std::make_shared<std::string>("test-base-attr"),
+      std::make_shared<std::vector<uint8_t>>(5, 30));
+  expectSameEncoding(sub);
+  msgpack::sbuffer sbuf;
+  msgpack::packer<msgpack::sbuffer> packer(sbuf);
+  MsgpackWrapper::dumpObject(packer, sub);
+  msgpack::object_handle oh = msgpack::unpack(sbuf.data(), sbuf.size());
+  auto ptr = std::dynamic_pointer_cast<SubType2>(
+      BaseModel::polymorphicLoad(oh.get()));
+  ASSERT_NE(ptr, nullptr);
+  EXPECT_EQ(*ptr->a, "test-base-attr");
+  EXPECT_THAT(*ptr->b, ContainerEq(std::vector<uint8_t>(5, 30)));
+
+  auto bindata = std::make_shared<BinDataModel>(
+      std::make_shared<data::BinData>(12, std::initializer_list<uint64_t>{
+          0x123, 0x456, 0x789}));
+  expectSameEncoding(bindata);
+  sbuf.clear();
+  MsgpackWrapper::dumpObject(packer, bindata);
+  oh = msgpack::unpack(sbuf.data(), sbuf.size());
+  auto ptr2 = BinDataModel::loadMessagePack(oh.get());
+  EXPECT_EQ(*ptr2->a, *bindata->a);
+
+  auto opt = std::make_shared<EnumOptional>(
+      std::pair<bool, TestEnum>(true, TestEnum::OPT2));
+  expectSameEncoding(opt);
+  opt->a.first = false;
+  expectSameEncoding(opt);
+  sbuf.clear();
+  MsgpackWrapper::dumpObject(packer, opt);
+  oh = msgpack::unpack(sbuf.data(), sbuf.size());
+  EXPECT_EQ(EnumOptional::loadMessagePack(oh.get())->a.first, false);
+}
+
+TEST(TestModel, TestSharedBinData) {
+  std::vector<uint8_t> raw(8192, 0x5a);
+  auto bindata = std::make_shared<BinDataModel>(
+      std::make_shared<data::BinData>(8, raw.size(), raw.data()));
+  msgpack::sbuffer sbuf;
+  msgpack::packer<msgpack::sbuffer> packer(sbuf);
+  MsgpackWrapper::dumpObject(packer, bindata);
+  msgpack::object_handle oh = msgpack::unpack(sbuf.data(), sbuf.size());
+  msgpack::object obj = oh.get();
+  EXPECT_FALSE(BinDataModel::loadMessagePack(obj)->a->isShared());
+  std::shared_ptr<BinDataModel> ptr;
+  {
+    SharedZoneScope scope(std::shared_ptr<msgpack::zone>(std::move(oh.zone())));
+    ptr = BinDataModel::loadMessagePack(obj);
+  }
+  EXPECT_TRUE(ptr->a->isShared());
+  EXPECT_EQ(*ptr->a, *bindata->a);
+}
+
+TEST(TestModel, TestPackSharedBinData) {
+  auto raw = std::make_shared<std::vector<uint8_t>>(8192, 0x5a);
+  auto shared = std::make_shared<data::BinData>(data::BinData::fromSharedData(
+      8, raw->size(), raw->data(), raw));
+  ASSERT_TRUE(shared->isShared());
+  auto bindata = std::make_shared<BinDataModel>(shared);
+  msgpack::sbuffer sbuf;
+  msgpack::packer<msgpack::sbuffer> packer(sbuf);
+  MsgpackWrapper::dumpObject(packer, bindata);
+  EXPECT_TRUE(shared->isShared());
+  bindata->serializeToMsgpackObject();
+  EXPECT_TRUE(shared->isShared());
+  msgpack::object_handle oh = msgpack::unpack(sbuf.data(), sbuf.size());
+  EXPECT_EQ(*BinDataModel::loadMessagePack(oh.get())->a, *shared);
+}
+
 }  // namespace messages
 }  // namespace veles
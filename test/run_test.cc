@@ -14,9 +14,14 @@
  * limitations under the License.
  *
  */
+#include <QCoreApplication>
+
 #include "gtest/gtest.h"
 
 int main(int argc, char **argv) {
+	// Tests using the local database need an application object for its
+	// threads.
+	QCoreApplication app(argc, argv);
 	::testing::InitGoogleTest(&argc, argv);
 	return RUN_ALL_TESTS();
 }
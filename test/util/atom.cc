@@ -0,0 +1,80 @@
+/*
+ * Copyright 2017 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <thread>
+#include <vector>
+
+#include <QString>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include "util/atom.h"
+
+using namespace testing;
+
+namespace veles {
+namespace util {
+
+TEST(TestAtom, Interning) {
+  Atom empty;
+  EXPECT_TRUE(empty.isEmpty());
+  EXPECT_EQ(empty.id(), 0u);
+  EXPECT_EQ(Atom(QString()), empty);
+  EXPECT_EQ(Atom(""), empty);
+  EXPECT_TRUE(empty.toString().isEmpty());
+
+  Atom length("length");
+  EXPECT_FALSE(length.isEmpty());
+  EXPECT_EQ(Atom(QString("len") + "gth"), length);
+  EXPECT_NE(Atom("crc32"), length);
+  EXPECT_EQ(length.toString(), QString("length"));
+  EXPECT_EQ(Atom::fromId(length.id()), length);
+}
+
+TEST(TestAtom, ManyAtoms) {
+  // Enough to span several pages of the table.
+  std::vector<Atom> atoms;
+  for (int i = 0; i < 5000; i++) {
+    atoms.push_back(Atom(QString("chunks[%1]").arg(i)));
+  }
+  for (int i = 0; i < 5000; i++) {
+    EXPECT_EQ(atoms[i].toString(), QString("chunks[%1]").arg(i));
+    EXPECT_EQ(Atom(QString("chunks[%1]").arg(i)), atoms[i]);
+  }
+}
+
+TEST(TestAtom, Threads) {
+  std::vector<std::vector<Atom>> results(4);
+  std::vector<std::thread> threads;
+  for (auto &result : results) {
+    threads.emplace_back([&result]() {
+      for (int i = 0; i < 1000; i++) {
+        result.push_back(Atom(QString("field_%1").arg(i)));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  for (auto &result : results) {
+    EXPECT_EQ(result, results[0]);
+  }
+  EXPECT_EQ(results[0][123].toString(), QString("field_123"));
+}
+
+}  // namespace util
+}  // namespace veles
@@ -0,0 +1,118 @@
+/*
+ * Copyright 2017 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include "util/intervalindex.h"
+
+using namespace testing;
+
+namespace veles {
+namespace util {
+
+TEST(TestIntervalIndex, Find) {
+  IntervalIndex<int> index;
+  EXPECT_EQ(index.find(0), nullptr);
+  index.add(10, 20, 1);
+  index.add(0, 100, 0);
+  index.add(12, 14, 2);
+  index.add(30, 30, 3);
+  index.add(40, 50, 4);
+  index.build();
+  EXPECT_EQ(*index.find(5), 0);
+  EXPECT_EQ(*index.find(10), 1);
+  EXPECT_EQ(*index.find(13), 2);
+  EXPECT_EQ(*index.find(14), 1);
+  EXPECT_EQ(*index.find(20), 0);
+  EXPECT_EQ(*index.find(30), 0);
+  EXPECT_EQ(*index.find(49), 4);
+  EXPECT_EQ(*index.find(50), 0);
+  EXPECT_EQ(index.find(100), nullptr);
+}
+
+TEST(TestIntervalIndex, FindBetweenManyChildren) {
+  const int count = 100000;
+  IntervalIndex<int> index;
+  index.add(0, 10 * count, -1);
+  for (int i = 0; i < count; i++) {
+    index.add(10 * i, 10 * i + 5, i);
+  }
+  index.build();
+  // Each lookup between children used to walk back over all earlier
+  // siblings.
+  for (int i = 0; i < count; i++) {
+    ASSERT_EQ(*index.find(10 * i + 2), i);
+    ASSERT_EQ(*index.find(10 * i + 7), -1);
+  }
+  EXPECT_EQ(index.find(10 * count), nullptr);
+}
+
+TEST(TestIntervalIndex, FindMatchesLinearScan) {
+  IntervalIndex<int> index;
+  std::vector<std::pair<uint64_t, uint64_t>> intervals;
+  uint32_t seed = 1;
+  for (int i = 0; i < 300; i++) {
+    seed = seed * 1103515245 + 12345;
+    uint64_t start = (seed >> 8) % 1000;
+    seed = seed * 1103515245 + 12345;
+    uint64_t end = start + 1 + (seed >> 8) % 200;
+    intervals.emplace_back(start, end);
+    index.add(start, end, i);
+  }
+  index.build();
+  for (uint64_t pos = 0; pos < 1300; pos++) {
+    // The last-starting containing interval, later-added ones first on
+    // ties.
+    int expected = -1;
+    for (int i = 0; i < int(intervals.size()); i++) {
+      if (intervals[i].first <= pos && intervals[i].second > pos &&
+          (expected < 0 || intervals[i].first >= intervals[expected].first)) {
+        expected = i;
+      }
+    }
+    const int *found = index.find(pos);
+    if (expected < 0) {
+      EXPECT_EQ(found, nullptr) << pos;
+    } else {
+      ASSERT_NE(found, nullptr) << pos;
+      EXPECT_EQ(*found, expected) << pos;
+    }
+  }
+}
+
+TEST(TestIntervalIndex, Overlapping) {
+  IntervalIndex<int> index;
+  index.add(0, 10, 0);
+  index.add(5, 50, 1);
+  index.add(20, 30, 2);
+  index.add(40, 45, 3);
+  index.build();
+  std::vector<int> res;
+  index.overlapping(10, 20, res);
+  EXPECT_THAT(res, ElementsAre(1));
+  res.clear();
+  index.overlapping(0, 100, res);
+  EXPECT_THAT(res, ElementsAre(0, 1, 2, 3));
+  res.clear();
+  index.overlapping(31, 40, res);
+  EXPECT_THAT(res, ElementsAre(1));
+  res.clear();
+  index.overlapping(50, 60, res);
+  EXPECT_THAT(res, ElementsAre());
+}
+
+}  // namespace util
+}  // namespace veles